@@ -0,0 +1,18 @@
+# Copyright (c) 2015 Andrew Kelley
+# This file is MIT licensed.
+# See http://opensource.org/licenses/MIT
+
+# PIPEWIRE_FOUND
+# PIPEWIRE_INCLUDE_DIR
+# SPA_INCLUDE_DIR
+# PIPEWIRE_LIBRARY
+
+find_path(PIPEWIRE_INCLUDE_DIR NAMES pipewire/pipewire.h PATH_SUFFIXES pipewire-0.3)
+find_path(SPA_INCLUDE_DIR NAMES spa/param/audio/format-utils.h PATH_SUFFIXES spa-0.2)
+
+find_library(PIPEWIRE_LIBRARY NAMES pipewire-0.3)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(PIPEWIRE DEFAULT_MSG PIPEWIRE_LIBRARY PIPEWIRE_INCLUDE_DIR SPA_INCLUDE_DIR)
+
+mark_as_advanced(PIPEWIRE_INCLUDE_DIR SPA_INCLUDE_DIR PIPEWIRE_LIBRARY)
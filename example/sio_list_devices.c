@@ -17,7 +17,7 @@ static int usage(char *exe) {
     fprintf(stderr, "Usage: %s [options]\n"
             "Options:\n"
             "  [--watch]\n"
-            "  [--backend dummy|alsa|pulseaudio|jack|coreaudio|wasapi]\n"
+            "  [--backend dummy|alsa|pipewire|pulseaudio|jack|coreaudio|wasapi]\n"
             "  [--short]\n", exe);
     return 1;
 }
@@ -133,6 +133,8 @@ int main(int argc, char **argv) {
                     backend = SoundIoBackendDummy;
                 } else if (strcmp("alsa", argv[i]) == 0) {
                     backend = SoundIoBackendAlsa;
+                } else if (strcmp("pipewire", argv[i]) == 0) {
+                    backend = SoundIoBackendPipeWire;
                 } else if (strcmp("pulseaudio", argv[i]) == 0) {
                     backend = SoundIoBackendPulseAudio;
                 } else if (strcmp("jack", argv[i]) == 0) {
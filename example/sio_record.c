@@ -116,7 +116,7 @@ static void overflow_callback(struct SoundIoInStream *instream) {
 static int usage(char *exe) {
     fprintf(stderr, "Usage: %s [options] outfile\n"
             "Options:\n"
-            "  [--backend dummy|alsa|pulseaudio|jack|coreaudio|wasapi]\n"
+            "  [--backend dummy|alsa|pipewire|pulseaudio|jack|coreaudio|wasapi]\n"
             "  [--device id]\n"
             "  [--raw]\n"
             , exe);
@@ -141,6 +141,8 @@ int main(int argc, char **argv) {
                     backend = SoundIoBackendDummy;
                 } else if (strcmp("alsa", argv[i]) == 0) {
                     backend = SoundIoBackendAlsa;
+                } else if (strcmp("pipewire", argv[i]) == 0) {
+                    backend = SoundIoBackendPipeWire;
                 } else if (strcmp("pulseaudio", argv[i]) == 0) {
                     backend = SoundIoBackendPulseAudio;
                 } else if (strcmp("jack", argv[i]) == 0) {
@@ -16,7 +16,7 @@
 static int usage(char *exe) {
     fprintf(stderr, "Usage: %s [options]\n"
             "Options:\n"
-            "  [--backend dummy|alsa|pulseaudio|jack|coreaudio|wasapi]\n"
+            "  [--backend dummy|alsa|pipewire|pulseaudio|jack|coreaudio|wasapi]\n"
             "  [--device id]\n"
             "  [--raw]\n"
             "  [--name stream_name]\n"
@@ -127,6 +127,8 @@ int main(int argc, char **argv) {
                         backend = SoundIoBackendDummy;
                     } else if (strcmp(argv[i], "alsa") == 0) {
                         backend = SoundIoBackendAlsa;
+                    } else if (strcmp(argv[i], "pipewire") == 0) {
+                        backend = SoundIoBackendPipeWire;
                     } else if (strcmp(argv[i], "pulseaudio") == 0) {
                         backend = SoundIoBackendPulseAudio;
                     } else if (strcmp(argv[i], "jack") == 0) {
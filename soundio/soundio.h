@@ -10,6 +10,7 @@
 
 #include "endian.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 /// \cond
 #ifdef __cplusplus
@@ -100,6 +101,10 @@ enum SoundIoError {
     SoundIoErrorUnderflow,
     /// Unable to convert to or from UTF-8 to the native string format.
     SoundIoErrorEncodingString,
+    /// An input stream of the file backend read the whole file. Passed to
+    /// SoundIoInStream::error_callback, but does not leave the stream in an
+    /// invalid state.
+    SoundIoErrorEndOfFile,
 };
 
 /// Specifies where a channel is physically located.
@@ -223,6 +228,53 @@ enum SoundIoBackend {
     SoundIoBackendCoreAudio,
     SoundIoBackendWasapi,
     SoundIoBackendDummy,
+    SoundIoBackendFile,
+    SoundIoBackendPipe,
+    SoundIoBackendPipeWire,
+};
+
+/// See SoundIo::dummy_clock.
+enum SoundIoDummyClock {
+    SoundIoDummyClockReal,    ///< follow the system clock
+    SoundIoDummyClockManual,  ///< advance only in ::soundio_advance_clock
+    SoundIoDummyClockFreeRun, ///< advance one period whenever callbacks return
+};
+
+/// How late the dummy backend wakes its stream threads up. See
+/// SoundIoDummyFaults::jitter.
+enum SoundIoDummyJitter {
+    SoundIoDummyJitterUniform,      ///< Anywhere between 0 and the jitter.
+    SoundIoDummyJitterExponential,  ///< Usually a little, sometimes a lot, on average the jitter.
+};
+
+/// How a thread that runs stream callbacks is scheduled. See
+/// SoundIoThreadPolicy::sched.
+enum SoundIoThreadSched {
+    /// Asks for SCHED_FIFO at the highest priority, calling
+    /// SoundIo::emit_rtprio_warning if that is refused. This is what
+    /// libsoundio has always done.
+    SoundIoThreadSchedDefault,
+    /// Normal time sharing. No realtime priority is asked for.
+    SoundIoThreadSchedOther,
+    SoundIoThreadSchedFifo,       ///< SCHED_FIFO at SoundIoThreadPolicy::priority
+    SoundIoThreadSchedRoundRobin, ///< SCHED_RR at SoundIoThreadPolicy::priority
+    /// Linux SCHED_DEADLINE. The period and deadline are the period of the
+    /// stream, and the runtime is SoundIoThreadPolicy::deadline_runtime of
+    /// it. The thread starts as with #SoundIoThreadSchedFifo and stays so
+    /// where SCHED_DEADLINE is unavailable or refused, or when the backend
+    /// has no fixed period.
+    SoundIoThreadSchedDeadline,
+};
+
+/// Clocks that ::soundio_get_time_ns can read.
+enum SoundIoClock {
+    /// The clock that libsoundio schedules its own threads against. It may be
+    /// slewed to follow NTP. CLOCK_MONOTONIC on POSIX systems.
+    SoundIoClockMonotonic,
+    /// Never slewed, so intervals are measured by the hardware oscillator
+    /// alone. CLOCK_MONOTONIC_RAW on Linux; elsewhere the same as
+    /// #SoundIoClockMonotonic.
+    SoundIoClockMonotonicRaw,
 };
 
 enum SoundIoDeviceAim {
@@ -230,6 +282,17 @@ enum SoundIoDeviceAim {
     SoundIoDeviceAimOutput, ///< playback
 };
 
+/// What a device of the file backend reads or writes. See
+/// SoundIoFileDeviceSpec::type.
+enum SoundIoFileType {
+    /// RIFF WAVE with PCM or floating point samples. Supports
+    /// #SoundIoFormatU8, #SoundIoFormatS16LE, #SoundIoFormatS32LE,
+    /// #SoundIoFormatFloat32LE and #SoundIoFormatFloat64LE.
+    SoundIoFileTypeWav,
+    /// Samples only, in any format.
+    SoundIoFileTypeRaw,
+};
+
 /// For your convenience, Native Endian and Foreign Endian constants are defined
 /// which point to the respective SoundIoFormat values.
 enum SoundIoFormat {
@@ -315,6 +378,144 @@ struct SoundIoSampleRateRange {
     int max;
 };
 
+/// Describes a device of the dummy backend. See SoundIo::dummy_devices.
+/// The size of this struct is OK to use. All of it is copied, so it need not
+/// outlive the call it is passed to.
+struct SoundIoDummyDeviceSpec {
+    /// Must be unique among the devices with the same aim.
+    const char *id;
+    const char *name;
+    enum SoundIoDeviceAim aim;
+
+    /// If 0, every builtin channel layout is supported. Otherwise the first
+    /// one is SoundIoDevice::current_layout.
+    int layout_count;
+    const struct SoundIoChannelLayout *layouts;
+
+    /// If 0, every format is supported. Otherwise the first one is
+    /// SoundIoDevice::current_format.
+    int format_count;
+    const enum SoundIoFormat *formats;
+
+    /// If 0, every rate from #SOUNDIO_MIN_SAMPLE_RATE to
+    /// #SOUNDIO_MAX_SAMPLE_RATE is supported.
+    int sample_rate_count;
+    const struct SoundIoSampleRateRange *sample_rates;
+    /// Moved to the nearest supported rate. If 0, 48000 is used.
+    int sample_rate_current;
+
+    /// Each of these defaults to 0.01, 4.0 and 0.1 respectively when 0.
+    double software_latency_min;
+    double software_latency_max;
+    double software_latency_current;
+
+    /// Optional: Only for input devices. The id of the output device whose
+    /// played audio this device captures; see SoundIo::dummy_loopback_delay.
+    /// Defaults to `NULL`, and the device captures silence.
+    const char *loopback_id;
+};
+
+/// Describes a device of the file backend. See SoundIo::file_devices.
+/// Once an input stream has read the whole file, it calls
+/// SoundIoInStream::error_callback with #SoundIoErrorEndOfFile and then stops
+/// calling SoundIoInStream::read_callback. The default error_callback ignores
+/// this error.
+/// The size of this struct is OK to use.
+struct SoundIoFileDeviceSpec {
+    /// The file that output streams create or replace, or that input
+    /// streams read. Also the id and name of the device.
+    const char *path;
+    enum SoundIoDeviceAim aim;
+    enum SoundIoFileType type;
+
+    /// Only for raw input files, which do not describe their samples.
+    enum SoundIoFormat raw_format;
+    int raw_sample_rate;
+    int raw_channel_count;
+};
+
+/// Describes a device of the pipe backend. See SoundIo::pipe_devices.
+/// The size of this struct is OK to use.
+struct SoundIoPipeDeviceSpec {
+    /// A FIFO or other file that streams open when they are opened and close
+    /// when they are destroyed. Also the id and name of the device. `NULL` to
+    /// use SoundIoPipeDeviceSpec::fd instead.
+    const char *path;
+    /// An open file descriptor, such as one end of a pipe or socketpair,
+    /// used when SoundIoPipeDeviceSpec::path is `NULL`. While a stream uses
+    /// it, it is in non-blocking mode. The flag belongs to the open file
+    /// description, so copies made with dup() see it too. The original flags
+    /// are restored when the stream is destroyed. libsoundio never closes
+    /// the file descriptor, and only one stream may use it at a time.
+    int fd;
+    enum SoundIoDeviceAim aim;
+
+    /// Whatever is at the other end must agree on these, since raw
+    /// interleaved samples are all that goes through the file descriptor.
+    enum SoundIoFormat format;
+    int sample_rate;
+    int channel_count;
+};
+
+/// Adverse conditions simulated by the dummy backend; see
+/// SoundIo::dummy_faults. Probabilities are per period of each stream, and
+/// zeroed fields turn the corresponding fault off.
+/// The size of this struct is OK to use.
+struct SoundIoDummyFaults {
+    /// Seeds the random choices. Together with #SoundIoDummyClockManual
+    /// a run can be repeated exactly.
+    unsigned int seed;
+
+    enum SoundIoDummyJitter jitter_distribution;
+    /// Seconds by which stream threads wake up late.
+    double jitter;
+
+    /// Chance that a stream thread sleeps for another `stall_duration`
+    /// seconds, which underflows or overflows the stream if it is longer
+    /// than its buffer.
+    double stall_probability;
+    double stall_duration;
+
+    /// Chance that an output stream loses its buffer and calls
+    /// SoundIoOutStream::underflow_callback.
+    double underflow_probability;
+    /// Chance that an input stream loses a period of frames and calls
+    /// SoundIoInStream::overflow_callback.
+    double overflow_probability;
+    /// Chance that a stream calls its error callback with
+    /// #SoundIoErrorStreaming and stops.
+    double error_probability;
+
+    /// Seconds after connecting at which the backend disconnects, as
+    /// measured by SoundIo::dummy_clock. SoundIo::on_backend_disconnect is
+    /// called with #SoundIoErrorBackendDisconnected and every stream calls
+    /// its error callback with #SoundIoErrorStreaming. 0 means never.
+    double disconnect_after;
+};
+
+/// Scheduling of the threads that libsoundio creates to run stream
+/// callbacks; see SoundIo::thread_policy. Zeroed, it is the default.
+/// On Windows every realtime policy means THREAD_PRIORITY_TIME_CRITICAL,
+/// and only SoundIoThreadPolicy::cpu_mask of the rest is used.
+/// The size of this struct is OK to use.
+struct SoundIoThreadPolicy {
+    enum SoundIoThreadSched sched;
+    /// Priority for #SoundIoThreadSchedFifo and #SoundIoThreadSchedRoundRobin,
+    /// clamped to the range the system allows. 0 means the highest. Choose
+    /// one below the threaded interrupt handlers of the sound card so that
+    /// they are not held up by the callbacks.
+    int priority;
+    /// Share of each period that #SoundIoThreadSchedDeadline reserves for the
+    /// thread, at most 1. 0 means 0.5.
+    double deadline_runtime;
+    /// CPUs the thread may run on, bit n for CPU n. 0 leaves the affinity
+    /// alone. Linux and Windows only.
+    uint64_t cpu_mask;
+    /// Timer slack of the thread in nanoseconds, which bounds how late its
+    /// timed waits may wake up. 0 leaves the system default. Linux only.
+    int64_t timer_slack;
+};
+
 /// The size of this struct is OK to use.
 struct SoundIoChannelArea {
     /// Base address of buffer.
@@ -381,6 +582,149 @@ struct SoundIo {
     /// Optional: JACK error callback.
     /// See SoundIo::jack_info_callback
     void (*jack_error_callback)(const char *msg);
+
+    /// Optional: Defer probing device capabilities until they are needed.
+    /// When this is `true`, backends that support it only populate
+    /// SoundIoDevice::id, SoundIoDevice::name, SoundIoDevice::aim and
+    /// SoundIoDevice::is_raw while scanning devices. Formats, channel
+    /// layouts, sample rates and latency ranges are filled in by
+    /// ::soundio_device_probe, which ::soundio_outstream_open and
+    /// ::soundio_instream_open call for you. This makes device scanning
+    /// cheap when you have many devices but only open one.
+    /// Currently only ALSA supports this. Defaults to `false`.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    bool lazy_device_probe;
+
+    /// Optional: Quiet window in seconds used to coalesce device hotplug
+    /// events. Plugging in a device typically produces a burst of events;
+    /// the device list is rescanned, and SoundIo::on_devices_change called,
+    /// only once no further events have arrived for this long, or at the
+    /// latest four times this long after the first event of the burst.
+    /// ::soundio_force_device_scan is not delayed.
+    /// Currently only ALSA uses this. Defaults to 0.1. Set to 0 to rescan on
+    /// every event.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    double device_scan_debounce;
+
+    /// Optional: Number of shared threads which service all streams.
+    /// By default every stream gets a real-time thread of its own. When this
+    /// is nonzero, this many real-time threads are started instead, and each
+    /// stream is assigned to the least busy one when it is started. A thread
+    /// waits on the poll descriptors of all its streams at once and calls
+    /// their callbacks one after another, so callbacks of streams sharing a
+    /// thread delay each other. A callback may open, start and destroy other
+    /// streams, but not its own. When there is more than one thread, thread
+    /// `i` is pinned to CPU `i` modulo the number of CPUs.
+    /// Currently only ALSA supports this. Defaults to 0.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    int io_thread_count;
+
+    /// Optional: Register the ports of every stream on the JACK client of
+    /// the context instead of opening a JACK client per stream. All streams
+    /// are then serviced by a single process callback, input streams before
+    /// output streams, so a duplex pair sees the same cycle. Port names are
+    /// prefixed with the stream name and a serial number to keep them
+    /// unique.
+    /// Only JACK uses this. Defaults to `false`.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    bool jack_shared_client;
+
+    /// Optional callback. Called when freewheel mode starts or stops, whether
+    /// because of ::soundio_set_freewheel or because another client changed
+    /// it. Called from an unknown thread that you should not use to call any
+    /// soundio functions.
+    /// Only JACK calls this.
+    void (*on_freewheel_change)(struct SoundIo *, bool freewheel);
+
+    /// Optional: Clock that paces the streams of the dummy backend.
+    /// With #SoundIoDummyClockManual or #SoundIoDummyClockFreeRun, stream
+    /// threads follow a virtual clock instead of the system clock, so
+    /// periods are exactly SoundIoOutStream::software_latency / 2 (or
+    /// SoundIoInStream::software_latency) apart and a given sequence of
+    /// callbacks always produces the same sequence of callback arguments.
+    /// Hours of streaming can then be simulated in seconds.
+    /// Only the dummy backend uses this. Defaults to #SoundIoDummyClockReal.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    enum SoundIoDummyClock dummy_clock;
+
+    /// Optional: Devices the dummy backend starts with, instead of one output
+    /// device "dummy-out" and one input device "dummy-in". The first device
+    /// of each aim is the default one. The array is copied when connecting.
+    /// See also ::soundio_add_dummy_device and ::soundio_remove_dummy_device.
+    /// Only the dummy backend uses this. Defaults to `NULL`.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    const struct SoundIoDummyDeviceSpec *dummy_devices;
+    /// Number of elements in SoundIo::dummy_devices.
+    int dummy_device_count;
+
+    /// Optional: Makes the default "dummy-in" device capture what is played
+    /// on the default "dummy-out" device, as if it was a loopback cable.
+    /// Devices given in SoundIo::dummy_devices use
+    /// SoundIoDummyDeviceSpec::loopback_id instead.
+    /// Only the dummy backend uses this. Defaults to `false`.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    bool dummy_loopback;
+    /// Seconds between a frame being played on a dummy output stream and it
+    /// being captured by a loopback input stream, give or take a period of
+    /// the input stream. Only frames are passed on if the two streams use the
+    /// same format, sample rate and channel layout; otherwise, and while the
+    /// output stream is not playing, silence is captured. If several output
+    /// streams are open on the device, the first one to play is captured.
+    /// Loopback streams are only kept in step with #SoundIoDummyClockReal
+    /// and #SoundIoDummyClockManual.
+    /// Only the dummy backend uses this. Defaults to 0.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    double dummy_loopback_delay;
+
+    /// Optional: Faults for the dummy backend to inject, to test how an
+    /// application copes with a misbehaving sound system. Copied when
+    /// connecting.
+    /// Only the dummy backend uses this. Defaults to `NULL`.
+    /// Must be set before calling ::soundio_connect or
+    /// ::soundio_connect_backend.
+    const struct SoundIoDummyFaults *dummy_faults;
+
+    /// The devices of the file backend, which renders output streams to
+    /// files and plays files into input streams as fast as it can instead of
+    /// in real time. Callbacks follow the usual rules, so the same code can
+    /// drive sound cards and render offline. A callback that takes no frames
+    /// is called again after 0.1 seconds. The array is copied when
+    /// connecting. The file backend is only used with
+    /// ::soundio_connect_backend.
+    /// Only the file backend uses this. Defaults to `NULL`.
+    /// Must be set before calling ::soundio_connect_backend.
+    const struct SoundIoFileDeviceSpec *file_devices;
+    /// Number of elements in SoundIo::file_devices.
+    int file_device_count;
+
+    /// The devices of the pipe backend, which streams raw samples through
+    /// FIFOs and other file descriptors shared with a process that has access
+    /// to the sound hardware. Streams are paced by that process: writes wait
+    /// while the pipe is full and reads wait while it is empty. The array is
+    /// copied when connecting. The pipe backend is only used with
+    /// ::soundio_connect_backend, and is not available on Windows.
+    /// Only the pipe backend uses this. Defaults to `NULL`.
+    /// Must be set before calling ::soundio_connect_backend.
+    const struct SoundIoPipeDeviceSpec *pipe_devices;
+    /// Number of elements in SoundIo::pipe_devices.
+    int pipe_device_count;
+
+    /// Optional: How the threads that libsoundio creates to run stream
+    /// callbacks are scheduled, unless a stream sets its own policy. Streams
+    /// use the policy as it is when they are opened. ALSA's shared I/O
+    /// threads use it as it is when connecting.
+    /// JACK, PipeWire and CoreAudio call back on threads that belong to the
+    /// sound server or the system, and ignore this. Defaults to zeroes,
+    /// which is #SoundIoThreadSchedDefault.
+    struct SoundIoThreadPolicy thread_policy;
 };
 
 /// The size of this struct is not part of the API or ABI.
@@ -486,6 +830,8 @@ struct SoundIoDevice {
     /// fields of the device will be populated. If there is an error code here
     /// then information about formats, sample rates, and channel layouts might
     /// be missing.
+    /// If SoundIo::lazy_device_probe is set, this is not meaningful until
+    /// ::soundio_device_probe has been called.
     ///
     /// Possible errors:
     /// * #SoundIoErrorOpeningDevice
@@ -529,9 +875,9 @@ struct SoundIoOutStream {
     ///
     /// If the device has unknown software latency min and max values, you may
     /// still set this, but you might not get the value you requested.
-    /// For PulseAudio, if you set this value to non-default, it sets
-    /// `PA_STREAM_ADJUST_LATENCY` and is the value used for `maxlength` and
-    /// `tlength`.
+    /// For PulseAudio, if you set this value to non-default, it is the value
+    /// used for `maxlength` and `tlength`. See also
+    /// SoundIoOutStream::adjust_latency.
     ///
     /// For JACK, this value is always equal to
     /// SoundIoDevice::software_latency_current of the device.
@@ -560,7 +906,10 @@ struct SoundIoOutStream {
             int frame_count_min, int frame_count_max);
     /// This optional callback happens when the sound device runs out of
     /// buffered audio data to play. After this occurs, the outstream waits
-    /// until the buffer is full to resume playback.
+    /// until the buffer is full to resume playback, unless
+    /// SoundIoOutStream::preserve_clock_on_xrun is set.
+    /// SoundIoOutStream::underflow_frame_count is updated before this is
+    /// called.
     /// This is called from the SoundIoOutStream::write_callback thread context.
     void (*underflow_callback)(struct SoundIoOutStream *);
     /// Optional callback. `err` is always SoundIoErrorStreaming.
@@ -574,7 +923,8 @@ struct SoundIoOutStream {
     /// Optional: Name of the stream. Defaults to "SoundIoOutStream"
     /// PulseAudio uses this for the stream name.
     /// JACK uses this for the client name of the client that connects when you
-    /// open the stream.
+    /// open the stream, or as a port name prefix with
+    /// SoundIo::jack_shared_client.
     /// WASAPI uses this for the session display name.
     /// Must not contain a colon (":").
     const char *name;
@@ -584,6 +934,45 @@ struct SoundIoOutStream {
     /// stream. Defaults to `false`.
     bool non_terminal_hint;
 
+    /// Optional: Keep the stream running through underflows instead of
+    /// stopping and restarting it. The device plays silence in place of the
+    /// frames that were not written in time, and writing resumes at the
+    /// current hardware position, so the stream position reported by
+    /// ::soundio_outstream_get_position keeps advancing in step with the
+    /// device clock.
+    /// Currently only ALSA supports this. Defaults to `false`.
+    bool preserve_clock_on_xrun;
+
+    /// Optional: When SoundIoOutStream::device is not raw, open the raw
+    /// device underneath it instead if that device accepts the stream's
+    /// format, sample rate and channel layout as they are. This skips the
+    /// conversion and mixing done in software, but other applications cannot
+    /// use the device while the stream is open.
+    /// Currently only ALSA supports this. Defaults to `false`.
+    bool prefer_raw;
+
+    /// Optional: Treat SoundIoOutStream::software_latency as the latency
+    /// of the whole path to the speaker rather than just the size of the
+    /// stream's buffer, and have the sound server lower the latency of the
+    /// device to meet it. The server then asks for data in small chunks
+    /// instead of whenever its own buffers run low. After
+    /// ::soundio_outstream_open, SoundIoOutStream::software_latency holds
+    /// the latency the server settled on, device latency included.
+    /// For PulseAudio this sets `PA_STREAM_ADJUST_LATENCY` and explicit
+    /// `minreq` and `prebuf` values. It has no effect unless
+    /// SoundIoOutStream::software_latency is set.
+    /// Currently only PulseAudio supports this. Defaults to `false`.
+    bool adjust_latency;
+
+    /// Optional: Call SoundIoOutStream::write_callback from a real-time
+    /// thread belonging to this stream, which hands the audio to the backend
+    /// through a ring buffer. The callbacks then never run while the
+    /// backend's event loop is locked, so a slow callback cannot hold up
+    /// other streams or device events, at the cost of one extra copy.
+    /// Only PulseAudio uses this; the other backends already run each
+    /// stream on a thread of its own. Defaults to `false`.
+    bool dedicated_thread;
+
 
     /// computed automatically when you call ::soundio_outstream_open
     int bytes_per_frame;
@@ -594,6 +983,23 @@ struct SoundIoOutStream {
     /// to an error code. Possible error codes are:
     /// * #SoundIoErrorIncompatibleDevice
     int layout_error;
+
+    /// Read-only. Total number of frames of playback time lost to underflows
+    /// since the stream was opened, for backends which can measure it.
+    /// Lost frames count towards the position reported by
+    /// ::soundio_outstream_get_position.
+    /// Currently only ALSA measures this.
+    int64_t underflow_frame_count;
+
+    /// Read-only. Set by ::soundio_outstream_open to whether the stream talks
+    /// to a raw device, either because SoundIoOutStream::device is raw or
+    /// because of SoundIoOutStream::prefer_raw.
+    bool opened_raw;
+
+    /// Optional: Scheduling of the thread that runs this stream's callbacks,
+    /// in place of SoundIo::thread_policy. Copied by
+    /// ::soundio_outstream_open. Defaults to `NULL`.
+    const struct SoundIoThreadPolicy *thread_policy;
 };
 
 /// The size of this struct is not part of the API or ABI.
@@ -621,8 +1027,8 @@ struct SoundIoInStream {
     /// potentially upwards of 2 seconds.
     /// If the device has unknown software latency min and max values, you may
     /// still set this, but you might not get the value you requested.
-    /// For PulseAudio, if you set this value to non-default, it sets
-    /// `PA_STREAM_ADJUST_LATENCY` and is the value used for `fragsize`.
+    /// For PulseAudio, if you set this value to non-default, it is the value
+    /// used for `fragsize`. See also SoundIoInStream::adjust_latency.
     /// For JACK, this value is always equal to
     /// SoundIoDevice::software_latency_current
     double software_latency;
@@ -644,21 +1050,26 @@ struct SoundIoInStream {
     void (*read_callback)(struct SoundIoInStream *, int frame_count_min, int frame_count_max);
     /// This optional callback happens when the sound device buffer is full,
     /// yet there is more captured audio to put in it.
+    /// SoundIoInStream::overflow_frame_count is updated before this is
+    /// called.
     /// This is never fired for PulseAudio.
     /// This is called from the SoundIoInStream::read_callback thread context.
     void (*overflow_callback)(struct SoundIoInStream *);
-    /// Optional callback. `err` is always SoundIoErrorStreaming.
-    /// SoundIoErrorStreaming is an unrecoverable error. The stream is in an
-    /// invalid state and must be destroyed.
+    /// Optional callback. `err` is SoundIoErrorStreaming, or
+    /// SoundIoErrorEndOfFile when a file backend stream reaches the end of
+    /// its file. SoundIoErrorStreaming is an unrecoverable error. The stream
+    /// is in an invalid state and must be destroyed.
     /// If you do not supply `error_callback`, the default callback will print
-    /// a message to stderr and then abort().
+    /// a message to stderr and then abort(), except that it ignores
+    /// SoundIoErrorEndOfFile.
     /// This is called from the SoundIoInStream::read_callback thread context.
     void (*error_callback)(struct SoundIoInStream *, int err);
 
     /// Optional: Name of the stream. Defaults to "SoundIoInStream";
     /// PulseAudio uses this for the stream name.
     /// JACK uses this for the client name of the client that connects when you
-    /// open the stream.
+    /// open the stream, or as a port name prefix with
+    /// SoundIo::jack_shared_client.
     /// WASAPI uses this for the session display name.
     /// Must not contain a colon (":").
     const char *name;
@@ -668,6 +1079,38 @@ struct SoundIoInStream {
     /// passed on or made available to another stream. Defaults to `false`.
     bool non_terminal_hint;
 
+    /// Optional: Keep the stream running through overflows instead of
+    /// stopping and restarting it. Reading resumes with the oldest frame
+    /// still in the device buffer, so the stream position reported by
+    /// ::soundio_instream_get_position keeps advancing in step with the
+    /// device clock.
+    /// Currently only ALSA supports this. Defaults to `false`.
+    bool preserve_clock_on_xrun;
+
+    /// Optional: See SoundIoOutStream::prefer_raw.
+    /// Currently only ALSA supports this. Defaults to `false`.
+    bool prefer_raw;
+
+    /// Optional: See SoundIoOutStream::adjust_latency. For PulseAudio the
+    /// stream does not connect until ::soundio_instream_start, so that is
+    /// when SoundIoInStream::software_latency is updated.
+    /// Currently only PulseAudio supports this. Defaults to `false`.
+    bool adjust_latency;
+
+    /// Optional: See SoundIoOutStream::dedicated_thread.
+    /// Only PulseAudio uses this. Defaults to `false`.
+    bool dedicated_thread;
+
+    /// Optional: If nonzero, captured fragments are gathered into one
+    /// contiguous buffer of up to this many frames before
+    /// SoundIoInStream::read_callback is called, so that a single
+    /// ::soundio_instream_begin_read can return everything that is
+    /// available. Holes in the captured stream are filled with silence
+    /// instead of being returned as `NULL` areas. Frames that are not read
+    /// are kept for the next callback.
+    /// Currently only PulseAudio supports this. Defaults to `0`.
+    int coalesce_frame_count;
+
     /// computed automatically when you call ::soundio_instream_open
     int bytes_per_frame;
     /// computed automatically when you call ::soundio_instream_open
@@ -676,6 +1119,23 @@ struct SoundIoInStream {
     /// If setting the channel layout fails for some reason, this field is set
     /// to an error code. Possible error codes are: #SoundIoErrorIncompatibleDevice
     int layout_error;
+
+    /// Read-only. Total number of captured frames lost to overflows since the
+    /// stream was opened, for backends which can measure it.
+    /// Lost frames count towards the position reported by
+    /// ::soundio_instream_get_position.
+    /// Currently only ALSA measures this.
+    int64_t overflow_frame_count;
+
+    /// Read-only. Set by ::soundio_instream_open to whether the stream talks
+    /// to a raw device, either because SoundIoInStream::device is raw or
+    /// because of SoundIoInStream::prefer_raw.
+    bool opened_raw;
+
+    /// Optional: Scheduling of the thread that runs this stream's callbacks,
+    /// in place of SoundIo::thread_policy. Copied by
+    /// ::soundio_instream_open. Defaults to `NULL`.
+    const struct SoundIoThreadPolicy *thread_policy;
 };
 
 /// See also ::soundio_version_major, ::soundio_version_minor, ::soundio_version_patch
@@ -779,6 +1239,61 @@ SOUNDIO_EXPORT void soundio_wakeup(struct SoundIo *soundio);
 /// SoundIoOutStream::write_callback and SoundIoInStream::read_callback
 SOUNDIO_EXPORT void soundio_force_device_scan(struct SoundIo *soundio);
 
+/// Advances the virtual clock by `seconds` and blocks until every started
+/// stream has made the callbacks for all periods that begin before the new
+/// time. Call this from one thread only, and not from a stream callback.
+/// See SoundIo::dummy_clock.
+///
+/// Possible errors:
+/// * #SoundIoErrorIncompatibleBackend
+/// * #SoundIoErrorInvalid - SoundIo::dummy_clock is not #SoundIoDummyClockManual
+SOUNDIO_EXPORT int soundio_advance_clock(struct SoundIo *soundio, double seconds);
+
+/// Adds a device to the dummy backend as if it had been plugged in.
+/// The device list is updated, and SoundIo::on_devices_change called, at the
+/// next ::soundio_flush_events. This can be called from any thread.
+///
+/// Possible errors:
+/// * #SoundIoErrorIncompatibleBackend
+/// * #SoundIoErrorInvalid - `spec` is missing an id or name, has an invalid
+///   channel layout or uses an id that its aim already has
+/// * #SoundIoErrorNoMem
+SOUNDIO_EXPORT int soundio_add_dummy_device(struct SoundIo *soundio,
+        const struct SoundIoDummyDeviceSpec *spec);
+
+/// Removes a device of the dummy backend as if it had been unplugged. Streams
+/// that are already open on it keep running.
+/// The device list is updated, and SoundIo::on_devices_change called, at the
+/// next ::soundio_flush_events. This can be called from any thread.
+///
+/// Possible errors:
+/// * #SoundIoErrorIncompatibleBackend
+/// * #SoundIoErrorInvalid - there is no device with this aim and id
+/// * #SoundIoErrorNoMem
+SOUNDIO_EXPORT int soundio_remove_dummy_device(struct SoundIo *soundio,
+        enum SoundIoDeviceAim aim, const char *id);
+
+/// Switches freewheel mode on or off. While freewheeling, the backend stops
+/// following the hardware clock and calls SoundIoOutStream::write_callback
+/// and SoundIoInStream::read_callback back-to-back, as fast as they return,
+/// which is useful for rendering faster than real time. Stream latency is
+/// reported as 0 in this mode because nothing is waiting on a device.
+/// SoundIo::on_freewheel_change is called once the mode has changed.
+///
+/// Possible errors:
+/// * #SoundIoErrorIncompatibleBackend
+/// * #SoundIoErrorBackendDisconnected
+/// * #SoundIoErrorSystemResources - the server refused to change the mode
+SOUNDIO_EXPORT int soundio_set_freewheel(struct SoundIo *soundio, bool freewheel);
+
+/// Returns the time of `clock` in nanoseconds. Only the difference between two
+/// readings of the same clock means anything. Unlike seconds in a `double`,
+/// the resolution does not degrade as the system stays up.
+/// ::soundio_create must have been called at least once before. After that
+/// this can be called from any thread, including
+/// SoundIoOutStream::write_callback and SoundIoInStream::read_callback.
+SOUNDIO_EXPORT int64_t soundio_get_time_ns(enum SoundIoClock clock);
+
 
 // Channel Layouts
 
@@ -899,6 +1414,19 @@ SOUNDIO_EXPORT bool soundio_device_equal(
 /// Sorts channel layouts by channel count, descending.
 SOUNDIO_EXPORT void soundio_device_sort_channel_layouts(struct SoundIoDevice *device);
 
+/// Populates the formats, channel layouts, sample rates and latency ranges of
+/// `device` if SoundIo::lazy_device_probe deferred it. Does nothing if the
+/// device has already been probed. You must call this before reading those
+/// fields or using the convenience functions below on a lazily probed device.
+/// Must be called from the same thread as ::soundio_flush_events.
+/// Returns SoundIoDevice::probe_error.
+///
+/// Possible errors:
+/// * #SoundIoErrorOpeningDevice
+/// * #SoundIoErrorNoMem
+/// * #SoundIoErrorBackendDisconnected
+SOUNDIO_EXPORT int soundio_device_probe(struct SoundIoDevice *device);
+
 /// Convenience function. Returns whether `format` is included in the device's
 /// supported formats.
 SOUNDIO_EXPORT bool soundio_device_supports_format(struct SoundIoDevice *device,
@@ -942,6 +1470,7 @@ SOUNDIO_EXPORT void soundio_outstream_destroy(struct SoundIoOutStream *outstream
 ///   * SoundIoDevice::aim is not #SoundIoDeviceAimOutput
 ///   * SoundIoOutStream::format is not valid
 ///   * SoundIoOutStream::channel_count is greater than #SOUNDIO_MAX_CHANNELS
+///   * the thread policy has a field out of range
 /// * #SoundIoErrorNoMem
 /// * #SoundIoErrorOpeningDevice
 /// * #SoundIoErrorBackendDisconnected
@@ -962,6 +1491,7 @@ SOUNDIO_EXPORT int soundio_outstream_open(struct SoundIoOutStream *outstream);
 /// * #SoundIoErrorNoMem
 /// * #SoundIoErrorSystemResources
 /// * #SoundIoErrorBackendDisconnected
+/// * #SoundIoErrorInvalid - SoundIoThreadPolicy::cpu_mask has no usable CPU
 SOUNDIO_EXPORT int soundio_outstream_start(struct SoundIoOutStream *outstream);
 
 /// Call this function when you are ready to begin writing to the device buffer.
@@ -1023,6 +1553,39 @@ SOUNDIO_EXPORT int soundio_outstream_end_write(struct SoundIoOutStream *outstrea
 /// * #SoundIoErrorIncompatibleDevice
 SOUNDIO_EXPORT int soundio_outstream_clear_buffer(struct SoundIoOutStream *outstream);
 
+/// Obtain the number of frames that have been written to the stream but not
+/// yet played, and which could still be replaced by calling
+/// ::soundio_outstream_rewind.
+///
+/// This function must be called only from within SoundIoOutStream::write_callback.
+///
+/// Possible errors:
+/// * #SoundIoErrorStreaming
+/// * #SoundIoErrorIncompatibleBackend
+SOUNDIO_EXPORT int soundio_outstream_get_rewindable(struct SoundIoOutStream *outstream,
+        int *out_frame_count);
+
+/// Takes back queued frames so that only `keep_frame_count` frames remain
+/// ahead of the hardware pointer. The next frames you write replace the
+/// ones taken back, which lets you keep a large buffer for safety yet make
+/// new sound audible after only `keep_frame_count` frames.
+/// `out_frame_count` is set to the number of frames taken back. You may write
+/// that many frames in addition to `frame_count_max` in the current
+/// SoundIoOutStream::write_callback.
+///
+/// Backends which cannot rewind fall back to
+/// ::soundio_outstream_clear_buffer, discarding everything that is queued,
+/// and set `out_frame_count` to 0.
+///
+/// This function must be called only from within SoundIoOutStream::write_callback.
+///
+/// Possible errors:
+/// * #SoundIoErrorStreaming
+/// * #SoundIoErrorIncompatibleBackend
+/// * #SoundIoErrorIncompatibleDevice
+SOUNDIO_EXPORT int soundio_outstream_rewind(struct SoundIoOutStream *outstream,
+        int keep_frame_count, int *out_frame_count);
+
 /// If the underlying backend and device support pausing, this pauses the
 /// stream. SoundIoOutStream::write_callback may be called a few more times if
 /// the buffer is not full.
@@ -1058,6 +1621,26 @@ SOUNDIO_EXPORT int soundio_outstream_pause(struct SoundIoOutStream *outstream, b
 SOUNDIO_EXPORT int soundio_outstream_get_latency(struct SoundIoOutStream *outstream,
         double *out_latency);
 
+/// Obtain a frame position of the stream together with the time at which it
+/// was valid, suitable for synchronizing audio with other media.
+/// `out_frame_position` is the number of frames written with
+/// ::soundio_outstream_end_write that had become audible at `out_timestamp`.
+/// Frames discarded by ::soundio_outstream_clear_buffer are not counted.
+/// `out_timestamp` is in seconds on the system monotonic clock
+/// (`CLOCK_MONOTONIC` on Linux). Where the backend supports it, these come
+/// from hardware timestamps rather than being sampled at call time.
+///
+/// This is cheap enough to call on every SoundIoOutStream::write_callback,
+/// and must be called only from within SoundIoOutStream::write_callback.
+///
+/// Currently only ALSA supports this.
+///
+/// Possible errors:
+/// * #SoundIoErrorStreaming
+/// * #SoundIoErrorIncompatibleBackend
+SOUNDIO_EXPORT int soundio_outstream_get_position(struct SoundIoOutStream *outstream,
+        int64_t *out_frame_position, double *out_timestamp);
+
 SOUNDIO_EXPORT int soundio_outstream_set_volume(struct SoundIoOutStream *outstream,
         double volume);
 
@@ -1083,6 +1666,8 @@ SOUNDIO_EXPORT void soundio_instream_destroy(struct SoundIoInStream *instream);
 ///   * device aim is not #SoundIoDeviceAimInput
 ///   * format is not valid
 ///   * requested layout channel count > #SOUNDIO_MAX_CHANNELS
+///   * SoundIoInStream::coalesce_frame_count is negative
+///   * the thread policy has a field out of range
 /// * #SoundIoErrorOpeningDevice
 /// * #SoundIoErrorNoMem
 /// * #SoundIoErrorBackendDisconnected
@@ -1099,6 +1684,7 @@ SOUNDIO_EXPORT int soundio_instream_open(struct SoundIoInStream *instream);
 /// * #SoundIoErrorStreaming
 /// * #SoundIoErrorOpeningDevice
 /// * #SoundIoErrorSystemResources
+/// * #SoundIoErrorInvalid - SoundIoThreadPolicy::cpu_mask has no usable CPU
 SOUNDIO_EXPORT int soundio_instream_start(struct SoundIoInStream *instream);
 
 /// Call this function when you are ready to begin reading from the device
@@ -1166,6 +1752,26 @@ SOUNDIO_EXPORT int soundio_instream_pause(struct SoundIoInStream *instream, bool
 SOUNDIO_EXPORT int soundio_instream_get_latency(struct SoundIoInStream *instream,
         double *out_latency);
 
+/// Obtain a frame position of the stream together with the time at which it
+/// was valid, suitable for synchronizing audio with other media.
+/// `out_frame_position` is the number of frames that had been captured by the
+/// device at `out_timestamp`, counting from the first frame delivered by
+/// ::soundio_instream_begin_read.
+/// `out_timestamp` is in seconds on the system monotonic clock
+/// (`CLOCK_MONOTONIC` on Linux). Where the backend supports it, these come
+/// from hardware timestamps rather than being sampled at call time.
+///
+/// This is cheap enough to call on every SoundIoInStream::read_callback,
+/// and must be called only from within SoundIoInStream::read_callback.
+///
+/// Currently only ALSA supports this.
+///
+/// Possible errors:
+/// * #SoundIoErrorStreaming
+/// * #SoundIoErrorIncompatibleBackend
+SOUNDIO_EXPORT int soundio_instream_get_position(struct SoundIoInStream *instream,
+        int64_t *out_frame_position, double *out_timestamp);
+
 
 struct SoundIoRingBuffer;
 
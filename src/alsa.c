@@ -10,8 +10,10 @@
 #include "soundio_private.h"
 
 #include <sys/inotify.h>
+#include <sys/epoll.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sched.h>
 
 static snd_pcm_stream_t stream_types[] = {SND_PCM_STREAM_PLAYBACK, SND_PCM_STREAM_CAPTURE};
 
@@ -24,6 +26,8 @@ static snd_pcm_access_t prioritized_access_types[] = {
 };
 
 SOUNDIO_MAKE_LIST_DEF(struct SoundIoAlsaPendingFile, SoundIoListAlsaPendingFile, SOUNDIO_LIST_STATIC)
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoAlsaIoStream *, SoundIoListAlsaIoStreamPtr, SOUNDIO_LIST_STATIC)
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoAlsaIoDispatch, SoundIoListAlsaIoDispatch, SOUNDIO_LIST_STATIC)
 
 static void wakeup_device_poll(struct SoundIoAlsa *sia) {
     ssize_t amt = write(sia->notify_pipe_fd[1], "a", 1);
@@ -47,9 +51,87 @@ static void wakeup_outstream_poll(struct SoundIoOutStreamAlsa *osa) {
     }
 }
 
+static void wakeup_io_thread(struct SoundIoAlsaIoThread *iot) {
+    ssize_t amt = write(iot->wake_pipe_fd[1], "a", 1);
+    if (amt == -1) {
+        assert(errno != EBADF);
+        assert(errno != EIO);
+        assert(errno != ENOSPC);
+        assert(errno != EPERM);
+        assert(errno != EPIPE);
+    }
+}
+
+static void io_stream_unregister_fds(struct SoundIoAlsaIoStream *ios, int fd_count) {
+    for (int i = 0; i < fd_count; i += 1)
+        epoll_ctl(ios->io_thread->epoll_fd, EPOLL_CTL_DEL, ios->poll_fds[i].fd, NULL);
+}
+
+// Once this returns, the I/O thread will not touch the stream again. The
+// caller has to make the stream's callbacks return first, by clearing its
+// thread_exit_flag.
+static void io_thread_remove_stream(struct SoundIoAlsaIoStream *ios) {
+    struct SoundIoAlsaIoThread *iot = ios->io_thread;
+    if (!iot)
+        return;
+
+    wakeup_io_thread(iot);
+    soundio_os_mutex_lock(iot->mutex);
+    while (ios->busy)
+        soundio_os_cond_wait(iot->cond, iot->mutex);
+    if (!ios->dead)
+        io_stream_unregister_fds(ios, ios->poll_fd_count);
+    for (int i = 0; i < iot->streams.length; i += 1) {
+        if (SoundIoListAlsaIoStreamPtr_val_at(&iot->streams, i) == ios) {
+            SoundIoListAlsaIoStreamPtr_swap_remove(&iot->streams, i);
+            break;
+        }
+    }
+    soundio_os_mutex_unlock(iot->mutex);
+
+    ios->io_thread = NULL;
+}
+
+static void destroy_io_threads(struct SoundIoAlsa *sia) {
+    if (!sia->io_threads)
+        return;
+
+    for (int i = 0; i < sia->io_thread_count; i += 1) {
+        struct SoundIoAlsaIoThread *iot = &sia->io_threads[i];
+        if (iot->thread) {
+            SOUNDIO_ATOMIC_FLAG_CLEAR(iot->abort_flag);
+            wakeup_io_thread(iot);
+            soundio_os_thread_destroy(iot->thread);
+        }
+
+        assert(iot->streams.length == 0);
+        SoundIoListAlsaIoStreamPtr_deinit(&iot->streams);
+        SoundIoListAlsaIoDispatch_deinit(&iot->dispatch);
+
+        if (iot->cond)
+            soundio_os_cond_destroy(iot->cond);
+
+        if (iot->mutex)
+            soundio_os_mutex_destroy(iot->mutex);
+
+        if (iot->epoll_fd >= 0)
+            close(iot->epoll_fd);
+        if (iot->wake_pipe_fd[0] >= 0)
+            close(iot->wake_pipe_fd[0]);
+        if (iot->wake_pipe_fd[1] >= 0)
+            close(iot->wake_pipe_fd[1]);
+    }
+
+    free(sia->io_threads);
+    sia->io_threads = NULL;
+    sia->io_thread_count = 0;
+}
+
 static void destroy_alsa(struct SoundIoPrivate *si) {
     struct SoundIoAlsa *sia = &si->backend_data.alsa;
 
+    destroy_io_threads(sia);
+
     if (sia->thread) {
         SOUNDIO_ATOMIC_FLAG_CLEAR(sia->abort_flag);
         wakeup_device_poll(sia);
@@ -467,6 +549,17 @@ static int probe_device(struct SoundIoDevice *device, snd_pcm_chmap_query_t **ma
     return 0;
 }
 
+static int device_probe_alsa(struct SoundIoPrivate *si, struct SoundIoDevicePrivate *dev) {
+    struct SoundIoDevice *device = &dev->pub;
+    struct SoundIoDeviceAlsa *dva = &dev->backend_data.alsa;
+    snd_pcm_chmap_query_t **maps = NULL;
+    if (dva->card_index >= 0) {
+        maps = snd_pcm_query_chmaps_from_hw(dva->card_index, dva->device_index, -1,
+                aim_to_stream(device->aim));
+    }
+    return probe_device(device, maps);
+}
+
 static inline bool str_has_prefix(const char *big_str, const char *prefix) {
     return strncmp(big_str, prefix, strlen(prefix)) == 0;
 }
@@ -617,7 +710,12 @@ static int refresh_devices(struct SoundIoPrivate *si) {
                     devices_info->default_input_index = device_list->length;
             }
 
-            device->probe_error = probe_device(device, NULL);
+            dev->backend_data.alsa.card_index = -1;
+            dev->backend_data.alsa.device_index = -1;
+            if (soundio->lazy_device_probe)
+                dev->probe_pending = true;
+            else
+                device->probe_error = probe_device(device, NULL);
 
             if (SoundIoListDevicePtr_append(device_list, device)) {
                 soundio_device_unref(device);
@@ -738,8 +836,14 @@ static int refresh_devices(struct SoundIoPrivate *si) {
                     device_list = &devices_info->input_devices;
                 }
 
-                snd_pcm_chmap_query_t **maps = snd_pcm_query_chmaps_from_hw(card_index, device_index, -1, stream);
-                device->probe_error = probe_device(device, maps);
+                dev->backend_data.alsa.card_index = card_index;
+                dev->backend_data.alsa.device_index = device_index;
+                if (soundio->lazy_device_probe) {
+                    dev->probe_pending = true;
+                } else {
+                    snd_pcm_chmap_query_t **maps = snd_pcm_query_chmaps_from_hw(card_index, device_index, -1, stream);
+                    device->probe_error = probe_device(device, maps);
+                }
 
                 if (SoundIoListDevicePtr_append(device_list, device)) {
                     soundio_device_unref(device);
@@ -759,6 +863,7 @@ static int refresh_devices(struct SoundIoPrivate *si) {
     soundio_destroy_devices_info(sia->ready_devices_info);
     sia->ready_devices_info = devices_info;
     sia->have_devices_flag = true;
+    SOUNDIO_ATOMIC_FETCH_ADD(sia->event_generation, 1);
     soundio_os_cond_signal(sia->cond, sia->mutex);
     soundio->on_events_signal(soundio);
     soundio_os_mutex_unlock(sia->mutex);
@@ -770,6 +875,7 @@ static void shutdown_backend(struct SoundIoPrivate *si, int err) {
     struct SoundIoAlsa *sia = &si->backend_data.alsa;
     soundio_os_mutex_lock(sia->mutex);
     sia->shutdown_err = err;
+    SOUNDIO_ATOMIC_FETCH_ADD(sia->event_generation, 1);
     soundio_os_cond_signal(sia->cond, sia->mutex);
     soundio->on_events_signal(soundio);
     soundio_os_mutex_unlock(sia->mutex);
@@ -809,9 +915,22 @@ static void device_thread_run(void *arg) {
     fds[1].fd = sia->notify_pipe_fd[0];
     fds[1].events = POLLIN;
 
+    // hotplug events arrive in bursts; wait until they have been quiet for
+    // device_scan_debounce seconds and then rescan once. A device that never
+    // goes quiet delays the rescan by at most max_debounce_intervals of that.
+    static const double max_debounce_intervals = 4.0;
+    bool rescan_pending = false;
+    double rescan_deadline = 0.0;
+    double rescan_latest = 0.0;
+
     int err;
     for (;;) {
-        int poll_num = poll(fds, 2, -1);
+        int timeout = -1;
+        if (rescan_pending) {
+            double remaining = rescan_deadline - soundio_os_get_time();
+            timeout = (remaining > 0.0) ? ceil_dbl_to_int(remaining * 1000.0) : 0;
+        }
+        int poll_num = poll(fds, 2, timeout);
         if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(sia->abort_flag))
             break;
         if (poll_num == -1) {
@@ -824,10 +943,9 @@ static void device_thread_run(void *arg) {
             shutdown_backend(si, SoundIoErrorSystemResources);
             return;
         }
-        if (poll_num <= 0)
-            continue;
         bool got_rescan_event = false;
-        if (fds[0].revents & POLLIN) {
+        bool got_forced_rescan = false;
+        if (poll_num > 0 && (fds[0].revents & POLLIN)) {
             for (;;) {
                 ssize_t len = read(sia->notify_fd, buf, sizeof(buf));
                 if (len == -1) {
@@ -897,8 +1015,8 @@ static void device_thread_run(void *arg) {
                 }
             }
         }
-        if (fds[1].revents & POLLIN) {
-            got_rescan_event = true;
+        if (poll_num > 0 && (fds[1].revents & POLLIN)) {
+            got_forced_rescan = true;
             for (;;) {
                 ssize_t len = read(sia->notify_pipe_fd[0], buf, sizeof(buf));
                 if (len == -1) {
@@ -919,6 +1037,15 @@ static void device_thread_run(void *arg) {
             }
         }
         if (got_rescan_event) {
+            double now = soundio_os_get_time();
+            if (!rescan_pending) {
+                rescan_pending = true;
+                rescan_latest = now + max_debounce_intervals * si->pub.device_scan_debounce;
+            }
+            rescan_deadline = soundio_double_min(now + si->pub.device_scan_debounce, rescan_latest);
+        }
+        if (got_forced_rescan || (rescan_pending && soundio_os_get_time() >= rescan_deadline)) {
+            rescan_pending = false;
             if ((err = refresh_devices(si))) {
                 shutdown_backend(si, err);
                 return;
@@ -935,6 +1062,14 @@ static void my_flush_events(struct SoundIoPrivate *si, bool wait) {
     bool cb_shutdown = false;
     struct SoundIoDevicesInfo *old_devices_info = NULL;
 
+    // nothing happened since last time; don't bother with the mutex.
+    // generation 0 means the first scan has not completed, so we must block.
+    if (!wait && sia->seen_generation != 0 &&
+        SOUNDIO_ATOMIC_LOAD(sia->event_generation) == sia->seen_generation)
+    {
+        return;
+    }
+
     soundio_os_mutex_lock(sia->mutex);
 
     // block until have devices
@@ -943,6 +1078,8 @@ static void my_flush_events(struct SoundIoPrivate *si, bool wait) {
         wait = false;
     }
 
+    sia->seen_generation = SOUNDIO_ATOMIC_LOAD(sia->event_generation);
+
     if (sia->shutdown_err && !sia->emitted_shutdown_cb) {
         sia->emitted_shutdown_cb = true;
         cb_shutdown = true;
@@ -994,6 +1131,11 @@ static void outstream_destroy_alsa(struct SoundIoPrivate *si, struct SoundIoOutS
         osa->thread = NULL;
     }
 
+    if (osa->io.io_thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(osa->thread_exit_flag);
+        io_thread_remove_stream(&osa->io);
+    }
+
     if (osa->handle) {
         snd_pcm_close(osa->handle);
         osa->handle = NULL;
@@ -1009,11 +1151,67 @@ static void outstream_destroy_alsa(struct SoundIoPrivate *si, struct SoundIoOutS
     osa->sample_buffer = NULL;
 }
 
+static double htstamp_to_seconds(const snd_htimestamp_t *ts) {
+    return ts->tv_sec + ts->tv_nsec / 1000000000.0;
+}
+
+// Returns how many frames worth of time passed between the stream stopping
+// due to an xrun and now. `out_avail` receives the frames left in the buffer.
+static int64_t measure_xrun(snd_pcm_t *handle, int sample_rate, snd_pcm_uframes_t *out_avail) {
+    *out_avail = 0;
+
+    snd_pcm_status_t *status;
+    snd_pcm_status_alloca(&status);
+    if (snd_pcm_status(handle, status) < 0)
+        return 0;
+    *out_avail = snd_pcm_status_get_avail(status);
+
+    // when the stream is not running, the status timestamp is the current time
+    snd_htimestamp_t now, trigger;
+    snd_pcm_status_get_htstamp(status, &now);
+    snd_pcm_status_get_trigger_htstamp(status, &trigger);
+    if (!(now.tv_sec || now.tv_nsec) || !(trigger.tv_sec || trigger.tv_nsec))
+        return 0;
+
+    double gap = htstamp_to_seconds(&now) - htstamp_to_seconds(&trigger);
+    if (gap <= 0.0)
+        return 0;
+    return (int64_t)(gap * sample_rate + 0.5);
+}
+
+// The hardware position restarts from zero on every prepare, so remember how
+// many frames we had transferred at that point.
+static int outstream_prepare(struct SoundIoOutStreamAlsa *osa) {
+    int err;
+    if ((err = snd_pcm_prepare(osa->handle)) < 0)
+        return err;
+    osa->prepare_frame = osa->frames_written;
+    osa->state = SND_PCM_STATE_PREPARED;
+    return 0;
+}
+
+static int instream_prepare(struct SoundIoInStreamAlsa *isa) {
+    int err;
+    if ((err = snd_pcm_prepare(isa->handle)) < 0)
+        return err;
+    isa->prepare_frame = isa->frames_read;
+    isa->state = SND_PCM_STATE_PREPARED;
+    return 0;
+}
+
 static int outstream_xrun_recovery(struct SoundIoOutStreamPrivate *os, int err) {
     struct SoundIoOutStream *outstream = &os->pub;
     struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+    if (err == -EPIPE || err == -ESTRPIPE) {
+        // The buffer had run dry when the stream stopped, so only the time
+        // spent stopped is lost.
+        snd_pcm_uframes_t avail;
+        int64_t lost = measure_xrun(osa->handle, outstream->sample_rate, &avail);
+        osa->frames_written += lost;
+        outstream->underflow_frame_count += lost;
+    }
     if (err == -EPIPE) {
-        err = snd_pcm_prepare(osa->handle);
+        err = outstream_prepare(osa);
         if (err >= 0)
             outstream->underflow_callback(outstream);
     } else if (err == -ESTRPIPE) {
@@ -1022,7 +1220,9 @@ static int outstream_xrun_recovery(struct SoundIoOutStreamPrivate *os, int err)
             poll(NULL, 0, 1);
         }
         if (err < 0)
-            err = snd_pcm_prepare(osa->handle);
+            err = outstream_prepare(osa);
+        else
+            osa->state = SND_PCM_STATE_RUNNING;
         if (err >= 0)
             outstream->underflow_callback(outstream);
     }
@@ -1032,8 +1232,16 @@ static int outstream_xrun_recovery(struct SoundIoOutStreamPrivate *os, int err)
 static int instream_xrun_recovery(struct SoundIoInStreamPrivate *is, int err) {
     struct SoundIoInStream *instream = &is->pub;
     struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
+    // Everything the device would have captured while stopped is lost, and
+    // so is whatever was still unread if the stream has to be prepared again.
+    snd_pcm_uframes_t avail = 0;
+    int64_t lost = 0;
+    if (err == -EPIPE || err == -ESTRPIPE)
+        lost = measure_xrun(isa->handle, instream->sample_rate, &avail);
     if (err == -EPIPE) {
-        err = snd_pcm_prepare(isa->handle);
+        isa->frames_read += lost + avail;
+        instream->overflow_frame_count += lost + avail;
+        err = instream_prepare(isa);
         if (err >= 0)
             instream->overflow_callback(instream);
     } else if (err == -ESTRPIPE) {
@@ -1042,7 +1250,13 @@ static int instream_xrun_recovery(struct SoundIoInStreamPrivate *is, int err) {
             poll(NULL, 0, 1);
         }
         if (err < 0)
-            err = snd_pcm_prepare(isa->handle);
+            lost += avail;
+        isa->frames_read += lost;
+        instream->overflow_frame_count += lost;
+        if (err < 0)
+            err = instream_prepare(isa);
+        else
+            isa->state = SND_PCM_STATE_RUNNING;
         if (err >= 0)
             instream->overflow_callback(instream);
     }
@@ -1065,6 +1279,7 @@ static int outstream_wait_for_poll(struct SoundIoOutStreamPrivate *os) {
             return SoundIoErrorStreaming;
         }
         if (revents & (POLLERR|POLLNVAL|POLLHUP)) {
+            osa->state = snd_pcm_state(osa->handle);
             return 0;
         }
         if (revents & POLLOUT)
@@ -1086,6 +1301,7 @@ static int instream_wait_for_poll(struct SoundIoInStreamPrivate *is) {
             return err;
         }
         if (revents & (POLLERR|POLLNVAL|POLLHUP)) {
+            isa->state = snd_pcm_state(isa->handle);
             return 0;
         }
         if (revents & POLLIN)
@@ -1093,69 +1309,74 @@ static int instream_wait_for_poll(struct SoundIoInStreamPrivate *is) {
     }
 }
 
-static void outstream_thread_run(void *arg) {
-    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *) arg;
+// Does all the work for the stream that does not involve waiting on its poll
+// descriptors. `ready` tells whether the poll descriptors just signaled.
+// The PCM state is tracked in `state` rather than queried on every iteration;
+// ALSA is only asked for it when the poll descriptors report an error, and
+// otherwise the error codes of snd_pcm_avail_update tell about xruns.
+// Returns 0 when it is time to wait on the poll descriptors again,
+// SoundIoErrorInterrupted if the stream is being destroyed, or an error that
+// should be reported to the error callback.
+static int outstream_process(struct SoundIoOutStreamPrivate *os, bool ready) {
     struct SoundIoOutStream *outstream = &os->pub;
     struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
 
     int err;
 
     for (;;) {
-        snd_pcm_state_t state = snd_pcm_state(osa->handle);
-        switch (state) {
+        switch (osa->state) {
             case SND_PCM_STATE_SETUP:
             {
-                if ((err = snd_pcm_prepare(osa->handle)) < 0) {
-                    outstream->error_callback(outstream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = outstream_prepare(osa)) < 0)
+                    return SoundIoErrorStreaming;
                 continue;
             }
             case SND_PCM_STATE_PREPARED:
             {
-                snd_pcm_sframes_t avail = snd_pcm_avail(osa->handle);
-                if (avail < 0) {
-                    outstream->error_callback(outstream, SoundIoErrorStreaming);
-                    return;
-                }
+                // the hardware pointer does not move until the stream is
+                // started, so there is no need to sync with it
+                snd_pcm_sframes_t avail = snd_pcm_avail_update(osa->handle);
+                if (avail < 0)
+                    return SoundIoErrorStreaming;
 
                 if ((snd_pcm_uframes_t)avail == osa->buffer_size_frames) {
+                    int64_t frames_written = osa->frames_written;
                     outstream->write_callback(outstream, 0, avail);
                     if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osa->thread_exit_flag))
-                        return;
+                        return SoundIoErrorInterrupted;
+                    // let others have a turn before asking again
+                    if (osa->frames_written == frames_written)
+                        return 0;
                     continue;
                 }
 
-                if ((err = snd_pcm_start(osa->handle)) < 0) {
-                    outstream->error_callback(outstream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = snd_pcm_start(osa->handle)) < 0)
+                    return SoundIoErrorStreaming;
+                osa->state = SND_PCM_STATE_RUNNING;
                 continue;
             }
             case SND_PCM_STATE_RUNNING:
             case SND_PCM_STATE_PAUSED:
             {
-                if ((err = outstream_wait_for_poll(os))) {
-                    if (err == SoundIoErrorInterrupted)
-                        return;
-                    outstream->error_callback(outstream, err);
-                    return;
-                }
-                if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osa->thread_exit_flag))
-                    return;
+                if (!ready)
+                    return 0;
+                ready = false;
+
                 if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osa->clear_buffer_flag)) {
-                    if ((err = snd_pcm_drop(osa->handle)) < 0) {
-                        outstream->error_callback(outstream, SoundIoErrorStreaming);
-                        return;
-                    }
+                    // whatever is still queued will never be heard
+                    snd_pcm_sframes_t delay;
+                    if (snd_pcm_delay(osa->handle, &delay) >= 0 && delay > 0)
+                        osa->frames_written -= delay;
+                    if ((err = snd_pcm_drop(osa->handle)) < 0)
+                        return SoundIoErrorStreaming;
+                    osa->state = SND_PCM_STATE_SETUP;
                     if ((err = snd_pcm_reset(osa->handle)) < 0) {
                         if (err == -EBADFD) {
                             // If this happens the snd_pcm_drop will have done
                             // the function of the reset so it's ok that this
                             // did not work.
                         } else {
-                            outstream->error_callback(outstream, SoundIoErrorStreaming);
-                            return;
+                            return SoundIoErrorStreaming;
                         }
                     }
                     continue;
@@ -1163,10 +1384,20 @@ static void outstream_thread_run(void *arg) {
 
                 snd_pcm_sframes_t avail = snd_pcm_avail_update(osa->handle);
                 if (avail < 0) {
-                    if ((err = outstream_xrun_recovery(os, avail)) < 0) {
-                        outstream->error_callback(outstream, SoundIoErrorStreaming);
-                        return;
-                    }
+                    if ((err = outstream_xrun_recovery(os, avail)) < 0)
+                        return SoundIoErrorStreaming;
+                    continue;
+                }
+
+                if (outstream->preserve_clock_on_xrun && (snd_pcm_uframes_t)avail > osa->buffer_size_frames) {
+                    // Free-running underflow: the hardware has played past
+                    // the end of our data. Catch up with it.
+                    snd_pcm_sframes_t skipped = snd_pcm_forward(osa->handle, avail - osa->buffer_size_frames);
+                    if (skipped < 0)
+                        return SoundIoErrorStreaming;
+                    osa->frames_written += skipped;
+                    outstream->underflow_frame_count += skipped;
+                    outstream->underflow_callback(outstream);
                     continue;
                 }
 
@@ -1175,67 +1406,89 @@ static void outstream_thread_run(void *arg) {
                 continue;
             }
             case SND_PCM_STATE_XRUN:
-                if ((err = outstream_xrun_recovery(os, -EPIPE)) < 0) {
-                    outstream->error_callback(outstream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = outstream_xrun_recovery(os, -EPIPE)) < 0)
+                    return SoundIoErrorStreaming;
                 continue;
             case SND_PCM_STATE_SUSPENDED:
-                if ((err = outstream_xrun_recovery(os, -ESTRPIPE)) < 0) {
-                    outstream->error_callback(outstream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = outstream_xrun_recovery(os, -ESTRPIPE)) < 0)
+                    return SoundIoErrorStreaming;
                 continue;
             case SND_PCM_STATE_OPEN:
             case SND_PCM_STATE_DRAINING:
             case SND_PCM_STATE_DISCONNECTED:
-                outstream->error_callback(outstream, SoundIoErrorStreaming);
+                return SoundIoErrorStreaming;
+        }
+    }
+}
+
+static void outstream_thread_run(void *arg) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *) arg;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+
+    int err;
+    bool ready = false;
+
+    for (;;) {
+        if ((err = outstream_process(os, ready))) {
+            if (err != SoundIoErrorInterrupted)
+                outstream->error_callback(outstream, err);
+            return;
+        }
+        if ((err = outstream_wait_for_poll(os))) {
+            if (err == SoundIoErrorInterrupted)
                 return;
+            outstream->error_callback(outstream, err);
+            return;
         }
+        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osa->thread_exit_flag))
+            return;
+        ready = true;
     }
 }
 
-static void instream_thread_run(void *arg) {
-    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *) arg;
+// See outstream_process.
+static int instream_process(struct SoundIoInStreamPrivate *is, bool ready) {
     struct SoundIoInStream *instream = &is->pub;
     struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
 
     int err;
 
     for (;;) {
-        snd_pcm_state_t state = snd_pcm_state(isa->handle);
-        switch (state) {
+        switch (isa->state) {
             case SND_PCM_STATE_SETUP:
-                if ((err = snd_pcm_prepare(isa->handle)) < 0) {
-                    instream->error_callback(instream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = instream_prepare(isa)) < 0)
+                    return SoundIoErrorStreaming;
                 continue;
             case SND_PCM_STATE_PREPARED:
-                if ((err = snd_pcm_start(isa->handle)) < 0) {
-                    instream->error_callback(instream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = snd_pcm_start(isa->handle)) < 0)
+                    return SoundIoErrorStreaming;
+                isa->state = SND_PCM_STATE_RUNNING;
                 continue;
             case SND_PCM_STATE_RUNNING:
             case SND_PCM_STATE_PAUSED:
             {
-                if ((err = instream_wait_for_poll(is)) < 0) {
-                    if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isa->thread_exit_flag))
-                        return;
-                    instream->error_callback(instream, SoundIoErrorStreaming);
-                    return;
-                }
-                if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isa->thread_exit_flag))
-                    return;
+                if (!ready)
+                    return 0;
+                ready = false;
 
                 snd_pcm_sframes_t avail = snd_pcm_avail_update(isa->handle);
 
                 if (avail < 0) {
-                    if ((err = instream_xrun_recovery(is, avail)) < 0) {
-                        instream->error_callback(instream, SoundIoErrorStreaming);
-                        return;
-                    }
+                    if ((err = instream_xrun_recovery(is, avail)) < 0)
+                        return SoundIoErrorStreaming;
+                    continue;
+                }
+
+                if (instream->preserve_clock_on_xrun && (snd_pcm_uframes_t)avail > isa->buffer_size_frames) {
+                    // Free-running overflow: the hardware has overwritten
+                    // frames we had not read yet. Skip past them.
+                    snd_pcm_sframes_t skipped = snd_pcm_forward(isa->handle, avail - isa->buffer_size_frames);
+                    if (skipped < 0)
+                        return SoundIoErrorStreaming;
+                    isa->frames_read += skipped;
+                    instream->overflow_frame_count += skipped;
+                    instream->overflow_callback(instream);
                     continue;
                 }
 
@@ -1244,26 +1497,485 @@ static void instream_thread_run(void *arg) {
                 continue;
             }
             case SND_PCM_STATE_XRUN:
-                if ((err = instream_xrun_recovery(is, -EPIPE)) < 0) {
-                    instream->error_callback(instream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = instream_xrun_recovery(is, -EPIPE)) < 0)
+                    return SoundIoErrorStreaming;
                 continue;
             case SND_PCM_STATE_SUSPENDED:
-                if ((err = instream_xrun_recovery(is, -ESTRPIPE)) < 0) {
-                    instream->error_callback(instream, SoundIoErrorStreaming);
-                    return;
-                }
+                if ((err = instream_xrun_recovery(is, -ESTRPIPE)) < 0)
+                    return SoundIoErrorStreaming;
                 continue;
             case SND_PCM_STATE_OPEN:
             case SND_PCM_STATE_DRAINING:
             case SND_PCM_STATE_DISCONNECTED:
-                instream->error_callback(instream, SoundIoErrorStreaming);
+                return SoundIoErrorStreaming;
+        }
+    }
+}
+
+static void instream_thread_run(void *arg) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *) arg;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
+
+    int err;
+    bool ready = false;
+
+    for (;;) {
+        if ((err = instream_process(is, ready))) {
+            instream->error_callback(instream, err);
+            return;
+        }
+        if ((err = instream_wait_for_poll(is)) < 0) {
+            if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isa->thread_exit_flag))
                 return;
+            instream->error_callback(instream, SoundIoErrorStreaming);
+            return;
+        }
+        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isa->thread_exit_flag))
+            return;
+        ready = true;
+    }
+}
+
+static uint32_t poll_events_to_epoll(short events) {
+    uint32_t result = 0;
+    if (events & POLLIN)
+        result |= EPOLLIN;
+    if (events & POLLOUT)
+        result |= EPOLLOUT;
+    if (events & POLLPRI)
+        result |= EPOLLPRI;
+    return result;
+}
+
+// Called by the I/O thread while the stream is busy, without the mutex.
+static void io_stream_dispatch(struct SoundIoAlsaIoStream *ios, bool ready) {
+    int err = 0;
+    if (ready) {
+        // epoll only tells us that some descriptor woke up; ALSA has to
+        // translate the full set of revents.
+        unsigned short revents;
+        if (poll(ios->poll_fds, ios->poll_fd_count, 0) < 0) {
+            err = SoundIoErrorStreaming;
+        } else if (snd_pcm_poll_descriptors_revents(ios->handle,
+                    ios->poll_fds, ios->poll_fd_count, &revents) < 0)
+        {
+            err = SoundIoErrorStreaming;
+        } else if (revents & (POLLERR|POLLNVAL|POLLHUP)) {
+            snd_pcm_state_t state = snd_pcm_state(ios->handle);
+            if (ios->os)
+                ios->os->backend_data.alsa.state = state;
+            else
+                ios->is->backend_data.alsa.state = state;
+        } else {
+            unsigned short wanted = ios->os ? POLLOUT : POLLIN;
+            if (!(revents & wanted))
+                return;
+        }
+    }
+
+    if (!err)
+        err = ios->os ? outstream_process(ios->os, ready) : instream_process(ios->is, ready);
+    if (!err)
+        return;
+
+    io_stream_unregister_fds(ios, ios->poll_fd_count);
+    ios->dead = true;
+
+    if (err == SoundIoErrorInterrupted)
+        return;
+    if (ios->os)
+        ios->os->pub.error_callback(&ios->os->pub, err);
+    else
+        ios->is->pub.error_callback(&ios->is->pub, err);
+}
+
+static bool io_thread_has_stream(struct SoundIoAlsaIoThread *iot, struct SoundIoAlsaIoStream *ios) {
+    for (int i = 0; i < iot->streams.length; i += 1) {
+        if (SoundIoListAlsaIoStreamPtr_val_at(&iot->streams, i) == ios)
+            return true;
+    }
+    return false;
+}
+
+// Called with the I/O thread mutex held.
+static void io_thread_queue_dispatch(struct SoundIoAlsaIoThread *iot, struct SoundIoAlsaIoStream *ios,
+        bool ready, bool kick)
+{
+    struct SoundIoAlsaIoDispatch *dispatch = NULL;
+    for (int i = 0; i < iot->dispatch.length; i += 1) {
+        if (SoundIoListAlsaIoDispatch_ptr_at(&iot->dispatch, i)->ios == ios) {
+            dispatch = SoundIoListAlsaIoDispatch_ptr_at(&iot->dispatch, i);
+            break;
+        }
+    }
+    if (!dispatch) {
+        // each stream is queued at most once, and there is room for all
+        int err = SoundIoListAlsaIoDispatch_add_one(&iot->dispatch);
+        assert(!err);
+        (void)err;
+        dispatch = SoundIoListAlsaIoDispatch_last_ptr(&iot->dispatch);
+        dispatch->ios = ios;
+        dispatch->ready = false;
+        dispatch->kick = false;
+    }
+    dispatch->ready = dispatch->ready || ready;
+    dispatch->kick = dispatch->kick || kick;
+}
+
+static void io_thread_run(void *arg) {
+    struct SoundIoAlsaIoThread *iot = (struct SoundIoAlsaIoThread *)arg;
+
+    if (iot->cpu >= 0) {
+        // best effort; if this fails we run wherever the scheduler puts us
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(iot->cpu, &cpu_set);
+        sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+    }
+
+    struct epoll_event events[32];
+    char buf[64];
+
+    for (;;) {
+        int event_count = epoll_wait(iot->epoll_fd, events, ARRAY_LENGTH(events), -1);
+        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(iot->abort_flag))
+            return;
+        if (event_count < 0) {
+            assert(errno == EINTR);
+            continue;
+        }
+
+        // Decide what to service with the mutex held, then run the streams
+        // without it, so that callbacks may start and destroy streams and a
+        // slow one does not hold up destroying the others.
+        soundio_os_mutex_lock(iot->mutex);
+        SoundIoListAlsaIoDispatch_clear(&iot->dispatch);
+        for (int i = 0; i < event_count; i += 1) {
+            struct SoundIoAlsaIoStream *ios = (struct SoundIoAlsaIoStream *)events[i].data.ptr;
+            if (!ios) {
+                while (read(iot->wake_pipe_fd[0], buf, sizeof(buf)) > 0) {}
+                continue;
+            }
+            // the stream might have been removed after epoll_wait returned
+            if (!io_thread_has_stream(iot, ios) || ios->dead)
+                continue;
+            io_thread_queue_dispatch(iot, ios, true, false);
+        }
+        // newly started streams need to prepare and fill their buffer before
+        // there is anything to wait for
+        for (int i = 0; i < iot->streams.length; i += 1) {
+            struct SoundIoAlsaIoStream *ios = SoundIoListAlsaIoStreamPtr_val_at(&iot->streams, i);
+            if (ios->needs_kick && !ios->dead) {
+                ios->needs_kick = false;
+                io_thread_queue_dispatch(iot, ios, false, true);
+            }
+        }
+        soundio_os_mutex_unlock(iot->mutex);
+
+        for (int i = 0; i < iot->dispatch.length; i += 1) {
+            // Starting a stream may move the list, so copy the entry. An
+            // earlier callback might have destroyed the stream.
+            soundio_os_mutex_lock(iot->mutex);
+            struct SoundIoAlsaIoDispatch dispatch = SoundIoListAlsaIoDispatch_val_at(&iot->dispatch, i);
+            struct SoundIoAlsaIoStream *ios = dispatch.ios;
+            bool present = io_thread_has_stream(iot, ios) && !ios->dead;
+            if (present)
+                ios->busy = true;
+            soundio_os_mutex_unlock(iot->mutex);
+            if (!present)
+                continue;
+
+            if (dispatch.ready)
+                io_stream_dispatch(ios, true);
+            if (dispatch.kick && !ios->dead)
+                io_stream_dispatch(ios, false);
+
+            soundio_os_mutex_lock(iot->mutex);
+            ios->busy = false;
+            soundio_os_cond_signal(iot->cond, iot->mutex);
+            soundio_os_mutex_unlock(iot->mutex);
         }
     }
 }
 
+static int io_thread_add_stream(struct SoundIoAlsa *sia, struct SoundIoAlsaIoStream *ios) {
+    // only this thread modifies the stream lists, so reading the lengths
+    // without the lock is fine
+    struct SoundIoAlsaIoThread *iot = &sia->io_threads[0];
+    for (int i = 1; i < sia->io_thread_count; i += 1) {
+        if (sia->io_threads[i].streams.length < iot->streams.length)
+            iot = &sia->io_threads[i];
+    }
+
+    ios->io_thread = iot;
+    ios->needs_kick = true;
+    ios->dead = false;
+    ios->busy = false;
+
+    soundio_os_mutex_lock(iot->mutex);
+    if (SoundIoListAlsaIoDispatch_ensure_capacity(&iot->dispatch, iot->streams.length + 1) ||
+        SoundIoListAlsaIoStreamPtr_append(&iot->streams, ios))
+    {
+        soundio_os_mutex_unlock(iot->mutex);
+        ios->io_thread = NULL;
+        return SoundIoErrorNoMem;
+    }
+    for (int i = 0; i < ios->poll_fd_count; i += 1) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = poll_events_to_epoll(ios->poll_fds[i].events);
+        event.data.ptr = ios;
+        if (epoll_ctl(iot->epoll_fd, EPOLL_CTL_ADD, ios->poll_fds[i].fd, &event) < 0) {
+            io_stream_unregister_fds(ios, i);
+            SoundIoListAlsaIoStreamPtr_pop(&iot->streams);
+            soundio_os_mutex_unlock(iot->mutex);
+            ios->io_thread = NULL;
+            return SoundIoErrorSystemResources;
+        }
+    }
+    soundio_os_mutex_unlock(iot->mutex);
+
+    wakeup_io_thread(iot);
+    return 0;
+}
+
+static int init_io_threads(struct SoundIoPrivate *si, int count) {
+    struct SoundIoAlsa *sia = &si->backend_data.alsa;
+    struct SoundIo *soundio = &si->pub;
+
+    sia->io_threads = ALLOCATE(struct SoundIoAlsaIoThread, count);
+    if (!sia->io_threads)
+        return SoundIoErrorNoMem;
+    sia->io_thread_count = count;
+
+    for (int i = 0; i < count; i += 1) {
+        struct SoundIoAlsaIoThread *iot = &sia->io_threads[i];
+        iot->epoll_fd = -1;
+        iot->wake_pipe_fd[0] = -1;
+        iot->wake_pipe_fd[1] = -1;
+    }
+
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 0; i < count; i += 1) {
+        struct SoundIoAlsaIoThread *iot = &sia->io_threads[i];
+        iot->cpu = (count > 1 && cpu_count > 0) ? (int)(i % cpu_count) : -1;
+        SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(iot->abort_flag);
+
+        iot->mutex = soundio_os_mutex_create();
+        if (!iot->mutex)
+            return SoundIoErrorNoMem;
+
+        iot->cond = soundio_os_cond_create();
+        if (!iot->cond)
+            return SoundIoErrorNoMem;
+
+        iot->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (iot->epoll_fd == -1) {
+            assert(errno != EINVAL);
+            return SoundIoErrorSystemResources;
+        }
+
+        if (pipe2(iot->wake_pipe_fd, O_NONBLOCK)) {
+            assert(errno != EFAULT);
+            assert(errno != EINVAL);
+            assert(errno == EMFILE || errno == ENFILE);
+            return SoundIoErrorSystemResources;
+        }
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+        if (epoll_ctl(iot->epoll_fd, EPOLL_CTL_ADD, iot->wake_pipe_fd[0], &event) < 0)
+            return SoundIoErrorSystemResources;
+
+        int err;
+        if ((err = soundio_os_thread_create(io_thread_run, iot, soundio->emit_rtprio_warning,
+                        &soundio->thread_policy, 0, &iot->thread)))
+            return err;
+    }
+
+    return 0;
+}
+
+// Lets the hardware pointer run past the application pointer instead of
+// stopping the stream on xrun. For playback, the area already played is
+// filled with silence so that stale samples are not repeated.
+static int set_free_running_params(snd_pcm_t *handle, snd_pcm_sw_params_t *swparams, bool playback) {
+    int err;
+    snd_pcm_uframes_t boundary;
+    if ((err = snd_pcm_sw_params_get_boundary(swparams, &boundary)) < 0)
+        return err;
+    if ((err = snd_pcm_sw_params_set_stop_threshold(handle, swparams, boundary)) < 0)
+        return err;
+    if (playback) {
+        if ((err = snd_pcm_sw_params_set_silence_threshold(handle, swparams, 0)) < 0)
+            return err;
+        if ((err = snd_pcm_sw_params_set_silence_size(handle, swparams, boundary)) < 0)
+            return err;
+    }
+    return 0;
+}
+
+// Returns whether status timestamps will be taken from CLOCK_MONOTONIC.
+static bool set_tstamp_params(snd_pcm_t *handle, snd_pcm_sw_params_t *swparams) {
+    if (snd_pcm_sw_params_set_tstamp_mode(handle, swparams, SND_PCM_TSTAMP_ENABLE) < 0)
+        return false;
+    return snd_pcm_sw_params_set_tstamp_type(handle, swparams, SND_PCM_TSTAMP_TYPE_MONOTONIC) >= 0;
+}
+
+// Takes a snapshot of the PCM status. `out_delay` is the delay at the time
+// of `out_timestamp`. If the device reports a link timestamp, `out_link_frames`
+// is the number of frames that passed the link since the stream was
+// triggered, otherwise it is -1.
+static int get_status_position(snd_pcm_t *handle, int sample_rate, bool monotonic_tstamp,
+        bool link_tstamp, snd_pcm_sframes_t *out_delay, int64_t *out_link_frames,
+        double *out_timestamp)
+{
+    snd_pcm_status_t *status;
+    snd_pcm_status_alloca(&status);
+
+    if (link_tstamp) {
+        snd_pcm_audio_tstamp_config_t config;
+        memset(&config, 0, sizeof(config));
+        config.type_requested = SND_PCM_AUDIO_TSTAMP_TYPE_LINK;
+        config.report_delay = 1;
+        snd_pcm_status_set_audio_htstamp_config(status, &config);
+    }
+
+    if (snd_pcm_status(handle, status) < 0)
+        return SoundIoErrorStreaming;
+
+    *out_delay = snd_pcm_status_get_delay(status);
+    *out_link_frames = -1;
+
+    if (link_tstamp && snd_pcm_status_get_state(status) == SND_PCM_STATE_RUNNING) {
+        snd_pcm_audio_tstamp_report_t report;
+        snd_pcm_status_get_audio_htstamp_report(status, &report);
+        if (report.valid && report.actual_type != SND_PCM_AUDIO_TSTAMP_TYPE_COMPAT &&
+            report.actual_type != SND_PCM_AUDIO_TSTAMP_TYPE_DEFAULT)
+        {
+            snd_htimestamp_t audio_tstamp;
+            snd_pcm_status_get_audio_htstamp(status, &audio_tstamp);
+            *out_link_frames = (int64_t)(htstamp_to_seconds(&audio_tstamp) * sample_rate + 0.5);
+        }
+    }
+
+    // htstamp is when the hardware pointer that the delay is based on was read
+    snd_htimestamp_t htstamp;
+    snd_pcm_status_get_htstamp(status, &htstamp);
+    if (monotonic_tstamp && (htstamp.tv_sec || htstamp.tv_nsec))
+        *out_timestamp = htstamp_to_seconds(&htstamp);
+    else
+        *out_timestamp = soundio_os_get_time();
+    return 0;
+}
+
+static bool chmap_matches_layout(const snd_pcm_chmap_query_t *query,
+        const struct SoundIoChannelLayout *layout)
+{
+    if ((int)query->map.channels != layout->channel_count)
+        return false;
+    for (int i = 0; i < layout->channel_count; i += 1) {
+        unsigned int pos = to_alsa_chmap_pos(layout->channels[i]);
+        if (query->type == SND_CHMAP_TYPE_VAR) {
+            // any order can be set
+            bool found = false;
+            for (unsigned int j = 0; j < query->map.channels; j += 1) {
+                if (query->map.pos[j] == pos) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+                return false;
+        } else if (query->map.pos[i] != pos) {
+            // fixed, or only swappable in pairs; take it as it is
+            return false;
+        }
+    }
+    return true;
+}
+
+// Without a plugin nobody reorders the channels, so the raw device is only
+// good for a layout that it has a channel map for.
+static bool raw_pcm_accepts(snd_pcm_t *handle, snd_pcm_format_t format,
+        unsigned int sample_rate, const struct SoundIoChannelLayout *layout)
+{
+    snd_pcm_hw_params_t *hwparams;
+    snd_pcm_hw_params_alloca(&hwparams);
+    if (snd_pcm_hw_params_any(handle, hwparams) < 0)
+        return false;
+    if (snd_pcm_hw_params_test_format(handle, hwparams, format) != 0 ||
+        snd_pcm_hw_params_test_rate(handle, hwparams, sample_rate, 0) != 0 ||
+        snd_pcm_hw_params_test_channels(handle, hwparams, layout->channel_count) != 0)
+    {
+        return false;
+    }
+
+    snd_pcm_chmap_query_t **maps = snd_pcm_query_chmaps(handle);
+    if (!maps)
+        return false;
+    bool matched = false;
+    for (snd_pcm_chmap_query_t **p = maps; *p; p += 1) {
+        if (chmap_matches_layout(*p, layout)) {
+            matched = true;
+            break;
+        }
+    }
+    snd_pcm_free_chmaps(maps);
+    return matched;
+}
+
+// Opens the PCM of a stream. With `prefer_raw`, a plugin device is replaced
+// by the hw: device it ends up at, if that one takes the stream parameters
+// without conversion. `*opened_raw` is set to true when that happens.
+static int open_stream_pcm(struct SoundIoDevice *device, snd_pcm_stream_t stream, bool prefer_raw,
+        snd_pcm_format_t format, int sample_rate, const struct SoundIoChannelLayout *layout,
+        snd_pcm_t **out_handle, bool *opened_raw)
+{
+    int err;
+    if ((err = snd_pcm_open(out_handle, device->id, stream, 0)) < 0)
+        return err;
+
+    if (!prefer_raw || device->is_raw)
+        return 0;
+
+    snd_pcm_info_t *info;
+    snd_pcm_info_alloca(&info);
+    if (snd_pcm_info(*out_handle, info) < 0)
+        return 0;
+    int card_index = snd_pcm_info_get_card(info);
+    if (card_index < 0) {
+        // not backed by a sound card, for example the PulseAudio plugin
+        return 0;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "hw:%d,%u", card_index, snd_pcm_info_get_device(info));
+
+    // The plugins might be holding the hw: device open themselves.
+    snd_pcm_close(*out_handle);
+    *out_handle = NULL;
+
+    // Opening in blocking mode would wait for whoever else is using the
+    // device to let go of it.
+    snd_pcm_t *raw_handle;
+    if (snd_pcm_open(&raw_handle, name, stream, SND_PCM_NONBLOCK) >= 0) {
+        if (raw_pcm_accepts(raw_handle, format, sample_rate, layout) &&
+            snd_pcm_nonblock(raw_handle, 0) >= 0)
+        {
+            *out_handle = raw_handle;
+            *opened_raw = true;
+            return 0;
+        }
+        snd_pcm_close(raw_handle);
+    }
+
+    return snd_pcm_open(out_handle, device->id, stream, 0);
+}
+
 static int outstream_open_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
     struct SoundIoOutStream *outstream = &os->pub;
@@ -1291,7 +2003,10 @@ static int outstream_open_alsa(struct SoundIoPrivate *si, struct SoundIoOutStrea
 
     snd_pcm_stream_t stream = aim_to_stream(outstream->device->aim);
 
-    if ((err = snd_pcm_open(&osa->handle, outstream->device->id, stream, 0)) < 0) {
+    if ((err = open_stream_pcm(outstream->device, stream, outstream->prefer_raw,
+                    to_alsa_fmt(outstream->format), outstream->sample_rate, &outstream->layout,
+                    &osa->handle, &outstream->opened_raw)) < 0)
+    {
         outstream_destroy_alsa(si, os);
         return SoundIoErrorOpeningDevice;
     }
@@ -1301,7 +2016,7 @@ static int outstream_open_alsa(struct SoundIoPrivate *si, struct SoundIoOutStrea
         return SoundIoErrorOpeningDevice;
     }
 
-    int want_resample = !outstream->device->is_raw;
+    int want_resample = !outstream->opened_raw;
     if ((err = snd_pcm_hw_params_set_rate_resample(osa->handle, hwparams, want_resample)) < 0) {
         outstream_destroy_alsa(si, os);
         return SoundIoErrorOpeningDevice;
@@ -1380,6 +2095,16 @@ static int outstream_open_alsa(struct SoundIoPrivate *si, struct SoundIoOutStrea
         return SoundIoErrorOpeningDevice;
     }
 
+    if (outstream->preserve_clock_on_xrun) {
+        if ((err = set_free_running_params(osa->handle, swparams, true)) < 0) {
+            outstream_destroy_alsa(si, os);
+            return SoundIoErrorOpeningDevice;
+        }
+    }
+
+    osa->monotonic_tstamp = set_tstamp_params(osa->handle, swparams);
+    osa->link_tstamp = snd_pcm_hw_params_supports_audio_ts_type(hwparams, SND_PCM_AUDIO_TSTAMP_TYPE_LINK);
+
     // write the software parameters to device
     if ((err = snd_pcm_sw_params(osa->handle, swparams)) < 0) {
         outstream_destroy_alsa(si, os);
@@ -1388,11 +2113,14 @@ static int outstream_open_alsa(struct SoundIoPrivate *si, struct SoundIoOutStrea
 
     if (osa->access == SND_PCM_ACCESS_RW_INTERLEAVED || osa->access == SND_PCM_ACCESS_RW_NONINTERLEAVED) {
         osa->sample_buffer_size = ch_count * osa->period_size * phys_bytes_per_sample;
-        osa->sample_buffer = ALLOCATE_NONZERO(char, osa->sample_buffer_size);
-        if (!osa->sample_buffer) {
-            outstream_destroy_alsa(si, os);
-            return SoundIoErrorNoMem;
-        }
+    } else {
+        // only used when a write wraps around the end of the mmap buffer
+        osa->sample_buffer_size = ch_count * osa->buffer_size_frames * phys_bytes_per_sample;
+    }
+    osa->sample_buffer = ALLOCATE_NONZERO(char, osa->sample_buffer_size);
+    if (!osa->sample_buffer) {
+        outstream_destroy_alsa(si, os);
+        return SoundIoErrorNoMem;
     }
 
     osa->poll_fd_count = snd_pcm_poll_descriptors_count(osa->handle);
@@ -1429,13 +2157,27 @@ static int outstream_open_alsa(struct SoundIoPrivate *si, struct SoundIoOutStrea
 
 static int outstream_start_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+    struct SoundIoAlsa *sia = &si->backend_data.alsa;
     struct SoundIo *soundio = &si->pub;
 
     assert(!osa->thread);
+    assert(!osa->io.io_thread);
 
     int err;
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osa->thread_exit_flag);
-    if ((err = soundio_os_thread_create(outstream_thread_run, os, soundio->emit_rtprio_warning, &osa->thread)))
+    osa->state = snd_pcm_state(osa->handle);
+
+    if (sia->io_thread_count > 0) {
+        osa->io.os = os;
+        osa->io.handle = osa->handle;
+        osa->io.poll_fds = osa->poll_fds;
+        osa->io.poll_fd_count = osa->poll_fd_count;
+        return io_thread_add_stream(sia, &osa->io);
+    }
+
+    int64_t period = soundio_frames_to_ns(osa->period_size, os->pub.sample_rate);
+    if ((err = soundio_os_thread_create(outstream_thread_run, os, soundio->emit_rtprio_warning,
+                    &os->thread_policy, period, &osa->thread)))
         return err;
 
     return 0;
@@ -1484,7 +2226,24 @@ static int outstream_begin_write_alsa(struct SoundIoPrivate *si, struct SoundIoO
                 (osa->areas[ch].step * osa->offset);
         }
 
+        osa->write_wrapped = false;
         osa->write_frame_count = frames;
+
+        if (frames < (snd_pcm_uframes_t)*frame_count && osa->offset + frames == osa->buffer_size_frames) {
+            // The free region continues at the start of the buffer. Rather
+            // than making the caller come back for the rest, let it write
+            // everything to sample_buffer and split it up in end_write.
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(osa->handle);
+            if (avail > (snd_pcm_sframes_t)frames) {
+                osa->write_wrapped = true;
+                osa->write_frame_count = soundio_int_min(*frame_count, avail);
+                for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+                    osa->areas[ch].ptr = osa->sample_buffer + ch * outstream->bytes_per_sample;
+                    osa->areas[ch].step = outstream->bytes_per_frame;
+                }
+            }
+        }
+
         *frame_count = osa->write_frame_count;
     }
 
@@ -1492,6 +2251,44 @@ static int outstream_begin_write_alsa(struct SoundIoPrivate *si, struct SoundIoO
     return 0;
 }
 
+// Copies sample_buffer into the mmap buffer one contiguous segment at a time.
+static snd_pcm_sframes_t outstream_commit_wrapped(struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+    struct SoundIoOutStream *outstream = &os->pub;
+
+    snd_pcm_sframes_t committed = 0;
+    while (committed < osa->write_frame_count) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = osa->write_frame_count - committed;
+        int err;
+        if ((err = snd_pcm_mmap_begin(osa->handle, &areas, &offset, &frames)) < 0)
+            return err;
+        if (frames == 0)
+            break;
+
+        for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+            int step = areas[ch].step / 8;
+            char *dest = ((char *)areas[ch].addr) + (areas[ch].first / 8) + step * offset;
+            char *src = osa->sample_buffer + ch * outstream->bytes_per_sample +
+                committed * outstream->bytes_per_frame;
+            for (snd_pcm_uframes_t frame = 0; frame < frames; frame += 1) {
+                memcpy(dest, src, outstream->bytes_per_sample);
+                dest += step;
+                src += outstream->bytes_per_frame;
+            }
+        }
+
+        snd_pcm_sframes_t commitres = snd_pcm_mmap_commit(osa->handle, offset, frames);
+        if (commitres < 0)
+            return committed ? committed : commitres;
+        committed += commitres;
+        if ((snd_pcm_uframes_t)commitres != frames)
+            break;
+    }
+    return committed;
+}
+
 static int outstream_end_write_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
     struct SoundIoOutStream *outstream = &os->pub;
@@ -1505,10 +2302,15 @@ static int outstream_end_write_alsa(struct SoundIoPrivate *si, struct SoundIoOut
             ptrs[ch] = osa->sample_buffer + ch * outstream->bytes_per_sample * osa->period_size;
         }
         commitres = snd_pcm_writen(osa->handle, (void**)ptrs, osa->write_frame_count);
+    } else if (osa->write_wrapped) {
+        commitres = outstream_commit_wrapped(os);
     } else {
         commitres = snd_pcm_mmap_commit(osa->handle, osa->offset, osa->write_frame_count);
     }
 
+    if (commitres > 0)
+        osa->frames_written += commitres;
+
     if (commitres < 0 || commitres != osa->write_frame_count) {
         int err = (commitres >= 0) ? -EPIPE : commitres;
         if (err == -EPIPE || err == -ESTRPIPE)
@@ -1527,6 +2329,41 @@ static int outstream_clear_buffer_alsa(struct SoundIoPrivate *si,
     return 0;
 }
 
+static int outstream_get_rewindable_alsa(struct SoundIoPrivate *si,
+        struct SoundIoOutStreamPrivate *os, int *out_frame_count)
+{
+    struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+
+    snd_pcm_sframes_t rewindable = snd_pcm_rewindable(osa->handle);
+    if (rewindable < 0)
+        return SoundIoErrorStreaming;
+
+    *out_frame_count = rewindable;
+    return 0;
+}
+
+static int outstream_rewind_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        int keep_frame_count, int *out_frame_count)
+{
+    struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+    *out_frame_count = 0;
+
+    snd_pcm_sframes_t rewindable = snd_pcm_rewindable(osa->handle);
+    if (rewindable < 0)
+        return SoundIoErrorStreaming;
+
+    if (rewindable <= keep_frame_count)
+        return 0;
+
+    snd_pcm_sframes_t rewound = snd_pcm_rewind(osa->handle, rewindable - keep_frame_count);
+    if (rewound < 0)
+        return (rewound == -EINVAL) ? SoundIoErrorIncompatibleDevice : SoundIoErrorStreaming;
+
+    osa->frames_written -= rewound;
+    *out_frame_count = rewound;
+    return 0;
+}
+
 static int outstream_pause_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, bool pause) {
     if (!si)
         return SoundIoErrorInvalid;
@@ -1564,6 +2401,28 @@ static int outstream_get_latency_alsa(struct SoundIoPrivate *si, struct SoundIoO
     return 0;
 }
 
+static int outstream_get_position_alsa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        int64_t *out_frame_position, double *out_timestamp)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamAlsa *osa = &os->backend_data.alsa;
+    int err;
+
+    snd_pcm_sframes_t delay;
+    int64_t link_frames;
+    if ((err = get_status_position(osa->handle, outstream->sample_rate, osa->monotonic_tstamp,
+                    osa->link_tstamp, &delay, &link_frames, out_timestamp)))
+    {
+        return err;
+    }
+
+    if (link_frames >= 0)
+        *out_frame_position = osa->prepare_frame + link_frames;
+    else
+        *out_frame_position = osa->frames_written - delay;
+    return 0;
+}
+
 static void instream_destroy_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
     struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
 
@@ -1573,6 +2432,11 @@ static void instream_destroy_alsa(struct SoundIoPrivate *si, struct SoundIoInStr
         isa->thread = NULL;
     }
 
+    if (isa->io.io_thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(isa->thread_exit_flag);
+        io_thread_remove_stream(&isa->io);
+    }
+
     if (isa->handle) {
         snd_pcm_close(isa->handle);
         isa->handle = NULL;
@@ -1613,7 +2477,10 @@ static int instream_open_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamP
 
     snd_pcm_stream_t stream = aim_to_stream(instream->device->aim);
 
-    if ((err = snd_pcm_open(&isa->handle, instream->device->id, stream, 0)) < 0) {
+    if ((err = open_stream_pcm(instream->device, stream, instream->prefer_raw,
+                    to_alsa_fmt(instream->format), instream->sample_rate, &instream->layout,
+                    &isa->handle, &instream->opened_raw)) < 0)
+    {
         instream_destroy_alsa(si, is);
         return SoundIoErrorOpeningDevice;
     }
@@ -1623,7 +2490,7 @@ static int instream_open_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamP
         return SoundIoErrorOpeningDevice;
     }
 
-    int want_resample = !instream->device->is_raw;
+    int want_resample = !instream->opened_raw;
     if ((err = snd_pcm_hw_params_set_rate_resample(isa->handle, hwparams, want_resample)) < 0) {
         instream_destroy_alsa(si, is);
         return SoundIoErrorOpeningDevice;
@@ -1665,8 +2532,7 @@ static int instream_open_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamP
     isa->period_size = period_frames;
 
 
-    snd_pcm_uframes_t buffer_size_frames;
-    if ((err = snd_pcm_hw_params_set_buffer_size_last(isa->handle, hwparams, &buffer_size_frames)) < 0) {
+    if ((err = snd_pcm_hw_params_set_buffer_size_last(isa->handle, hwparams, &isa->buffer_size_frames)) < 0) {
         instream_destroy_alsa(si, is);
         return SoundIoErrorOpeningDevice;
     }
@@ -1694,6 +2560,16 @@ static int instream_open_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamP
         return SoundIoErrorOpeningDevice;
     }
 
+    if (instream->preserve_clock_on_xrun) {
+        if ((err = set_free_running_params(isa->handle, swparams, false)) < 0) {
+            instream_destroy_alsa(si, is);
+            return SoundIoErrorOpeningDevice;
+        }
+    }
+
+    isa->monotonic_tstamp = set_tstamp_params(isa->handle, swparams);
+    isa->link_tstamp = snd_pcm_hw_params_supports_audio_ts_type(hwparams, SND_PCM_AUDIO_TSTAMP_TYPE_LINK);
+
     // write the software parameters to device
     if ((err = snd_pcm_sw_params(isa->handle, swparams)) < 0) {
         instream_destroy_alsa(si, is);
@@ -1731,13 +2607,32 @@ static int instream_open_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamP
 
 static int instream_start_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
     struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
+    struct SoundIoAlsa *sia = &si->backend_data.alsa;
     struct SoundIo *soundio = &si->pub;
 
     assert(!isa->thread);
+    assert(!isa->io.io_thread);
 
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isa->thread_exit_flag);
+    isa->state = snd_pcm_state(isa->handle);
     int err;
-    if ((err = soundio_os_thread_create(instream_thread_run, is, soundio->emit_rtprio_warning, &isa->thread))) {
+
+    if (sia->io_thread_count > 0) {
+        isa->io.is = is;
+        isa->io.handle = isa->handle;
+        isa->io.poll_fds = isa->poll_fds;
+        isa->io.poll_fd_count = isa->poll_fd_count;
+        if ((err = io_thread_add_stream(sia, &isa->io))) {
+            instream_destroy_alsa(si, is);
+            return err;
+        }
+        return 0;
+    }
+
+    int64_t period = soundio_frames_to_ns(isa->period_size, is->pub.sample_rate);
+    if ((err = soundio_os_thread_create(instream_thread_run, is, soundio->emit_rtprio_warning,
+                    &is->thread_policy, period, &isa->thread)))
+    {
         instream_destroy_alsa(si, is);
         return err;
     }
@@ -1762,6 +2657,8 @@ static int instream_begin_read_alsa(struct SoundIoPrivate *si,
         *frame_count = isa->read_frame_count;
 
         snd_pcm_sframes_t commitres = snd_pcm_readi(isa->handle, isa->sample_buffer, isa->read_frame_count);
+        if (commitres > 0)
+            isa->frames_read += commitres;
         if (commitres < 0 || commitres != isa->read_frame_count) {
             int err = (commitres >= 0) ? -EPIPE : commitres;
             if ((err = instream_xrun_recovery(is, err)) < 0)
@@ -1779,6 +2676,8 @@ static int instream_begin_read_alsa(struct SoundIoPrivate *si,
         *frame_count = isa->read_frame_count;
 
         snd_pcm_sframes_t commitres = snd_pcm_readn(isa->handle, (void**)ptrs, isa->read_frame_count);
+        if (commitres > 0)
+            isa->frames_read += commitres;
         if (commitres < 0 || commitres != isa->read_frame_count) {
             int err = (commitres >= 0) ? -EPIPE : commitres;
             if ((err = instream_xrun_recovery(is, err)) < 0)
@@ -1819,6 +2718,8 @@ static int instream_end_read_alsa(struct SoundIoPrivate *si, struct SoundIoInStr
         // nothing to do
     } else {
         snd_pcm_sframes_t commitres = snd_pcm_mmap_commit(isa->handle, isa->offset, isa->read_frame_count);
+        if (commitres > 0)
+            isa->frames_read += commitres;
         if (commitres < 0 || commitres != isa->read_frame_count) {
             int err = (commitres >= 0) ? -EPIPE : commitres;
             if ((err = instream_xrun_recovery(is, err)) < 0)
@@ -1859,6 +2760,28 @@ static int instream_get_latency_alsa(struct SoundIoPrivate *si, struct SoundIoIn
     return 0;
 }
 
+static int instream_get_position_alsa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
+        int64_t *out_frame_position, double *out_timestamp)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamAlsa *isa = &is->backend_data.alsa;
+    int err;
+
+    snd_pcm_sframes_t delay;
+    int64_t link_frames;
+    if ((err = get_status_position(isa->handle, instream->sample_rate, isa->monotonic_tstamp,
+                    isa->link_tstamp, &delay, &link_frames, out_timestamp)))
+    {
+        return err;
+    }
+
+    if (link_frames >= 0)
+        *out_frame_position = isa->prepare_frame + link_frames;
+    else
+        *out_frame_position = isa->frames_read + delay;
+    return 0;
+}
+
 int soundio_alsa_init(struct SoundIoPrivate *si) {
     struct SoundIoAlsa *sia = &si->backend_data.alsa;
     int err;
@@ -1866,6 +2789,8 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
     sia->notify_fd = -1;
     sia->notify_wd = -1;
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(sia->abort_flag);
+    SOUNDIO_ATOMIC_STORE(sia->event_generation, 0);
+    sia->seen_generation = 0;
 
     sia->mutex = soundio_os_mutex_create();
     if (!sia->mutex) {
@@ -1920,9 +2845,16 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
         return SoundIoErrorSystemResources;
     }
 
+    if (si->pub.io_thread_count > 0) {
+        if ((err = init_io_threads(si, si->pub.io_thread_count))) {
+            destroy_alsa(si);
+            return err;
+        }
+    }
+
     wakeup_device_poll(sia);
 
-    if ((err = soundio_os_thread_create(device_thread_run, si, NULL, &sia->thread))) {
+    if ((err = soundio_os_thread_create(device_thread_run, si, NULL, NULL, 0, &sia->thread))) {
         destroy_alsa(si);
         return err;
     }
@@ -1932,6 +2864,7 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
     si->wait_events = wait_events_alsa;
     si->wakeup = wakeup_alsa;
     si->force_device_scan = force_device_scan_alsa;
+    si->device_probe = device_probe_alsa;
 
     si->outstream_open = outstream_open_alsa;
     si->outstream_destroy = outstream_destroy_alsa;
@@ -1939,8 +2872,11 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
     si->outstream_begin_write = outstream_begin_write_alsa;
     si->outstream_end_write = outstream_end_write_alsa;
     si->outstream_clear_buffer = outstream_clear_buffer_alsa;
+    si->outstream_get_rewindable = outstream_get_rewindable_alsa;
+    si->outstream_rewind = outstream_rewind_alsa;
     si->outstream_pause = outstream_pause_alsa;
     si->outstream_get_latency = outstream_get_latency_alsa;
+    si->outstream_get_position = outstream_get_position_alsa;
 
     si->instream_open = instream_open_alsa;
     si->instream_destroy = instream_destroy_alsa;
@@ -1949,6 +2885,7 @@ int soundio_alsa_init(struct SoundIoPrivate *si) {
     si->instream_end_read = instream_end_read_alsa;
     si->instream_pause = instream_pause_alsa;
     si->instream_get_latency = instream_get_latency_alsa;
+    si->instream_get_position = instream_get_position_alsa;
 
     return 0;
 }
@@ -18,7 +18,11 @@
 struct SoundIoPrivate;
 int soundio_alsa_init(struct SoundIoPrivate *si);
 
-struct SoundIoDeviceAlsa { int make_the_struct_not_empty; };
+struct SoundIoDeviceAlsa {
+    // -1 unless this is a raw hw: device
+    int card_index;
+    int device_index;
+};
 
 #define SOUNDIO_MAX_ALSA_SND_FILE_LEN 16
 struct SoundIoAlsaPendingFile {
@@ -27,6 +31,58 @@ struct SoundIoAlsaPendingFile {
 
 SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoAlsaPendingFile, SoundIoListAlsaPendingFile, SOUNDIO_LIST_STATIC)
 
+struct SoundIoOutStreamPrivate;
+struct SoundIoInStreamPrivate;
+struct SoundIoAlsaIoThread;
+
+// A stream that is serviced by a shared I/O thread instead of its own.
+struct SoundIoAlsaIoStream {
+    struct SoundIoAlsaIoThread *io_thread;
+    // exactly one of these is set
+    struct SoundIoOutStreamPrivate *os;
+    struct SoundIoInStreamPrivate *is;
+    snd_pcm_t *handle;
+    struct pollfd *poll_fds;
+    int poll_fd_count;
+    // the rest are protected by the I/O thread mutex
+    bool needs_kick;
+    // only the I/O thread sets this, while busy
+    bool dead;
+    // the I/O thread is running the stream without holding the mutex, so
+    // it cannot be removed yet
+    bool busy;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoAlsaIoStream *, SoundIoListAlsaIoStreamPtr, SOUNDIO_LIST_STATIC)
+
+// A stream that the I/O thread is going to service. It is only looked at
+// again after checking under the mutex that it was not removed meanwhile.
+struct SoundIoAlsaIoDispatch {
+    struct SoundIoAlsaIoStream *ios;
+    bool ready;
+    bool kick;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoAlsaIoDispatch, SoundIoListAlsaIoDispatch, SOUNDIO_LIST_STATIC)
+
+struct SoundIoAlsaIoThread {
+    struct SoundIoOsThread *thread;
+    struct SoundIoOsMutex *mutex;
+    // signaled when a stream stops being busy
+    struct SoundIoOsCond *cond;
+    struct SoundIoAtomicFlag abort_flag;
+    int epoll_fd;
+    int wake_pipe_fd[2];
+    // -1 if not pinned
+    int cpu;
+    // protected by mutex. only modified by the thread that starts and
+    // destroys streams.
+    struct SoundIoListAlsaIoStreamPtr streams;
+    // Filled in and read by the I/O thread with mutex held. Streams being
+    // added make room in it, so that the I/O thread never allocates.
+    struct SoundIoListAlsaIoDispatch dispatch;
+};
+
 struct SoundIoAlsa {
     struct SoundIoOsMutex *mutex;
     struct SoundIoOsCond *cond;
@@ -41,9 +97,16 @@ struct SoundIoAlsa {
 
     // this one is ready to be read with flush_events. protected by mutex
     struct SoundIoDevicesInfo *ready_devices_info;
+    // bumped every time there is something new for flush_events to pick up
+    struct SoundIoAtomicULong event_generation;
+    // only touched by the thread calling flush_events
+    unsigned long seen_generation;
 
     int shutdown_err;
     bool emitted_shutdown_cb;
+
+    struct SoundIoAlsaIoThread *io_threads;
+    int io_thread_count;
 };
 
 struct SoundIoOutStreamAlsa {
@@ -63,9 +126,22 @@ struct SoundIoOutStreamAlsa {
     struct SoundIoAtomicFlag thread_exit_flag;
     snd_pcm_uframes_t period_size;
     int write_frame_count;
+    // the current write goes through sample_buffer because the mmap region
+    // wraps around the end of the buffer
+    bool write_wrapped;
     bool is_paused;
     struct SoundIoAtomicFlag clear_buffer_flag;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    // frames handed to ALSA, minus frames dropped by clear_buffer
+    int64_t frames_written;
+    // frames_written at the last snd_pcm_prepare
+    int64_t prepare_frame;
+    // last state the stream thread put the PCM into, so that it does not
+    // have to ask ALSA on every iteration
+    snd_pcm_state_t state;
+    bool monotonic_tstamp;
+    bool link_tstamp;
+    struct SoundIoAlsaIoStream io;
 };
 
 struct SoundIoInStreamAlsa {
@@ -81,9 +157,19 @@ struct SoundIoInStreamAlsa {
     struct SoundIoOsThread *thread;
     struct SoundIoAtomicFlag thread_exit_flag;
     int period_size;
+    snd_pcm_uframes_t buffer_size_frames;
     int read_frame_count;
     bool is_paused;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    // frames taken from ALSA
+    int64_t frames_read;
+    // frames_read at the last snd_pcm_prepare
+    int64_t prepare_frame;
+    // see SoundIoOutStreamAlsa::state
+    snd_pcm_state_t state;
+    bool monotonic_tstamp;
+    bool link_tstamp;
+    struct SoundIoAlsaIoStream io;
 };
 
 #endif
@@ -11,10 +11,342 @@
 #include <stdio.h>
 #include <string.h>
 
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoDummyClockWaiter *, SoundIoListDummyClockWaiterPtr, SOUNDIO_LIST_STATIC)
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoDummyLoopback *, SoundIoListDummyLoopbackPtr, SOUNDIO_LIST_STATIC)
+
+// in nanoseconds
+static int64_t clock_now(struct SoundIoDummy *sid, int64_t clock_time) {
+    return (sid->clock == SoundIoDummyClockReal) ? soundio_os_get_time_ns() : clock_time;
+}
+
+// splitmix64
+static uint64_t fault_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// in [0, 1)
+static double fault_uniform(uint64_t *state) {
+    return (fault_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool fault_roll(uint64_t *state, double probability) {
+    return probability > 0.0 && fault_uniform(state) < probability;
+}
+
+// natural logarithm of 0 < x <= 1, so that libm is not needed
+static double fault_log(double x) {
+    int exponent = 0;
+    while (x < 0.5) {
+        x *= 2.0;
+        exponent -= 1;
+    }
+    // ln(x) = 2 atanh((x - 1) / (x + 1)) converges quickly for x near 1
+    double y = (x - 1.0) / (x + 1.0);
+    double y2 = y * y;
+    double term = y;
+    double sum = 0.0;
+    for (int k = 1; k < 40; k += 2) {
+        sum += term / k;
+        term *= y2;
+    }
+    return 2.0 * sum + exponent * 0.69314718055994530942;
+}
+
+static void fault_seed(struct SoundIoDummy *sid, uint64_t *state) {
+    if (!sid->faults)
+        return;
+    // streams are seeded in the order they start, so that runs repeat
+    soundio_os_mutex_lock(sid->mutex);
+    sid->fault_stream_count += 1;
+    *state = sid->faults->seed * 0x100000001b3ULL + sid->fault_stream_count;
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+// Returns how many nanoseconds late a stream thread wakes up this period.
+static int64_t fault_wakeup_delay(struct SoundIoDummy *sid, uint64_t *state) {
+    const struct SoundIoDummyFaults *faults = sid->faults;
+    if (!faults)
+        return 0;
+    double delay = 0.0;
+    if (faults->jitter > 0.0) {
+        double u = fault_uniform(state);
+        switch (faults->jitter_distribution) {
+        case SoundIoDummyJitterUniform:
+            delay += u * faults->jitter;
+            break;
+        case SoundIoDummyJitterExponential:
+            delay += -fault_log(1.0 - u) * faults->jitter;
+            break;
+        }
+    }
+    if (fault_roll(state, faults->stall_probability))
+        delay += faults->stall_duration;
+    return soundio_seconds_to_ns(delay);
+}
+
+// call this while holding sid->mutex
+static void check_disconnect(struct SoundIoPrivate *si, int64_t now) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    if (!sid->faults || sid->faults->disconnect_after <= 0.0 || sid->disconnected)
+        return;
+    if (now < sid->disconnect_time)
+        return;
+    sid->disconnected = true;
+    soundio_os_cond_signal(sid->cond, NULL);
+    soundio->on_events_signal(soundio);
+}
+
+// Returns the error that a stream thread should stop with this period, if
+// any.
+static int fault_stream_error(struct SoundIoPrivate *si, uint64_t *state, int64_t now) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    if (!sid->faults)
+        return 0;
+
+    soundio_os_mutex_lock(sid->mutex);
+    check_disconnect(si, now);
+    bool disconnected = sid->disconnected;
+    soundio_os_mutex_unlock(sid->mutex);
+
+    if (disconnected || fault_roll(state, sid->faults->error_probability))
+        return SoundIoErrorStreaming;
+    return 0;
+}
+
+// Sleeps until the next period begins, and then for another delay
+// nanoseconds. Periods are exactly period_duration apart from start_time, so
+// waking up late once does not move the ones after it. With a virtual clock
+// *clock_time is moved to the time the thread wakes up.
+static void wait_for_next_period(struct SoundIoDummy *sid, int64_t start_time, int64_t now,
+        int64_t period_duration, int64_t delay, int64_t *clock_time, struct SoundIoDummyClockWaiter *waiter,
+        struct SoundIoAtomicFlag *abort_flag, bool paused)
+{
+    switch (sid->clock) {
+    case SoundIoDummyClockReal:
+        {
+            int64_t time_passed = now - start_time;
+            int64_t periods_passed = (time_passed > 0) ?
+                (time_passed + period_duration - 1) / period_duration : 0;
+            int64_t next_period = start_time + periods_passed * period_duration;
+            soundio_os_cond_timed_wait_until(waiter->cond, NULL, next_period + delay);
+            return;
+        }
+    case SoundIoDummyClockFreeRun:
+        // don't spin while there is nothing to do
+        if (paused)
+            soundio_os_cond_timed_wait(waiter->cond, NULL, period_duration / 1000000000.0);
+        else
+            *clock_time += period_duration + delay;
+        return;
+    case SoundIoDummyClockManual:
+        {
+            int64_t next_period = *clock_time + period_duration + delay;
+            soundio_os_mutex_lock(sid->mutex);
+            while (sid->clock_time < next_period) {
+                if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET((*abort_flag))) {
+                    // leave it for the thread loop to see
+                    SOUNDIO_ATOMIC_FLAG_CLEAR((*abort_flag));
+                    break;
+                }
+                if (!waiter->waiting) {
+                    waiter->waiting = true;
+                    waiter->wait_until = next_period;
+                    sid->busy_stream_count -= 1;
+                    soundio_os_cond_signal(sid->clock_cond, sid->mutex);
+                }
+                soundio_os_cond_wait(waiter->cond, sid->mutex);
+            }
+            // soundio_advance_clock counts us as busy again when it wakes us
+            if (waiter->waiting) {
+                waiter->waiting = false;
+                sid->busy_stream_count += 1;
+            }
+            soundio_os_mutex_unlock(sid->mutex);
+            *clock_time = next_period;
+            return;
+        }
+    }
+}
+
+static int clock_stream_start(struct SoundIoDummy *sid, struct SoundIoDummyClockWaiter *waiter) {
+    if (sid->clock != SoundIoDummyClockManual)
+        return 0;
+    soundio_os_mutex_lock(sid->mutex);
+    int err = SoundIoListDummyClockWaiterPtr_append(&sid->clock_waiters, waiter);
+    if (!err) {
+        waiter->waiting = false;
+        sid->busy_stream_count += 1;
+    }
+    soundio_os_mutex_unlock(sid->mutex);
+    return err;
+}
+
+// called by the stream thread as it exits
+static void clock_stream_stop(struct SoundIoDummy *sid) {
+    if (sid->clock != SoundIoDummyClockManual)
+        return;
+    soundio_os_mutex_lock(sid->mutex);
+    sid->busy_stream_count -= 1;
+    soundio_os_cond_signal(sid->clock_cond, sid->mutex);
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+static void clock_stream_remove(struct SoundIoDummy *sid, struct SoundIoDummyClockWaiter *waiter) {
+    if (sid->clock != SoundIoDummyClockManual)
+        return;
+    soundio_os_mutex_lock(sid->mutex);
+    for (int i = 0; i < sid->clock_waiters.length; i += 1) {
+        if (SoundIoListDummyClockWaiterPtr_val_at(&sid->clock_waiters, i) == waiter) {
+            SoundIoListDummyClockWaiterPtr_swap_remove(&sid->clock_waiters, i);
+            break;
+        }
+    }
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+// With SoundIoDummyClockManual the stream thread waits on its condition
+// variable with the backend mutex held, so it must be signaled under it.
+static void wake_stream_thread(struct SoundIoDummy *sid, struct SoundIoDummyClockWaiter *waiter) {
+    if (sid->clock == SoundIoDummyClockManual) {
+        soundio_os_mutex_lock(sid->mutex);
+        soundio_os_cond_signal(waiter->cond, sid->mutex);
+        soundio_os_mutex_unlock(sid->mutex);
+    } else {
+        soundio_os_cond_signal(waiter->cond, NULL);
+    }
+}
+
+static void write_silence(char *ptr, int frame_count, enum SoundIoFormat format, int bytes_per_frame) {
+    memset(ptr, 0, frame_count * bytes_per_frame);
+
+    // unsigned samples are silent halfway up, where only the top bit is set
+    int msb_index;
+    switch (format) {
+    case SoundIoFormatU8:      msb_index = 0; break;
+    case SoundIoFormatU16LE:   msb_index = 1; break;
+    case SoundIoFormatU16BE:   msb_index = 0; break;
+    case SoundIoFormatU24LE:   msb_index = 2; break;
+    case SoundIoFormatU24BE:   msb_index = 1; break;
+    case SoundIoFormatU32LE:   msb_index = 3; break;
+    case SoundIoFormatU32BE:   msb_index = 0; break;
+    default: return;
+    }
+    int bytes_per_sample = soundio_get_bytes_per_sample(format);
+    int sample_count = frame_count * (bytes_per_frame / bytes_per_sample);
+    for (int i = 0; i < sample_count; i += 1)
+        ptr[i * bytes_per_sample + msb_index] = (char)0x80;
+}
+
+static bool loopback_accepts(struct SoundIoDummyLoopback *loopback, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoInStream *instream = &loopback->is->pub;
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)instream->device;
+    if (loopback->source)
+        return loopback->source == os;
+    return strcmp(dev->backend_data.dummy.loopback_id, outstream->device->id) == 0 &&
+        outstream->format == instream->format &&
+        outstream->sample_rate == instream->sample_rate &&
+        soundio_channel_layout_equal(&outstream->layout, &instream->layout);
+}
+
+// Hands frames that the playback thread just played, the last of them at
+// time, to the input streams capturing its device. Each input stream reads
+// its ring buffer in order, so silence is put in front of the first frames
+// after a pause to make them arrive loopback_delay after they were played.
+static void loopback_play(struct SoundIoDummy *sid, struct SoundIoOutStreamPrivate *os,
+        const char *frames, int frame_count, int64_t time)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    int bytes_per_frame = outstream->bytes_per_frame;
+    int64_t start_time = time - soundio_frames_to_ns(frame_count, outstream->sample_rate);
+
+    soundio_os_mutex_lock(sid->mutex);
+    for (int i = 0; i < sid->loopbacks.length; i += 1) {
+        struct SoundIoDummyLoopback *loopback = SoundIoListDummyLoopbackPtr_val_at(&sid->loopbacks, i);
+        if (!loopback_accepts(loopback, os))
+            continue;
+        loopback->source = os;
+
+        struct SoundIoRingBuffer *rb = &loopback->ring_buffer;
+        int capacity_frames = soundio_ring_buffer_capacity(rb) / bytes_per_frame;
+        int fill_frames = soundio_ring_buffer_fill_count(rb) / bytes_per_frame;
+        const char *src = frames;
+        int count = frame_count;
+
+        // the input stream will capture the first free frame right after
+        // capture_time, or right after the frame played at end_time
+        int64_t gap_ns = (fill_frames == 0) ?
+            start_time + sid->loopback_delay - loopback->capture_time :
+            start_time - loopback->end_time;
+        double gap = gap_ns / 1000000000.0 * outstream->sample_rate;
+        if (gap < 0.0 && fill_frames == 0) {
+            // too late to be captured on time
+            int late_frames = soundio_int_min(ceil_dbl_to_int(-gap), count);
+            src += late_frames * bytes_per_frame;
+            count -= late_frames;
+        }
+        if (count > capacity_frames) {
+            src += (count - capacity_frames) * bytes_per_frame;
+            count = capacity_frames;
+        }
+        int gap_frames = soundio_double_clamp(0.0, gap, capacity_frames - count);
+
+        // drop the oldest frames when the input stream does not keep up
+        int free_frames = capacity_frames - fill_frames;
+        if (gap_frames + count > free_frames) {
+            int drop_frames = gap_frames + count - free_frames;
+            soundio_ring_buffer_advance_read_ptr(rb, drop_frames * bytes_per_frame);
+        }
+
+        char *write_ptr = soundio_ring_buffer_write_ptr(rb);
+        write_silence(write_ptr, gap_frames, outstream->format, bytes_per_frame);
+        memcpy(write_ptr + gap_frames * bytes_per_frame, src, count * bytes_per_frame);
+        soundio_ring_buffer_advance_write_ptr(rb, (gap_frames + count) * bytes_per_frame);
+        loopback->end_time = time;
+    }
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+// Fills frame_count frames at dest with the next frames of the loopback, or
+// silence when there are none, as the capture thread's period ending at time
+// is captured. skip_count more frames are lost to an overflow.
+static void loopback_capture(struct SoundIoDummy *sid, struct SoundIoDummyLoopback *loopback,
+        char *dest, int frame_count, int skip_count, int64_t time)
+{
+    struct SoundIoInStream *instream = &loopback->is->pub;
+    int bytes_per_frame = instream->bytes_per_frame;
+    struct SoundIoRingBuffer *rb = &loopback->ring_buffer;
+
+    soundio_os_mutex_lock(sid->mutex);
+    int fill_frames = soundio_ring_buffer_fill_count(rb) / bytes_per_frame;
+    int copy_frames = soundio_int_min(fill_frames, frame_count);
+    memcpy(dest, soundio_ring_buffer_read_ptr(rb), copy_frames * bytes_per_frame);
+    write_silence(dest + copy_frames * bytes_per_frame, frame_count - copy_frames,
+            instream->format, bytes_per_frame);
+    int skip_frames = soundio_int_min(fill_frames - copy_frames, skip_count);
+    soundio_ring_buffer_advance_read_ptr(rb, (copy_frames + skip_frames) * bytes_per_frame);
+    loopback->capture_time = time;
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
+// Drops what was played while the input stream is paused.
+static void loopback_pause(struct SoundIoDummy *sid, struct SoundIoDummyLoopback *loopback, int64_t time) {
+    soundio_os_mutex_lock(sid->mutex);
+    soundio_ring_buffer_clear(&loopback->ring_buffer);
+    loopback->capture_time = time;
+    soundio_os_mutex_unlock(sid->mutex);
+}
+
 static void playback_thread_run(void *arg) {
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)arg;
     struct SoundIoOutStream *outstream = &os->pub;
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)outstream->device->soundio;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
 
     int fill_bytes = soundio_ring_buffer_fill_count(&osd->ring_buffer);
     int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer) - fill_bytes;
@@ -22,16 +354,19 @@ static void playback_thread_run(void *arg) {
     osd->frames_left = free_frames;
     if (free_frames > 0)
         outstream->write_callback(outstream, 0, free_frames);
-    double start_time = soundio_os_get_time();
+    int64_t start_time = clock_now(sid, osd->clock_time);
     long frames_consumed = 0;
 
     while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->abort_flag)) {
-        double now = soundio_os_get_time();
-        double time_passed = now - start_time;
-        double next_period = start_time +
-            ceil_dbl(time_passed / osd->period_duration) * osd->period_duration;
-        double relative_time = next_period - now;
-        soundio_os_cond_timed_wait(osd->cond, NULL, relative_time);
+        int64_t now = clock_now(sid, osd->clock_time);
+        int err;
+        if ((err = fault_stream_error(si, &osd->fault_state, now))) {
+            outstream->error_callback(outstream, err);
+            break;
+        }
+        wait_for_next_period(sid, start_time, now, osd->period_duration,
+                fault_wakeup_delay(sid, &osd->fault_state), &osd->clock_time,
+                &osd->clock_waiter, &osd->abort_flag, SOUNDIO_ATOMIC_LOAD(osd->pause_requested));
         if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->clear_buffer_flag)) {
             soundio_ring_buffer_clear(&osd->ring_buffer);
             int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer);
@@ -40,7 +375,7 @@ static void playback_thread_run(void *arg) {
             if (free_frames > 0)
                 outstream->write_callback(outstream, 0, free_frames);
             frames_consumed = 0;
-            start_time = soundio_os_get_time();
+            start_time = clock_now(sid, osd->clock_time);
             continue;
         }
 
@@ -50,16 +385,21 @@ static void playback_thread_run(void *arg) {
             continue;
         }
 
+        if (sid->faults && fault_roll(&osd->fault_state, sid->faults->underflow_probability))
+            soundio_ring_buffer_clear(&osd->ring_buffer);
+
         int fill_bytes = soundio_ring_buffer_fill_count(&osd->ring_buffer);
         int fill_frames = fill_bytes / outstream->bytes_per_frame;
         int free_bytes = soundio_ring_buffer_capacity(&osd->ring_buffer) - fill_bytes;
         int free_frames = free_bytes / outstream->bytes_per_frame;
 
-        double total_time = soundio_os_get_time() - start_time;
-        long total_frames = total_time * outstream->sample_rate;
+        now = clock_now(sid, osd->clock_time);
+        long total_frames = soundio_ns_to_frames(now - start_time, outstream->sample_rate);
         int frames_to_kill = total_frames - frames_consumed;
         int read_count = soundio_int_min(frames_to_kill, fill_frames);
         int byte_count = read_count * outstream->bytes_per_frame;
+        if (read_count > 0)
+            loopback_play(sid, os, soundio_ring_buffer_read_ptr(&osd->ring_buffer), read_count, now);
         soundio_ring_buffer_advance_read_ptr(&osd->ring_buffer, byte_count);
         frames_consumed += read_count;
 
@@ -69,32 +409,41 @@ static void playback_thread_run(void *arg) {
             if (free_frames > 0)
                 outstream->write_callback(outstream, 0, free_frames);
             frames_consumed = 0;
-            start_time = soundio_os_get_time();
+            start_time = clock_now(sid, osd->clock_time);
         } else if (free_frames > 0) {
             osd->frames_left = free_frames;
             outstream->write_callback(outstream, 0, free_frames);
         }
     }
+
+    clock_stream_stop(sid);
 }
 
 static void capture_thread_run(void *arg) {
     struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)arg;
     struct SoundIoInStream *instream = &is->pub;
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)instream->device->soundio;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
 
     long frames_consumed = 0;
-    double start_time = soundio_os_get_time();
+    int64_t start_time = clock_now(sid, isd->clock_time);
     while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isd->abort_flag)) {
-        double now = soundio_os_get_time();
-        double time_passed = now - start_time;
-        double next_period = start_time +
-            ceil_dbl(time_passed / isd->period_duration) * isd->period_duration;
-        double relative_time = next_period - now;
-        soundio_os_cond_timed_wait(isd->cond, NULL, relative_time);
+        int64_t now = clock_now(sid, isd->clock_time);
+        int err;
+        if ((err = fault_stream_error(si, &isd->fault_state, now))) {
+            instream->error_callback(instream, err);
+            break;
+        }
+        wait_for_next_period(sid, start_time, now, isd->period_duration,
+                fault_wakeup_delay(sid, &isd->fault_state), &isd->clock_time,
+                &isd->clock_waiter, &isd->abort_flag, SOUNDIO_ATOMIC_LOAD(isd->pause_requested));
 
         if (SOUNDIO_ATOMIC_LOAD(isd->pause_requested)) {
             start_time = now;
             frames_consumed = 0;
+            if (isd->loopback.is)
+                loopback_pause(sid, &isd->loopback, now);
             continue;
         }
 
@@ -103,24 +452,32 @@ static void capture_thread_run(void *arg) {
         int fill_frames = fill_bytes / instream->bytes_per_frame;
         int free_frames = free_bytes / instream->bytes_per_frame;
 
-        double total_time = soundio_os_get_time() - start_time;
-        long total_frames = total_time * instream->sample_rate;
+        now = clock_now(sid, isd->clock_time);
+        long total_frames = soundio_ns_to_frames(now - start_time, instream->sample_rate);
         int frames_to_kill = total_frames - frames_consumed;
-        int write_count = soundio_int_min(frames_to_kill, free_frames);
+        bool forced_overflow = sid->faults &&
+            fault_roll(&isd->fault_state, sid->faults->overflow_probability);
+        int write_count = forced_overflow ? 0 : soundio_int_min(frames_to_kill, free_frames);
         int byte_count = write_count * instream->bytes_per_frame;
+        if (isd->loopback.is && frames_to_kill > 0) {
+            loopback_capture(sid, &isd->loopback, soundio_ring_buffer_write_ptr(&isd->ring_buffer),
+                    write_count, frames_to_kill - write_count, now);
+        }
         soundio_ring_buffer_advance_write_ptr(&isd->ring_buffer, byte_count);
         frames_consumed += write_count;
 
-        if (frames_to_kill > free_frames) {
+        if (forced_overflow || frames_to_kill > free_frames) {
             instream->overflow_callback(instream);
             frames_consumed = 0;
-            start_time = soundio_os_get_time();
+            start_time = clock_now(sid, isd->clock_time);
         }
         if (fill_frames > 0) {
             isd->frames_left = fill_frames;
             instream->read_callback(instream, 0, fill_frames);
         }
     }
+
+    clock_stream_stop(sid);
 }
 
 static void destroy_dummy(struct SoundIoPrivate *si) {
@@ -129,23 +486,72 @@ static void destroy_dummy(struct SoundIoPrivate *si) {
     if (sid->cond)
         soundio_os_cond_destroy(sid->cond);
 
+    if (sid->clock_cond)
+        soundio_os_cond_destroy(sid->clock_cond);
+
     if (sid->mutex)
         soundio_os_mutex_destroy(sid->mutex);
+
+    SoundIoListDummyClockWaiterPtr_deinit(&sid->clock_waiters);
+    SoundIoListDummyLoopbackPtr_deinit(&sid->loopbacks);
+
+    soundio_destroy_devices_info(sid->ready_devices_info);
+    sid->ready_devices_info = NULL;
+    soundio_destroy_devices_info(sid->devices_info);
+    sid->devices_info = NULL;
 }
 
 static void flush_events_dummy(struct SoundIoPrivate *si) {
     struct SoundIo *soundio = &si->pub;
     struct SoundIoDummy *sid = &si->backend_data.dummy;
-    if (sid->devices_emitted)
-        return;
-    sid->devices_emitted = true;
-    soundio->on_devices_change(soundio);
+
+    struct SoundIoDevicesInfo *old_devices_info = NULL;
+    bool change = false;
+    bool cb_disconnect = false;
+
+    soundio_os_mutex_lock(sid->mutex);
+    check_disconnect(si, clock_now(sid, sid->clock_time));
+    if (sid->disconnected && !sid->emitted_disconnect) {
+        sid->emitted_disconnect = true;
+        cb_disconnect = true;
+    }
+    if (sid->ready_devices_info) {
+        old_devices_info = si->safe_devices_info;
+        si->safe_devices_info = sid->ready_devices_info;
+        sid->ready_devices_info = NULL;
+        change = true;
+    }
+    soundio_os_mutex_unlock(sid->mutex);
+
+    if (!sid->devices_emitted) {
+        sid->devices_emitted = true;
+        change = true;
+    }
+
+    if (cb_disconnect)
+        soundio->on_backend_disconnect(soundio, SoundIoErrorBackendDisconnected);
+    else if (change)
+        soundio->on_devices_change(soundio);
+
+    soundio_destroy_devices_info(old_devices_info);
 }
 
 static void wait_events_dummy(struct SoundIoPrivate *si) {
     struct SoundIoDummy *sid = &si->backend_data.dummy;
     flush_events_dummy(si);
-    soundio_os_cond_wait(sid->cond, NULL);
+
+    // with the real clock nothing else would wake us up to disconnect
+    soundio_os_mutex_lock(sid->mutex);
+    bool disconnect_pending = sid->faults && sid->faults->disconnect_after > 0.0 &&
+        sid->clock == SoundIoDummyClockReal && !sid->disconnected;
+    soundio_os_mutex_unlock(sid->mutex);
+
+    if (disconnect_pending) {
+        soundio_os_cond_timed_wait_until(sid->cond, NULL, sid->disconnect_time);
+    } else {
+        soundio_os_cond_wait(sid->cond, NULL);
+    }
+    flush_events_dummy(si);
 }
 
 static void wakeup_dummy(struct SoundIoPrivate *si) {
@@ -154,20 +560,32 @@ static void wakeup_dummy(struct SoundIoPrivate *si) {
 }
 
 static void force_device_scan_dummy(struct SoundIoPrivate *si) {
-    // nothing to do; dummy devices never change
+    // nothing to do; dummy devices only change through add_dummy_device and
+    // remove_dummy_device, which report the change themselves
 }
 
 static void outstream_destroy_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
 
     if (osd->thread) {
         SOUNDIO_ATOMIC_FLAG_CLEAR(osd->abort_flag);
-        soundio_os_cond_signal(osd->cond, NULL);
+        wake_stream_thread(sid, &osd->clock_waiter);
         soundio_os_thread_destroy(osd->thread);
         osd->thread = NULL;
+        clock_stream_remove(sid, &osd->clock_waiter);
+
+        soundio_os_mutex_lock(sid->mutex);
+        for (int i = 0; i < sid->loopbacks.length; i += 1) {
+            struct SoundIoDummyLoopback *loopback = SoundIoListDummyLoopbackPtr_val_at(&sid->loopbacks, i);
+            if (loopback->source == os)
+                loopback->source = NULL;
+        }
+        soundio_os_mutex_unlock(sid->mutex);
     }
     soundio_os_cond_destroy(osd->cond);
     osd->cond = NULL;
+    osd->clock_waiter.cond = NULL;
 
     soundio_ring_buffer_deinit(&osd->ring_buffer);
 }
@@ -185,7 +603,7 @@ static int outstream_open_dummy(struct SoundIoPrivate *si, struct SoundIoOutStre
                 device->software_latency_min, 1.0, device->software_latency_max);
     }
 
-    osd->period_duration = outstream->software_latency / 2.0;
+    osd->period_duration = soundio_seconds_to_ns(outstream->software_latency / 2.0);
 
     int err;
     int buffer_size = outstream->bytes_per_frame * outstream->sample_rate * outstream->software_latency;
@@ -202,6 +620,7 @@ static int outstream_open_dummy(struct SoundIoPrivate *si, struct SoundIoOutStre
         outstream_destroy_dummy(si, os);
         return SoundIoErrorNoMem;
     }
+    osd->clock_waiter.cond = osd->cond;
 
     return 0;
 }
@@ -213,14 +632,21 @@ static int outstream_pause_dummy(struct SoundIoPrivate *si, struct SoundIoOutStr
 }
 
 static int outstream_start_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
     struct SoundIo *soundio = &si->pub;
     assert(!osd->thread);
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osd->abort_flag);
+    osd->clock_time = sid->clock_time;
+    fault_seed(sid, &osd->fault_state);
     int err;
+    if ((err = clock_stream_start(sid, &osd->clock_waiter)))
+        return err;
     if ((err = soundio_os_thread_create(playback_thread_run, os,
-                    soundio->emit_rtprio_warning, &osd->thread)))
+                    soundio->emit_rtprio_warning, &os->thread_policy, osd->period_duration, &osd->thread)))
     {
+        clock_stream_remove(sid, &osd->clock_waiter);
+        clock_stream_stop(sid);
         return err;
     }
     return 0;
@@ -258,7 +684,9 @@ static int outstream_end_write_dummy(struct SoundIoPrivate *si, struct SoundIoOu
 static int outstream_clear_buffer_dummy(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamDummy *osd = &os->backend_data.dummy;
     SOUNDIO_ATOMIC_FLAG_CLEAR(osd->clear_buffer_flag);
-    soundio_os_cond_signal(osd->cond, NULL);
+    // with a virtual clock the buffer is cleared at the next period
+    if (si->backend_data.dummy.clock == SoundIoDummyClockReal)
+        soundio_os_cond_signal(osd->cond, NULL);
     return 0;
 }
 
@@ -271,17 +699,71 @@ static int outstream_get_latency_dummy(struct SoundIoPrivate *si, struct SoundIo
     return 0;
 }
 
+static int loopback_add(struct SoundIoDummy *sid, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)instream->device;
+    struct SoundIoDummyLoopback *loopback = &isd->loopback;
+
+    if (!dev->backend_data.dummy.loopback_id)
+        return 0;
+
+    // room for the delay, the input buffer and a full output buffer of the
+    // longest default latency; older frames are dropped
+    double duration = sid->loopback_delay / 1000000000.0 +
+        isd->buffer_frame_count / (double)instream->sample_rate + 4.0;
+    int err;
+    if ((err = soundio_ring_buffer_init(&loopback->ring_buffer,
+                    duration * instream->sample_rate * instream->bytes_per_frame)))
+    {
+        return err;
+    }
+    loopback->is = is;
+    loopback->source = NULL;
+    loopback->end_time = 0;
+    loopback->capture_time = clock_now(sid, isd->clock_time);
+
+    soundio_os_mutex_lock(sid->mutex);
+    err = SoundIoListDummyLoopbackPtr_append(&sid->loopbacks, loopback);
+    soundio_os_mutex_unlock(sid->mutex);
+    if (err) {
+        loopback->is = NULL;
+        soundio_ring_buffer_deinit(&loopback->ring_buffer);
+        return err;
+    }
+    return 0;
+}
+
+static void loopback_remove(struct SoundIoDummy *sid, struct SoundIoDummyLoopback *loopback) {
+    if (!loopback->is)
+        return;
+    soundio_os_mutex_lock(sid->mutex);
+    for (int i = 0; i < sid->loopbacks.length; i += 1) {
+        if (SoundIoListDummyLoopbackPtr_val_at(&sid->loopbacks, i) == loopback) {
+            SoundIoListDummyLoopbackPtr_swap_remove(&sid->loopbacks, i);
+            break;
+        }
+    }
+    soundio_os_mutex_unlock(sid->mutex);
+    loopback->is = NULL;
+    soundio_ring_buffer_deinit(&loopback->ring_buffer);
+}
+
 static void instream_destroy_dummy(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
 
     if (isd->thread) {
         SOUNDIO_ATOMIC_FLAG_CLEAR(isd->abort_flag);
-        soundio_os_cond_signal(isd->cond, NULL);
+        wake_stream_thread(sid, &isd->clock_waiter);
         soundio_os_thread_destroy(isd->thread);
         isd->thread = NULL;
+        clock_stream_remove(sid, &isd->clock_waiter);
     }
+    loopback_remove(sid, &isd->loopback);
     soundio_os_cond_destroy(isd->cond);
     isd->cond = NULL;
+    isd->clock_waiter.cond = NULL;
 
     soundio_ring_buffer_deinit(&isd->ring_buffer);
 }
@@ -298,9 +780,9 @@ static int instream_open_dummy(struct SoundIoPrivate *si, struct SoundIoInStream
                 device->software_latency_min, 1.0, device->software_latency_max);
     }
 
-    isd->period_duration = instream->software_latency;
+    isd->period_duration = soundio_seconds_to_ns(instream->software_latency);
 
-    double target_buffer_duration = isd->period_duration * 4.0;
+    double target_buffer_duration = instream->software_latency * 4.0;
 
     int err;
     int buffer_size = instream->bytes_per_frame * instream->sample_rate * target_buffer_duration;
@@ -317,6 +799,7 @@ static int instream_open_dummy(struct SoundIoPrivate *si, struct SoundIoInStream
         instream_destroy_dummy(si, is);
         return SoundIoErrorNoMem;
     }
+    isd->clock_waiter.cond = isd->cond;
 
     return 0;
 }
@@ -328,14 +811,26 @@ static int instream_pause_dummy(struct SoundIoPrivate *si, struct SoundIoInStrea
 }
 
 static int instream_start_dummy(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
     struct SoundIoInStreamDummy *isd = &is->backend_data.dummy;
     struct SoundIo *soundio = &si->pub;
     assert(!isd->thread);
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isd->abort_flag);
+    isd->clock_time = sid->clock_time;
+    fault_seed(sid, &isd->fault_state);
     int err;
+    if ((err = loopback_add(sid, is)))
+        return err;
+    if ((err = clock_stream_start(sid, &isd->clock_waiter))) {
+        loopback_remove(sid, &isd->loopback);
+        return err;
+    }
     if ((err = soundio_os_thread_create(capture_thread_run, is,
-                    soundio->emit_rtprio_warning, &isd->thread)))
+                    soundio->emit_rtprio_warning, &is->thread_policy, isd->period_duration, &isd->thread)))
     {
+        clock_stream_remove(sid, &isd->clock_waiter);
+        clock_stream_stop(sid);
+        loopback_remove(sid, &isd->loopback);
         return err;
     }
     return 0;
@@ -379,6 +874,30 @@ static int instream_get_latency_dummy(struct SoundIoPrivate *si, struct SoundIoI
     return 0;
 }
 
+static int advance_clock_dummy(struct SoundIoPrivate *si, double seconds) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+
+    if (sid->clock != SoundIoDummyClockManual)
+        return SoundIoErrorInvalid;
+
+    soundio_os_mutex_lock(sid->mutex);
+    sid->clock_time += soundio_seconds_to_ns(seconds);
+    check_disconnect(si, sid->clock_time);
+    for (int i = 0; i < sid->clock_waiters.length; i += 1) {
+        struct SoundIoDummyClockWaiter *waiter = SoundIoListDummyClockWaiterPtr_val_at(&sid->clock_waiters, i);
+        if (waiter->waiting && waiter->wait_until <= sid->clock_time) {
+            waiter->waiting = false;
+            sid->busy_stream_count += 1;
+            soundio_os_cond_signal(waiter->cond, sid->mutex);
+        }
+    }
+    while (sid->busy_stream_count > 0)
+        soundio_os_cond_wait(sid->clock_cond, sid->mutex);
+    soundio_os_mutex_unlock(sid->mutex);
+
+    return 0;
+}
+
 static int set_all_device_formats(struct SoundIoDevice *device) {
     device->format_count = 18;
     device->formats = ALLOCATE(enum SoundIoFormat, device->format_count);
@@ -425,129 +944,357 @@ static int set_all_device_channel_layouts(struct SoundIoDevice *device) {
     return 0;
 }
 
-int soundio_dummy_init(struct SoundIoPrivate *si) {
-    struct SoundIo *soundio = &si->pub;
-    struct SoundIoDummy *sid = &si->backend_data.dummy;
-
-    sid->mutex = soundio_os_mutex_create();
-    if (!sid->mutex) {
-        destroy_dummy(si);
-        return SoundIoErrorNoMem;
+static bool spec_is_valid(const struct SoundIoDummyDeviceSpec *spec) {
+    if (!spec || !spec->id || !spec->name)
+        return false;
+    if (spec->aim != SoundIoDeviceAimInput && spec->aim != SoundIoDeviceAimOutput)
+        return false;
+    if (spec->layout_count < 0 || (spec->layout_count > 0 && !spec->layouts))
+        return false;
+    for (int i = 0; i < spec->layout_count; i += 1) {
+        int channel_count = spec->layouts[i].channel_count;
+        if (channel_count < 1 || channel_count > SOUNDIO_MAX_CHANNELS)
+            return false;
     }
-
-    sid->cond = soundio_os_cond_create();
-    if (!sid->cond) {
-        destroy_dummy(si);
-        return SoundIoErrorNoMem;
+    if (spec->format_count < 0 || (spec->format_count > 0 && !spec->formats))
+        return false;
+    if (spec->sample_rate_count < 0 || (spec->sample_rate_count > 0 && !spec->sample_rates))
+        return false;
+    for (int i = 0; i < spec->sample_rate_count; i += 1) {
+        if (spec->sample_rates[i].min <= 0 || spec->sample_rates[i].min > spec->sample_rates[i].max)
+            return false;
     }
+    return true;
+}
 
-    assert(!si->safe_devices_info);
-    si->safe_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
-    if (!si->safe_devices_info) {
-        destroy_dummy(si);
+static void destruct_device(struct SoundIoDevicePrivate *dev) {
+    free(dev->backend_data.dummy.loopback_id);
+}
+
+static int create_device(struct SoundIoPrivate *si, const struct SoundIoDummyDeviceSpec *spec,
+        struct SoundIoDevice **out_device)
+{
+    struct SoundIo *soundio = &si->pub;
+
+    struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
+    if (!dev)
+        return SoundIoErrorNoMem;
+    struct SoundIoDevice *device = &dev->pub;
+
+    device->ref_count = 1;
+    device->soundio = soundio;
+    device->aim = spec->aim;
+    device->id = strdup(spec->id);
+    device->name = strdup(spec->name);
+    if (!device->id || !device->name) {
+        soundio_device_unref(device);
         return SoundIoErrorNoMem;
     }
 
-    si->safe_devices_info->default_input_index = 0;
-    si->safe_devices_info->default_output_index = 0;
-
-    // create output device
-    {
-        struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
-        if (!dev) {
-            destroy_dummy(si);
+    dev->destruct = destruct_device;
+    if (spec->loopback_id && spec->aim == SoundIoDeviceAimInput) {
+        dev->backend_data.dummy.loopback_id = strdup(spec->loopback_id);
+        if (!dev->backend_data.dummy.loopback_id) {
+            soundio_device_unref(device);
             return SoundIoErrorNoMem;
         }
-        struct SoundIoDevice *device = &dev->pub;
+    }
 
-        device->ref_count = 1;
-        device->soundio = soundio;
-        device->id = strdup("dummy-out");
-        device->name = strdup("Dummy Output Device");
-        if (!device->id || !device->name) {
+    int err;
+    if (spec->layout_count > 0) {
+        device->layout_count = spec->layout_count;
+        device->layouts = ALLOCATE_NONZERO(struct SoundIoChannelLayout, device->layout_count);
+        if (!device->layouts) {
             soundio_device_unref(device);
-            destroy_dummy(si);
             return SoundIoErrorNoMem;
         }
+        memcpy(device->layouts, spec->layouts, device->layout_count * sizeof(struct SoundIoChannelLayout));
+        device->current_layout = device->layouts[0];
+    } else if ((err = set_all_device_channel_layouts(device))) {
+        soundio_device_unref(device);
+        return err;
+    }
 
-        int err;
-        if ((err = set_all_device_channel_layouts(device))) {
+    if (spec->format_count > 0) {
+        device->format_count = spec->format_count;
+        device->formats = ALLOCATE_NONZERO(enum SoundIoFormat, device->format_count);
+        if (!device->formats) {
             soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
+            return SoundIoErrorNoMem;
         }
-        if ((err = set_all_device_formats(device))) {
+        memcpy(device->formats, spec->formats, device->format_count * sizeof(enum SoundIoFormat));
+        device->current_format = device->formats[0];
+    } else if ((err = set_all_device_formats(device))) {
+        soundio_device_unref(device);
+        return err;
+    }
+
+    if (spec->sample_rate_count > 0) {
+        device->sample_rate_count = spec->sample_rate_count;
+        device->sample_rates = ALLOCATE_NONZERO(struct SoundIoSampleRateRange, device->sample_rate_count);
+        if (!device->sample_rates) {
             soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
+            return SoundIoErrorNoMem;
         }
+        memcpy(device->sample_rates, spec->sample_rates,
+                device->sample_rate_count * sizeof(struct SoundIoSampleRateRange));
+    } else {
         set_all_device_sample_rates(device);
+    }
+    device->sample_rate_current = soundio_device_nearest_sample_rate(device,
+            (spec->sample_rate_current > 0) ? spec->sample_rate_current : 48000);
+
+    device->software_latency_min = (spec->software_latency_min > 0.0) ? spec->software_latency_min : 0.01;
+    device->software_latency_max = (spec->software_latency_max > 0.0) ? spec->software_latency_max : 4.0;
+    if (device->software_latency_max < device->software_latency_min)
+        device->software_latency_max = device->software_latency_min;
+    device->software_latency_current = (spec->software_latency_current > 0.0) ?
+        spec->software_latency_current : 0.1;
+    device->software_latency_current = soundio_double_clamp(device->software_latency_min,
+            device->software_latency_current, device->software_latency_max);
+
+    *out_device = device;
+    return 0;
+}
+
+static struct SoundIoListDevicePtr *device_list_for_aim(struct SoundIoDevicesInfo *devices_info,
+        enum SoundIoDeviceAim aim)
+{
+    return (aim == SoundIoDeviceAimInput) ? &devices_info->input_devices : &devices_info->output_devices;
+}
 
-        device->software_latency_current = 0.1;
-        device->software_latency_min = 0.01;
-        device->software_latency_max = 4.0;
+static int find_device(struct SoundIoListDevicePtr *list, const char *id) {
+    for (int i = 0; i < list->length; i += 1) {
+        struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(list, i);
+        if (strcmp(device->id, id) == 0)
+            return i;
+    }
+    return -1;
+}
 
-        device->sample_rate_current = 48000;
-        device->aim = SoundIoDeviceAimOutput;
+// The first device of each aim is the default one.
+static void set_default_device_indexes(struct SoundIoDevicesInfo *devices_info) {
+    devices_info->default_input_index = (devices_info->input_devices.length > 0) ? 0 : -1;
+    devices_info->default_output_index = (devices_info->output_devices.length > 0) ? 0 : -1;
+}
 
-        if (SoundIoListDevicePtr_append(&si->safe_devices_info->output_devices, device)) {
+static int add_device(struct SoundIoPrivate *si, struct SoundIoDevicesInfo *devices_info,
+        const struct SoundIoDummyDeviceSpec *spec)
+{
+    if (!spec_is_valid(spec))
+        return SoundIoErrorInvalid;
+
+    struct SoundIoListDevicePtr *list = device_list_for_aim(devices_info, spec->aim);
+    if (find_device(list, spec->id) >= 0)
+        return SoundIoErrorInvalid;
+
+    int err;
+    struct SoundIoDevice *device;
+    if ((err = create_device(si, spec, &device)))
+        return err;
+
+    if (SoundIoListDevicePtr_append(list, device)) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+    set_default_device_indexes(devices_info);
+    return 0;
+}
+
+static int copy_device_list(struct SoundIoListDevicePtr *dest, struct SoundIoListDevicePtr *src) {
+    int err;
+    if ((err = SoundIoListDevicePtr_ensure_capacity(dest, src->length)))
+        return err;
+    for (int i = 0; i < src->length; i += 1) {
+        struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(src, i);
+        soundio_device_ref(device);
+        if ((err = SoundIoListDevicePtr_append(dest, device))) {
             soundio_device_unref(device);
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
+            return err;
         }
     }
+    return 0;
+}
+
+// Returns a snapshot of devices_info for flush_events. The devices themselves
+// are shared by reference, so only the lists are copied.
+static struct SoundIoDevicesInfo *copy_devices_info(struct SoundIoDevicesInfo *src) {
+    struct SoundIoDevicesInfo *devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!devices_info)
+        return NULL;
 
-    // create input device
+    if (copy_device_list(&devices_info->input_devices, &src->input_devices) ||
+        copy_device_list(&devices_info->output_devices, &src->output_devices))
     {
-        struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
-        if (!dev) {
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
-        struct SoundIoDevice *device = &dev->pub;
+        soundio_destroy_devices_info(devices_info);
+        return NULL;
+    }
+    devices_info->default_input_index = src->default_input_index;
+    devices_info->default_output_index = src->default_output_index;
+    return devices_info;
+}
 
-        device->ref_count = 1;
-        device->soundio = soundio;
-        device->id = strdup("dummy-in");
-        device->name = strdup("Dummy Input Device");
-        if (!device->id || !device->name) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return SoundIoErrorNoMem;
-        }
+// call this while holding sid->mutex
+static int publish_devices(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
 
-        int err;
-        if ((err = set_all_device_channel_layouts(device))) {
-            soundio_device_unref(device);
-            destroy_dummy(si);
-            return err;
-        }
+    struct SoundIoDevicesInfo *devices_info = copy_devices_info(sid->devices_info);
+    if (!devices_info)
+        return SoundIoErrorNoMem;
 
-        if ((err = set_all_device_formats(device))) {
-            soundio_device_unref(device);
+    soundio_destroy_devices_info(sid->ready_devices_info);
+    sid->ready_devices_info = devices_info;
+    soundio_os_cond_signal(sid->cond, NULL);
+    soundio->on_events_signal(soundio);
+    return 0;
+}
+
+static int add_dummy_device_dummy(struct SoundIoPrivate *si, const struct SoundIoDummyDeviceSpec *spec) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    int err;
+
+    soundio_os_mutex_lock(sid->mutex);
+    if (!(err = add_device(si, sid->devices_info, spec)))
+        err = publish_devices(si);
+    soundio_os_mutex_unlock(sid->mutex);
+
+    return err;
+}
+
+static int remove_dummy_device_dummy(struct SoundIoPrivate *si, enum SoundIoDeviceAim aim, const char *id) {
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    if (!id)
+        return SoundIoErrorInvalid;
+
+    soundio_os_mutex_lock(sid->mutex);
+    struct SoundIoListDevicePtr *list = device_list_for_aim(sid->devices_info, aim);
+    int index = find_device(list, id);
+    if (index < 0) {
+        soundio_os_mutex_unlock(sid->mutex);
+        return SoundIoErrorInvalid;
+    }
+
+    // keep the order so that the first device stays the default one
+    struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(list, index);
+    for (int i = index + 1; i < list->length; i += 1)
+        *SoundIoListDevicePtr_ptr_at(list, i - 1) = SoundIoListDevicePtr_val_at(list, i);
+    SoundIoListDevicePtr_pop(list);
+    soundio_device_unref(device);
+    set_default_device_indexes(sid->devices_info);
+
+    int err = publish_devices(si);
+    soundio_os_mutex_unlock(sid->mutex);
+
+    return err;
+}
+
+static bool fault_probability_is_valid(double probability) {
+    return probability >= 0.0 && probability <= 1.0;
+}
+
+int soundio_dummy_init(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoDummy *sid = &si->backend_data.dummy;
+    int err;
+
+    sid->mutex = soundio_os_mutex_create();
+    if (!sid->mutex) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
+    }
+
+    sid->cond = soundio_os_cond_create();
+    if (!sid->cond) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
+    }
+
+    sid->clock = soundio->dummy_clock;
+    sid->clock_cond = soundio_os_cond_create();
+    if (!sid->clock_cond) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
+    }
+
+    if (soundio->dummy_device_count < 0 || (soundio->dummy_device_count > 0 && !soundio->dummy_devices) ||
+        soundio->dummy_loopback_delay < 0.0)
+    {
+        destroy_dummy(si);
+        return SoundIoErrorInvalid;
+    }
+    sid->loopback_delay = soundio_seconds_to_ns(soundio->dummy_loopback_delay);
+
+    if (soundio->dummy_faults) {
+        const struct SoundIoDummyFaults *faults = soundio->dummy_faults;
+        if (!fault_probability_is_valid(faults->stall_probability) ||
+            !fault_probability_is_valid(faults->underflow_probability) ||
+            !fault_probability_is_valid(faults->overflow_probability) ||
+            !fault_probability_is_valid(faults->error_probability) ||
+            faults->jitter < 0.0 || faults->stall_duration < 0.0 || faults->disconnect_after < 0.0 ||
+            (faults->jitter_distribution != SoundIoDummyJitterUniform &&
+             faults->jitter_distribution != SoundIoDummyJitterExponential))
+        {
             destroy_dummy(si);
-            return err;
+            return SoundIoErrorInvalid;
         }
-        set_all_device_sample_rates(device);
-        device->software_latency_current = 0.1;
-        device->software_latency_min = 0.01;
-        device->software_latency_max = 4.0;
-        device->sample_rate_current = 48000;
-        device->aim = SoundIoDeviceAimInput;
+        sid->faults_copy = *faults;
+        sid->faults = &sid->faults_copy;
+        sid->disconnect_time = clock_now(sid, sid->clock_time) +
+            soundio_seconds_to_ns(faults->disconnect_after);
+    }
 
-        if (SoundIoListDevicePtr_append(&si->safe_devices_info->input_devices, device)) {
-            soundio_device_unref(device);
+    sid->devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!sid->devices_info) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
+    }
+
+    if (soundio->dummy_device_count > 0) {
+        for (int i = 0; i < soundio->dummy_device_count; i += 1) {
+            if ((err = add_device(si, sid->devices_info, &soundio->dummy_devices[i]))) {
+                destroy_dummy(si);
+                return err;
+            }
+        }
+    } else {
+        struct SoundIoDummyDeviceSpec output_spec;
+        memset(&output_spec, 0, sizeof(struct SoundIoDummyDeviceSpec));
+        output_spec.id = "dummy-out";
+        output_spec.name = "Dummy Output Device";
+        output_spec.aim = SoundIoDeviceAimOutput;
+
+        struct SoundIoDummyDeviceSpec input_spec;
+        memset(&input_spec, 0, sizeof(struct SoundIoDummyDeviceSpec));
+        input_spec.id = "dummy-in";
+        input_spec.name = "Dummy Input Device";
+        input_spec.aim = SoundIoDeviceAimInput;
+        if (soundio->dummy_loopback)
+            input_spec.loopback_id = output_spec.id;
+
+        if ((err = add_device(si, sid->devices_info, &output_spec)) ||
+            (err = add_device(si, sid->devices_info, &input_spec)))
+        {
             destroy_dummy(si);
-            return SoundIoErrorNoMem;
+            return err;
         }
     }
 
+    assert(!si->safe_devices_info);
+    si->safe_devices_info = copy_devices_info(sid->devices_info);
+    if (!si->safe_devices_info) {
+        destroy_dummy(si);
+        return SoundIoErrorNoMem;
+    }
 
     si->destroy = destroy_dummy;
     si->flush_events = flush_events_dummy;
     si->wait_events = wait_events_dummy;
     si->wakeup = wakeup_dummy;
     si->force_device_scan = force_device_scan_dummy;
+    si->advance_clock = advance_clock_dummy;
+    si->add_dummy_device = add_dummy_device_dummy;
+    si->remove_dummy_device = remove_dummy_device_dummy;
 
     si->outstream_open = outstream_open_dummy;
     si->outstream_destroy = outstream_destroy_dummy;
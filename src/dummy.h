@@ -12,44 +12,107 @@
 #include "os.h"
 #include "ring_buffer.h"
 #include "atomics.h"
+#include "list.h"
 
 struct SoundIoPrivate;
+struct SoundIoOutStreamPrivate;
+struct SoundIoInStreamPrivate;
 int soundio_dummy_init(struct SoundIoPrivate *si);
 
+// A stream thread blocked until the SoundIoDummyClockManual clock reaches
+// wait_until. Protected by SoundIoDummy::mutex.
+struct SoundIoDummyClockWaiter {
+    struct SoundIoOsCond *cond;
+    int64_t wait_until;
+    bool waiting;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoDummyClockWaiter *, SoundIoListDummyClockWaiterPtr, SOUNDIO_LIST_STATIC)
+
+// Carries the frames played on a dummy output device to one input stream
+// capturing it. Protected by SoundIoDummy::mutex.
+struct SoundIoDummyLoopback {
+    struct SoundIoInStreamPrivate *is;
+    // the output stream being captured, or NULL until one plays
+    struct SoundIoOutStreamPrivate *source;
+    struct SoundIoRingBuffer ring_buffer;
+    // when the last frame in ring_buffer was played
+    int64_t end_time;
+    // the end of the last period captured by the input stream
+    int64_t capture_time;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoDummyLoopback *, SoundIoListDummyLoopbackPtr, SOUNDIO_LIST_STATIC)
+
 struct SoundIoDummy {
     struct SoundIoOsMutex *mutex;
     struct SoundIoOsCond *cond;
     bool devices_emitted;
+    // the device list as of the last hotplug event. protected by mutex
+    struct SoundIoDevicesInfo *devices_info;
+    // ready to be swapped in by flush_events. protected by mutex
+    struct SoundIoDevicesInfo *ready_devices_info;
+    // All times are in nanoseconds, read from soundio_os_get_time_ns with
+    // SoundIoDummyClockReal and from the virtual clock otherwise.
+    enum SoundIoDummyClock clock;
+    // the rest is only used with SoundIoDummyClockManual and is protected by
+    // mutex
+    int64_t clock_time;
+    struct SoundIoOsCond *clock_cond;
+    struct SoundIoListDummyClockWaiterPtr clock_waiters;
+    // stream threads that have not yet caught up with clock_time
+    int busy_stream_count;
+    // started input streams of loopback devices. protected by mutex
+    struct SoundIoListDummyLoopbackPtr loopbacks;
+    int64_t loopback_delay;
+    // NULL unless faults are injected, else points to faults_copy
+    const struct SoundIoDummyFaults *faults;
+    struct SoundIoDummyFaults faults_copy;
+    // the rest is protected by mutex
+    int64_t disconnect_time;
+    bool disconnected;
+    bool emitted_disconnect;
+    int fault_stream_count;
 };
 
-struct SoundIoDeviceDummy { int make_the_struct_not_empty; };
+struct SoundIoDeviceDummy {
+    // id of the output device captured by this input device, or NULL
+    char *loopback_id;
+};
 
 struct SoundIoOutStreamDummy {
     struct SoundIoOsThread *thread;
     struct SoundIoOsCond *cond;
     struct SoundIoAtomicFlag abort_flag;
-    double period_duration;
+    int64_t period_duration;
     int buffer_frame_count;
     int frames_left;
     int write_frame_count;
     struct SoundIoRingBuffer ring_buffer;
-    double playback_start_time;
     struct SoundIoAtomicFlag clear_buffer_flag;
     struct SoundIoAtomicBool pause_requested;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    // time as seen by the stream thread with a virtual clock
+    int64_t clock_time;
+    struct SoundIoDummyClockWaiter clock_waiter;
+    uint64_t fault_state;
 };
 
 struct SoundIoInStreamDummy {
     struct SoundIoOsThread *thread;
     struct SoundIoOsCond *cond;
     struct SoundIoAtomicFlag abort_flag;
-    double period_duration;
+    int64_t period_duration;
     int frames_left;
     int read_frame_count;
     int buffer_frame_count;
     struct SoundIoRingBuffer ring_buffer;
     struct SoundIoAtomicBool pause_requested;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    int64_t clock_time;
+    struct SoundIoDummyClockWaiter clock_waiter;
+    struct SoundIoDummyLoopback loopback;
+    uint64_t fault_state;
 };
 
 #endif
@@ -0,0 +1,815 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "file.h"
+#include "soundio_private.h"
+
+#include <string.h>
+
+static const enum SoundIoFormat wav_formats[] = {
+    SoundIoFormatFloat32LE,
+    SoundIoFormatFloat64LE,
+    SoundIoFormatS32LE,
+    SoundIoFormatS16LE,
+    SoundIoFormatU8,
+};
+
+static const enum SoundIoFormat raw_formats[] = {
+    SoundIoFormatFloat32NE,
+    SoundIoFormatFloat32FE,
+    SoundIoFormatS32NE,
+    SoundIoFormatS32FE,
+    SoundIoFormatU32NE,
+    SoundIoFormatU32FE,
+    SoundIoFormatS24NE,
+    SoundIoFormatS24FE,
+    SoundIoFormatU24NE,
+    SoundIoFormatU24FE,
+    SoundIoFormatFloat64NE,
+    SoundIoFormatFloat64FE,
+    SoundIoFormatS16NE,
+    SoundIoFormatS16FE,
+    SoundIoFormatU16NE,
+    SoundIoFormatU16FE,
+    SoundIoFormatS8,
+    SoundIoFormatU8,
+};
+
+static const int WAVE_FORMAT_PCM = 0x0001;
+static const int WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+static const int WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+
+// the rest of the KSDATAFORMAT_SUBTYPE_PCM and _IEEE_FLOAT GUIDs, after the
+// format tag
+static const unsigned char wav_guid_tail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71,
+};
+
+// bigger buffers mean fewer, larger writes
+static const double default_software_latency = 0.5;
+
+static void put_u16le(unsigned char *ptr, unsigned int value) {
+    ptr[0] = value & 0xff;
+    ptr[1] = (value >> 8) & 0xff;
+}
+
+static void put_u32le(unsigned char *ptr, unsigned long value) {
+    put_u16le(ptr, value & 0xffff);
+    put_u16le(ptr + 2, (value >> 16) & 0xffff);
+}
+
+static unsigned int get_u16le(const unsigned char *ptr) {
+    return ptr[0] | (ptr[1] << 8);
+}
+
+static unsigned long get_u32le(const unsigned char *ptr) {
+    return get_u16le(ptr) | ((unsigned long)get_u16le(ptr + 2) << 16);
+}
+
+static bool wav_supports_format(enum SoundIoFormat format) {
+    for (int i = 0; i < ARRAY_LENGTH(wav_formats); i += 1) {
+        if (wav_formats[i] == format)
+            return true;
+    }
+    return false;
+}
+
+// WAV files list their speakers in this order, one bit each.
+static unsigned long wav_channel_mask(const struct SoundIoChannelLayout *layout) {
+    unsigned long mask = 0;
+    int prev_bit = -1;
+    for (int i = 0; i < layout->channel_count; i += 1) {
+        enum SoundIoChannelId id = layout->channels[i];
+        if (id < SoundIoChannelIdFrontLeft || id > SoundIoChannelIdTopBackRight)
+            return 0;
+        int bit = id - SoundIoChannelIdFrontLeft;
+        if (bit <= prev_bit)
+            return 0;
+        mask |= 1UL << bit;
+        prev_bit = bit;
+    }
+    return mask;
+}
+
+static int wav_header_size(const struct SoundIoOutStream *outstream) {
+    int fmt_size = (outstream->layout.channel_count > 2) ? 40 : 16;
+    return 12 + 8 + fmt_size + 8;
+}
+
+static void wav_write_header(const struct SoundIoOutStream *outstream, unsigned char *header,
+        long long data_byte_count)
+{
+    int header_size = wav_header_size(outstream);
+    int fmt_size = header_size - 12 - 8 - 8;
+    bool extensible = (fmt_size == 40);
+    bool is_float = (outstream->format == SoundIoFormatFloat32LE ||
+            outstream->format == SoundIoFormatFloat64LE);
+    int format_tag = is_float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+    int bits = outstream->bytes_per_sample * 8;
+    // sizes are limited to 32 bits; readers that know better ignore them
+    long long riff_size = header_size - 8 + data_byte_count + (data_byte_count & 1);
+    unsigned long riff_size_field = (riff_size > 0xffffffffLL) ? 0xffffffffUL : (unsigned long)riff_size;
+    unsigned long data_size_field = (data_byte_count > 0xffffffffLL) ? 0xffffffffUL : (unsigned long)data_byte_count;
+
+    memcpy(header, "RIFF", 4);
+    put_u32le(header + 4, riff_size_field);
+    memcpy(header + 8, "WAVE", 4);
+
+    unsigned char *fmt = header + 12;
+    memcpy(fmt, "fmt ", 4);
+    put_u32le(fmt + 4, fmt_size);
+    put_u16le(fmt + 8, extensible ? WAVE_FORMAT_EXTENSIBLE : format_tag);
+    put_u16le(fmt + 10, outstream->layout.channel_count);
+    put_u32le(fmt + 12, outstream->sample_rate);
+    put_u32le(fmt + 16, (unsigned long)outstream->sample_rate * outstream->bytes_per_frame);
+    put_u16le(fmt + 20, outstream->bytes_per_frame);
+    put_u16le(fmt + 22, bits);
+    if (extensible) {
+        put_u16le(fmt + 24, 22);
+        put_u16le(fmt + 26, bits);
+        put_u32le(fmt + 28, wav_channel_mask(&outstream->layout));
+        put_u16le(fmt + 32, format_tag);
+        memcpy(fmt + 34, wav_guid_tail, sizeof(wav_guid_tail));
+    }
+
+    unsigned char *data = fmt + 8 + fmt_size;
+    memcpy(data, "data", 4);
+    put_u32le(data + 4, data_size_field);
+}
+
+// Finds the samples in a WAV file and describes them in device.
+static int wav_probe(FILE *file, struct SoundIoDevicePrivate *dev) {
+    struct SoundIoDevice *device = &dev->pub;
+    struct SoundIoDeviceFile *devf = &dev->backend_data.file;
+    unsigned char riff[12];
+    if (fread(riff, 1, 12, file) != 12 || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4))
+        return SoundIoErrorIncompatibleDevice;
+
+    bool have_fmt = false;
+    unsigned char fmt[40];
+    unsigned long fmt_size = 0;
+    for (;;) {
+        unsigned char chunk[8];
+        if (fread(chunk, 1, 8, file) != 8)
+            return SoundIoErrorIncompatibleDevice;
+        unsigned long chunk_size = get_u32le(chunk + 4);
+        if (memcmp(chunk, "data", 4) == 0) {
+            devf->data_offset = ftell(file);
+            // 0 is what a writer that never finished leaves behind
+            devf->data_byte_count = (chunk_size == 0 || chunk_size == 0xffffffffUL) ? -1 : (long long)chunk_size;
+            break;
+        }
+        unsigned long skip_size = chunk_size + (chunk_size & 1);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            fmt_size = (chunk_size < sizeof(fmt)) ? chunk_size : sizeof(fmt);
+            if (fmt_size < 16 || fread(fmt, 1, fmt_size, file) != fmt_size)
+                return SoundIoErrorIncompatibleDevice;
+            have_fmt = true;
+            skip_size -= fmt_size;
+        }
+        if (fseek(file, skip_size, SEEK_CUR))
+            return SoundIoErrorIncompatibleDevice;
+    }
+    if (!have_fmt)
+        return SoundIoErrorIncompatibleDevice;
+
+    int format_tag = get_u16le(fmt);
+    int channel_count = get_u16le(fmt + 2);
+    int sample_rate = get_u32le(fmt + 4);
+    int bits = get_u16le(fmt + 14);
+    unsigned long channel_mask = 0;
+    if (format_tag == WAVE_FORMAT_EXTENSIBLE) {
+        if (fmt_size < 40 || get_u16le(fmt + 18) != bits || memcmp(fmt + 26, wav_guid_tail, sizeof(wav_guid_tail)))
+            return SoundIoErrorIncompatibleDevice;
+        channel_mask = get_u32le(fmt + 20);
+        format_tag = get_u16le(fmt + 24);
+    }
+
+    enum SoundIoFormat format = SoundIoFormatInvalid;
+    if (format_tag == WAVE_FORMAT_PCM) {
+        switch (bits) {
+            case 8: format = SoundIoFormatU8; break;
+            case 16: format = SoundIoFormatS16LE; break;
+            case 32: format = SoundIoFormatS32LE; break;
+        }
+    } else if (format_tag == WAVE_FORMAT_IEEE_FLOAT) {
+        switch (bits) {
+            case 32: format = SoundIoFormatFloat32LE; break;
+            case 64: format = SoundIoFormatFloat64LE; break;
+        }
+    }
+    if (format == SoundIoFormatInvalid || channel_count < 1 || channel_count > SOUNDIO_MAX_CHANNELS ||
+        sample_rate <= 0)
+    {
+        return SoundIoErrorIncompatibleDevice;
+    }
+
+    device->current_format = format;
+    device->sample_rate_current = sample_rate;
+    device->current_layout.channel_count = channel_count;
+
+    // use the speakers the file names, if it names one for every channel
+    int channel = 0;
+    for (int bit = 0; bit <= SoundIoChannelIdTopBackRight - SoundIoChannelIdFrontLeft; bit += 1) {
+        if ((channel_mask & (1UL << bit)) && channel < channel_count)
+            device->current_layout.channels[channel++] = (enum SoundIoChannelId)(SoundIoChannelIdFrontLeft + bit);
+    }
+    if (channel != channel_count) {
+        const struct SoundIoChannelLayout *layout = soundio_channel_layout_get_default(channel_count);
+        if (layout) {
+            device->current_layout = *layout;
+        } else {
+            for (int i = 0; i < channel_count; i += 1)
+                device->current_layout.channels[i] = (enum SoundIoChannelId)(SoundIoChannelIdAux0 + i);
+        }
+    }
+    soundio_channel_layout_detect_builtin(&device->current_layout);
+    return 0;
+}
+
+static int probe_input_device(struct SoundIoDevicePrivate *dev, const struct SoundIoFileDeviceSpec *spec) {
+    struct SoundIoDevice *device = &dev->pub;
+    struct SoundIoDeviceFile *devf = &dev->backend_data.file;
+
+    if (spec->type == SoundIoFileTypeRaw) {
+        if (spec->raw_format <= SoundIoFormatInvalid || spec->raw_sample_rate <= 0 ||
+            spec->raw_channel_count < 1 || spec->raw_channel_count > SOUNDIO_MAX_CHANNELS)
+        {
+            return SoundIoErrorInvalid;
+        }
+        devf->data_offset = 0;
+        devf->data_byte_count = -1;
+        device->current_format = spec->raw_format;
+        device->sample_rate_current = spec->raw_sample_rate;
+        const struct SoundIoChannelLayout *layout = soundio_channel_layout_get_default(spec->raw_channel_count);
+        if (layout) {
+            device->current_layout = *layout;
+        } else {
+            device->current_layout.channel_count = spec->raw_channel_count;
+            for (int i = 0; i < spec->raw_channel_count; i += 1)
+                device->current_layout.channels[i] = (enum SoundIoChannelId)(SoundIoChannelIdAux0 + i);
+        }
+        return 0;
+    }
+
+    FILE *file = fopen(spec->path, "rb");
+    if (!file)
+        return SoundIoErrorOpeningDevice;
+    int err = wav_probe(file, dev);
+    fclose(file);
+    return err;
+}
+
+static int create_device(struct SoundIoPrivate *si, const struct SoundIoFileDeviceSpec *spec,
+        struct SoundIoDevice **out_device)
+{
+    struct SoundIo *soundio = &si->pub;
+
+    if (!spec->path || (spec->aim != SoundIoDeviceAimInput && spec->aim != SoundIoDeviceAimOutput) ||
+        (spec->type != SoundIoFileTypeWav && spec->type != SoundIoFileTypeRaw))
+    {
+        return SoundIoErrorInvalid;
+    }
+
+    struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
+    if (!dev)
+        return SoundIoErrorNoMem;
+    struct SoundIoDevice *device = &dev->pub;
+    struct SoundIoDeviceFile *devf = &dev->backend_data.file;
+
+    device->ref_count = 1;
+    device->soundio = soundio;
+    device->aim = spec->aim;
+    devf->type = spec->type;
+    device->id = strdup(spec->path);
+    device->name = strdup(spec->path);
+    if (!device->id || !device->name) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+
+    device->software_latency_min = 0.001;
+    device->software_latency_max = 10.0;
+    device->software_latency_current = default_software_latency;
+
+    if (spec->aim == SoundIoDeviceAimOutput) {
+        const enum SoundIoFormat *formats = (spec->type == SoundIoFileTypeWav) ? wav_formats : raw_formats;
+        device->format_count = (spec->type == SoundIoFileTypeWav) ?
+            ARRAY_LENGTH(wav_formats) : ARRAY_LENGTH(raw_formats);
+        device->formats = ALLOCATE_NONZERO(enum SoundIoFormat, device->format_count);
+        device->layout_count = soundio_channel_layout_builtin_count();
+        device->layouts = ALLOCATE(struct SoundIoChannelLayout, device->layout_count);
+        if (!device->formats || !device->layouts) {
+            soundio_device_unref(device);
+            return SoundIoErrorNoMem;
+        }
+        memcpy(device->formats, formats, device->format_count * sizeof(enum SoundIoFormat));
+        for (int i = 0; i < device->layout_count; i += 1)
+            device->layouts[i] = *soundio_channel_layout_get_builtin(i);
+        device->current_format = device->formats[0];
+        device->current_layout = *soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
+
+        device->sample_rate_count = 1;
+        device->sample_rates = &dev->prealloc_sample_rate_range;
+        device->sample_rates[0].min = SOUNDIO_MIN_SAMPLE_RATE;
+        device->sample_rates[0].max = SOUNDIO_MAX_SAMPLE_RATE;
+        device->sample_rate_current = 48000;
+    } else {
+        int err;
+        if ((err = probe_input_device(dev, spec))) {
+            if (err == SoundIoErrorInvalid) {
+                soundio_device_unref(device);
+                return err;
+            }
+            // list the device anyway, so that the problem can be reported
+            device->probe_error = err;
+        } else {
+            // an input file has exactly the one format it was written in
+            device->format_count = 1;
+            device->formats = &dev->prealloc_format;
+            device->formats[0] = device->current_format;
+            device->layout_count = 1;
+            device->layouts = &device->current_layout;
+            device->sample_rate_count = 1;
+            device->sample_rates = &dev->prealloc_sample_rate_range;
+            device->sample_rates[0].min = device->sample_rate_current;
+            device->sample_rates[0].max = device->sample_rate_current;
+        }
+    }
+
+    *out_device = device;
+    return 0;
+}
+
+static void destroy_file(struct SoundIoPrivate *si) {
+    struct SoundIoFile *sif = &si->backend_data.file;
+
+    if (sif->cond)
+        soundio_os_cond_destroy(sif->cond);
+}
+
+static void flush_events_file(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoFile *sif = &si->backend_data.file;
+    if (sif->devices_emitted)
+        return;
+    sif->devices_emitted = true;
+    soundio->on_devices_change(soundio);
+}
+
+static void wait_events_file(struct SoundIoPrivate *si) {
+    struct SoundIoFile *sif = &si->backend_data.file;
+    flush_events_file(si);
+    soundio_os_cond_wait(sif->cond, NULL);
+}
+
+static void wakeup_file(struct SoundIoPrivate *si) {
+    struct SoundIoFile *sif = &si->backend_data.file;
+    soundio_os_cond_signal(sif->cond, NULL);
+}
+
+static void force_device_scan_file(struct SoundIoPrivate *si) {
+    // nothing to do; the devices are the files given when connecting
+}
+
+// Writes out the buffer in one go, keeping the header of a WAV file in front
+// of the first frames.
+static void outstream_flush_file(struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+    if (osf->buffer_used == 0 || osf->write_failed)
+        return;
+    if (fwrite(osf->buffer, 1, osf->buffer_used, osf->file) != (size_t)osf->buffer_used)
+        osf->write_failed = true;
+    osf->buffer_used = 0;
+}
+
+static void playback_thread_run(void *arg) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)arg;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+
+    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osf->abort_flag)) {
+        if (SOUNDIO_ATOMIC_LOAD(osf->pause_requested)) {
+            soundio_os_cond_timed_wait(osf->cond, NULL, 0.1);
+            continue;
+        }
+
+        int free_frames = (osf->buffer_capacity - osf->buffer_used) / outstream->bytes_per_frame;
+        if (free_frames == 0) {
+            outstream_flush_file(os);
+        } else {
+            osf->frames_left = free_frames;
+            osf->in_callback = true;
+            outstream->write_callback(outstream, 0, free_frames);
+            osf->in_callback = false;
+            // frames that were never committed are dropped
+            osf->writing = false;
+
+            // the application has nothing to write right now, for example
+            // because it is done and about to destroy the stream
+            if (osf->frames_left == free_frames) {
+                outstream_flush_file(os);
+                soundio_os_cond_timed_wait(osf->cond, NULL, 0.1);
+            }
+        }
+
+        if (osf->write_failed) {
+            outstream->error_callback(outstream, SoundIoErrorStreaming);
+            return;
+        }
+    }
+}
+
+static void outstream_destroy_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+
+    if (osf->thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(osf->abort_flag);
+        soundio_os_cond_signal(osf->cond, NULL);
+        soundio_os_thread_destroy(osf->thread);
+        osf->thread = NULL;
+    }
+
+    if (osf->file) {
+        outstream_flush_file(os);
+        struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)outstream->device;
+        if (dev->backend_data.file.type == SoundIoFileTypeWav && !osf->write_failed) {
+            // now that the size of the data is known
+            unsigned char header[68];
+            wav_write_header(outstream, header, osf->data_byte_count);
+            if (osf->data_byte_count & 1)
+                fputc(0, osf->file);
+            if (fseek(osf->file, 0, SEEK_SET) == 0)
+                fwrite(header, 1, osf->header_size, osf->file);
+        }
+        fclose(osf->file);
+        osf->file = NULL;
+    }
+
+    soundio_os_cond_destroy(osf->cond);
+    osf->cond = NULL;
+
+    free(osf->buffer);
+    osf->buffer = NULL;
+}
+
+static int outstream_open_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoDevice *device = outstream->device;
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
+    bool wav = (dev->backend_data.file.type == SoundIoFileTypeWav);
+
+    if (wav && !wav_supports_format(outstream->format))
+        return SoundIoErrorIncompatibleDevice;
+
+    SOUNDIO_ATOMIC_STORE(osf->pause_requested, false);
+
+    if (outstream->software_latency == 0.0)
+        outstream->software_latency = device->software_latency_current;
+    outstream->software_latency = soundio_double_clamp(device->software_latency_min,
+            outstream->software_latency, device->software_latency_max);
+
+    int buffer_frame_count = soundio_int_max(1, outstream->software_latency * outstream->sample_rate);
+    outstream->software_latency = buffer_frame_count / (double)outstream->sample_rate;
+    osf->header_size = wav ? wav_header_size(outstream) : 0;
+    osf->buffer_capacity = osf->header_size + buffer_frame_count * outstream->bytes_per_frame;
+    osf->buffer = ALLOCATE_NONZERO(char, osf->buffer_capacity);
+    if (!osf->buffer) {
+        outstream_destroy_file(si, os);
+        return SoundIoErrorNoMem;
+    }
+
+    // a placeholder until the size of the data is known
+    if (wav)
+        wav_write_header(outstream, (unsigned char *)osf->buffer, 0);
+    osf->buffer_used = osf->header_size;
+
+    osf->cond = soundio_os_cond_create();
+    if (!osf->cond) {
+        outstream_destroy_file(si, os);
+        return SoundIoErrorNoMem;
+    }
+
+    osf->file = fopen(device->id, "wb");
+    if (!osf->file) {
+        outstream_destroy_file(si, os);
+        return SoundIoErrorOpeningDevice;
+    }
+    // the stream buffer is large enough already
+    setvbuf(osf->file, NULL, _IONBF, 0);
+
+    return 0;
+}
+
+static int outstream_pause_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, bool pause) {
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+    SOUNDIO_ATOMIC_STORE(osf->pause_requested, pause);
+    soundio_os_cond_signal(osf->cond, NULL);
+    return 0;
+}
+
+static int outstream_start_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+    struct SoundIo *soundio = &si->pub;
+    assert(!osf->thread);
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osf->abort_flag);
+    return soundio_os_thread_create(playback_thread_run, os, soundio->emit_rtprio_warning,
+            &os->thread_policy, 0, &osf->thread);
+}
+
+static int outstream_begin_write_file(struct SoundIoPrivate *si,
+        struct SoundIoOutStreamPrivate *os, struct SoundIoChannelArea **out_areas, int *frame_count)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+
+    if (!osf->in_callback || osf->writing)
+        return SoundIoErrorInvalid;
+    if (*frame_count <= 0 || *frame_count > osf->frames_left)
+        return SoundIoErrorInvalid;
+
+    char *write_ptr = osf->buffer + osf->buffer_used;
+    for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+        osf->areas[ch].ptr = write_ptr + outstream->bytes_per_sample * ch;
+        osf->areas[ch].step = outstream->bytes_per_frame;
+    }
+
+    osf->writing = true;
+    osf->write_frame_count = *frame_count;
+    *out_areas = osf->areas;
+    return 0;
+}
+
+static int outstream_end_write_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamFile *osf = &os->backend_data.file;
+    struct SoundIoOutStream *outstream = &os->pub;
+    if (!osf->writing)
+        return SoundIoErrorInvalid;
+    int byte_count = osf->write_frame_count * outstream->bytes_per_frame;
+    osf->buffer_used += byte_count;
+    osf->data_byte_count += byte_count;
+    osf->frames_left -= osf->write_frame_count;
+    osf->writing = false;
+    return 0;
+}
+
+static int outstream_clear_buffer_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    // committed frames count as played
+    return 0;
+}
+
+static int outstream_get_latency_file(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        double *out_latency)
+{
+    *out_latency = 0.0;
+    return 0;
+}
+
+static void capture_thread_run(void *arg) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)arg;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+
+    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isf->abort_flag)) {
+        if (SOUNDIO_ATOMIC_LOAD(isf->pause_requested)) {
+            soundio_os_cond_timed_wait(isf->cond, NULL, 0.1);
+            continue;
+        }
+
+        // keep what the last callback left unread and fill the rest
+        if (isf->buffer_start > 0) {
+            memmove(isf->buffer, isf->buffer + isf->buffer_start, isf->buffer_end - isf->buffer_start);
+            isf->buffer_end -= isf->buffer_start;
+            isf->buffer_start = 0;
+        }
+        long long read_size = isf->buffer_capacity - isf->buffer_end;
+        if (isf->data_bytes_left >= 0 && read_size > isf->data_bytes_left)
+            read_size = isf->data_bytes_left;
+        if (read_size > 0) {
+            size_t amt = fread(isf->buffer + isf->buffer_end, 1, read_size, isf->file);
+            isf->buffer_end += amt;
+            if (isf->data_bytes_left >= 0)
+                isf->data_bytes_left -= amt;
+        }
+
+        int fill_frames = (isf->buffer_end - isf->buffer_start) / instream->bytes_per_frame;
+        if (fill_frames == 0) {
+            instream->error_callback(instream, ferror(isf->file) ? SoundIoErrorStreaming : SoundIoErrorEndOfFile);
+            return;
+        }
+
+        isf->frames_left = fill_frames;
+        isf->in_callback = true;
+        instream->read_callback(instream, 0, fill_frames);
+        isf->in_callback = false;
+        isf->reading = false;
+
+        if (isf->frames_left == fill_frames)
+            soundio_os_cond_timed_wait(isf->cond, NULL, 0.1);
+    }
+}
+
+static void instream_destroy_file(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+
+    if (isf->thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(isf->abort_flag);
+        soundio_os_cond_signal(isf->cond, NULL);
+        soundio_os_thread_destroy(isf->thread);
+        isf->thread = NULL;
+    }
+
+    if (isf->file) {
+        fclose(isf->file);
+        isf->file = NULL;
+    }
+
+    soundio_os_cond_destroy(isf->cond);
+    isf->cond = NULL;
+
+    free(isf->buffer);
+    isf->buffer = NULL;
+}
+
+static int instream_open_file(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoDevice *device = instream->device;
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
+    struct SoundIoDeviceFile *devf = &dev->backend_data.file;
+
+    // there is nothing to convert the samples with
+    if (instream->format != device->current_format ||
+        instream->sample_rate != device->sample_rate_current ||
+        instream->layout.channel_count != device->current_layout.channel_count)
+    {
+        return SoundIoErrorIncompatibleDevice;
+    }
+
+    SOUNDIO_ATOMIC_STORE(isf->pause_requested, false);
+
+    if (instream->software_latency == 0.0)
+        instream->software_latency = device->software_latency_current;
+    instream->software_latency = soundio_double_clamp(device->software_latency_min,
+            instream->software_latency, device->software_latency_max);
+
+    int buffer_frame_count = soundio_int_max(1, instream->software_latency * instream->sample_rate);
+    instream->software_latency = buffer_frame_count / (double)instream->sample_rate;
+    isf->buffer_capacity = buffer_frame_count * instream->bytes_per_frame;
+    isf->buffer = ALLOCATE_NONZERO(char, isf->buffer_capacity);
+    if (!isf->buffer) {
+        instream_destroy_file(si, is);
+        return SoundIoErrorNoMem;
+    }
+
+    isf->cond = soundio_os_cond_create();
+    if (!isf->cond) {
+        instream_destroy_file(si, is);
+        return SoundIoErrorNoMem;
+    }
+
+    isf->file = fopen(device->id, "rb");
+    if (!isf->file) {
+        instream_destroy_file(si, is);
+        return SoundIoErrorOpeningDevice;
+    }
+    setvbuf(isf->file, NULL, _IONBF, 0);
+    if (fseek(isf->file, devf->data_offset, SEEK_SET)) {
+        instream_destroy_file(si, is);
+        return SoundIoErrorOpeningDevice;
+    }
+    isf->data_bytes_left = devf->data_byte_count;
+
+    return 0;
+}
+
+static int instream_pause_file(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is, bool pause) {
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+    SOUNDIO_ATOMIC_STORE(isf->pause_requested, pause);
+    soundio_os_cond_signal(isf->cond, NULL);
+    return 0;
+}
+
+static int instream_start_file(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+    struct SoundIo *soundio = &si->pub;
+    assert(!isf->thread);
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isf->abort_flag);
+    return soundio_os_thread_create(capture_thread_run, is, soundio->emit_rtprio_warning,
+            &is->thread_policy, 0, &isf->thread);
+}
+
+static int instream_begin_read_file(struct SoundIoPrivate *si,
+        struct SoundIoInStreamPrivate *is, struct SoundIoChannelArea **out_areas, int *frame_count)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+
+    if (!isf->in_callback || isf->reading)
+        return SoundIoErrorInvalid;
+    if (*frame_count < 0 || *frame_count > isf->frames_left)
+        return SoundIoErrorInvalid;
+
+    char *read_ptr = isf->buffer + isf->buffer_start;
+    for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
+        isf->areas[ch].ptr = read_ptr + instream->bytes_per_sample * ch;
+        isf->areas[ch].step = instream->bytes_per_frame;
+    }
+
+    isf->reading = true;
+    isf->read_frame_count = *frame_count;
+    *out_areas = isf->areas;
+    return 0;
+}
+
+static int instream_end_read_file(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamFile *isf = &is->backend_data.file;
+    struct SoundIoInStream *instream = &is->pub;
+    if (!isf->reading)
+        return SoundIoErrorInvalid;
+    isf->buffer_start += isf->read_frame_count * instream->bytes_per_frame;
+    isf->frames_left -= isf->read_frame_count;
+    isf->reading = false;
+    return 0;
+}
+
+static int instream_get_latency_file(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
+        double *out_latency)
+{
+    *out_latency = 0.0;
+    return 0;
+}
+
+int soundio_file_init(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoFile *sif = &si->backend_data.file;
+    int err;
+
+    if (soundio->file_device_count < 0 || (soundio->file_device_count > 0 && !soundio->file_devices))
+        return SoundIoErrorInvalid;
+
+    sif->cond = soundio_os_cond_create();
+    if (!sif->cond) {
+        destroy_file(si);
+        return SoundIoErrorNoMem;
+    }
+
+    assert(!si->safe_devices_info);
+    si->safe_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!si->safe_devices_info) {
+        destroy_file(si);
+        return SoundIoErrorNoMem;
+    }
+    si->safe_devices_info->default_input_index = -1;
+    si->safe_devices_info->default_output_index = -1;
+
+    for (int i = 0; i < soundio->file_device_count; i += 1) {
+        struct SoundIoDevice *device;
+        if ((err = create_device(si, &soundio->file_devices[i], &device))) {
+            destroy_file(si);
+            return err;
+        }
+        struct SoundIoListDevicePtr *list = (device->aim == SoundIoDeviceAimInput) ?
+            &si->safe_devices_info->input_devices : &si->safe_devices_info->output_devices;
+        if (SoundIoListDevicePtr_append(list, device)) {
+            soundio_device_unref(device);
+            destroy_file(si);
+            return SoundIoErrorNoMem;
+        }
+    }
+    if (si->safe_devices_info->input_devices.length > 0)
+        si->safe_devices_info->default_input_index = 0;
+    if (si->safe_devices_info->output_devices.length > 0)
+        si->safe_devices_info->default_output_index = 0;
+
+    si->destroy = destroy_file;
+    si->flush_events = flush_events_file;
+    si->wait_events = wait_events_file;
+    si->wakeup = wakeup_file;
+    si->force_device_scan = force_device_scan_file;
+
+    si->outstream_open = outstream_open_file;
+    si->outstream_destroy = outstream_destroy_file;
+    si->outstream_start = outstream_start_file;
+    si->outstream_begin_write = outstream_begin_write_file;
+    si->outstream_end_write = outstream_end_write_file;
+    si->outstream_clear_buffer = outstream_clear_buffer_file;
+    si->outstream_pause = outstream_pause_file;
+    si->outstream_get_latency = outstream_get_latency_file;
+
+    si->instream_open = instream_open_file;
+    si->instream_destroy = instream_destroy_file;
+    si->instream_start = instream_start_file;
+    si->instream_begin_read = instream_begin_read_file;
+    si->instream_end_read = instream_end_read_file;
+    si->instream_pause = instream_pause_file;
+    si->instream_get_latency = instream_get_latency_file;
+
+    return 0;
+}
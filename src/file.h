@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_FILE_H
+#define SOUNDIO_FILE_H
+
+#include "soundio_internal.h"
+#include "os.h"
+#include "atomics.h"
+
+#include <stdio.h>
+
+struct SoundIoPrivate;
+int soundio_file_init(struct SoundIoPrivate *si);
+
+struct SoundIoFile {
+    struct SoundIoOsCond *cond;
+    bool devices_emitted;
+};
+
+struct SoundIoDeviceFile {
+    enum SoundIoFileType type;
+    // where the samples of an input file begin, and how many bytes of them
+    // there are; -1 when a raw file is read until its end
+    long data_offset;
+    long long data_byte_count;
+};
+
+struct SoundIoOutStreamFile {
+    FILE *file;
+    struct SoundIoOsThread *thread;
+    struct SoundIoOsCond *cond;
+    struct SoundIoAtomicFlag abort_flag;
+    struct SoundIoAtomicBool pause_requested;
+    // frames are gathered here and written to the file a whole buffer at a
+    // time. With a WAV file the buffer starts out with room for the header.
+    char *buffer;
+    int buffer_capacity;
+    int buffer_used;
+    int header_size;
+    long long data_byte_count;
+    bool write_failed;
+    // the callback contract: begin_write and end_write are only allowed in
+    // the write callback, in pairs, for at most frames_left frames
+    bool in_callback;
+    bool writing;
+    int frames_left;
+    int write_frame_count;
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+};
+
+struct SoundIoInStreamFile {
+    FILE *file;
+    struct SoundIoOsThread *thread;
+    struct SoundIoOsCond *cond;
+    struct SoundIoAtomicFlag abort_flag;
+    struct SoundIoAtomicBool pause_requested;
+    char *buffer;
+    int buffer_capacity;
+    int buffer_start;
+    int buffer_end;
+    long long data_bytes_left;
+    bool in_callback;
+    bool reading;
+    int frames_left;
+    int read_frame_count;
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+};
+
+#endif
@@ -33,6 +33,8 @@ struct SoundIoJackClient {
 
 SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoJackClient, SoundIoListJackClient, SOUNDIO_LIST_STATIC)
 SOUNDIO_MAKE_LIST_DEF(struct SoundIoJackClient, SoundIoListJackClient, SOUNDIO_LIST_STATIC)
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoOutStreamPrivate *, SoundIoListJackOutStreamPtr, SOUNDIO_LIST_STATIC)
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoInStreamPrivate *, SoundIoListJackInStreamPtr, SOUNDIO_LIST_STATIC)
 
 static void split_str(const char *input_str, int input_str_len, char c,
         const char **out_1, int *out_len_1, const char **out_2, int *out_len_2)
@@ -365,10 +367,81 @@ static int outstream_process_callback(jack_nframes_t nframes, void *arg) {
     return 0;
 }
 
-static void outstream_destroy_jack(struct SoundIoPrivate *is, struct SoundIoOutStreamPrivate *os) {
+// With SoundIo::jack_shared_client all ports are registered on the client
+// of the context, so the stream name and serial make them unique.
+static jack_port_t *register_port(struct SoundIoJack *sij, jack_client_t *client, const char *stream_name,
+        int serial, enum SoundIoChannelId channel_id, unsigned long flags)
+{
+    const char *channel_name = soundio_get_channel_name(channel_id);
+    if (!sij->shared_client)
+        return jack_port_register(client, channel_name, JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+
+    char port_name[256];
+    snprintf(port_name, sizeof(port_name), "%s-%d %s", stream_name, serial, channel_name);
+    return jack_port_register(client, port_name, JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+}
+
+// Waits for a callback that might still be reading the set that was
+// published before.
+static void wait_for_stream_readers(struct SoundIoJack *sij, struct SoundIoAtomicULong *epoch) {
+    unsigned long start_epoch = SOUNDIO_ATOMIC_LOAD((*epoch));
+    if (!(start_epoch & 1))
+        return;
+    while (SOUNDIO_ATOMIC_LOAD((*epoch)) == start_epoch)
+        soundio_os_cond_timed_wait(sij->cond, NULL, 0.001);
+}
+
+// Hands the stream lists to the realtime callbacks. Call with stream_mutex
+// held. Once this returns, a stream that was removed from the lists is no
+// longer used by them. Only fails when a stream was added: the set that is
+// filled in is the one published before, which already had room for every
+// stream but that one.
+static int publish_streams(struct SoundIoJack *sij) {
+    int next_set = !SOUNDIO_ATOMIC_LOAD(sij->published_set);
+    struct SoundIoJackStreamSet *set = &sij->stream_sets[next_set];
+    int err;
+    if ((err = SoundIoListJackOutStreamPtr_resize(&set->outstreams, sij->outstreams.length)))
+        return err;
+    if ((err = SoundIoListJackInStreamPtr_resize(&set->instreams, sij->instreams.length)))
+        return err;
+    for (int i = 0; i < sij->outstreams.length; i += 1)
+        set->outstreams.items[i] = sij->outstreams.items[i];
+    for (int i = 0; i < sij->instreams.length; i += 1)
+        set->instreams.items[i] = sij->instreams.items[i];
+
+    SOUNDIO_ATOMIC_STORE(sij->published_set, next_set);
+    wait_for_stream_readers(sij, &sij->process_epoch);
+    wait_for_stream_readers(sij, &sij->xrun_epoch);
+    return 0;
+}
+
+static void outstream_destroy_jack(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoJack *sij = &si->backend_data.jack;
     struct SoundIoOutStreamJack *osj = &os->backend_data.jack;
 
-    jack_client_close(osj->client);
+    if (!osj->client)
+        return;
+
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        for (int i = 0; i < sij->outstreams.length; i += 1) {
+            if (SoundIoListJackOutStreamPtr_val_at(&sij->outstreams, i) == os) {
+                SoundIoListJackOutStreamPtr_swap_remove(&sij->outstreams, i);
+                int err = publish_streams(sij);
+                assert(!err);
+                (void)err;
+                break;
+            }
+        }
+        soundio_os_mutex_unlock(sij->stream_mutex);
+
+        for (int ch = 0; ch < SOUNDIO_MAX_CHANNELS; ch += 1) {
+            if (osj->ports[ch].source_port)
+                jack_port_unregister(osj->client, osj->ports[ch].source_port);
+        }
+    } else {
+        jack_client_close(osj->client);
+    }
     osj->client = NULL;
 }
 
@@ -425,27 +498,13 @@ static inline jack_nframes_t nframes_max(jack_nframes_t a, jack_nframes_t b) {
     return (a >= b) ? a : b;
 }
 
-static int outstream_open_jack(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
-    struct SoundIoJack *sij = &si->backend_data.jack;
+static int outstream_open_client_jack(struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamJack *osj = &os->backend_data.jack;
     struct SoundIoOutStream *outstream = &os->pub;
-    struct SoundIoDevice *device = outstream->device;
-    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
-    struct SoundIoDeviceJack *dj = &dev->backend_data.jack;
-
-    if (sij->is_shutdown)
-        return SoundIoErrorBackendDisconnected;
-
-    if (!outstream->name)
-        outstream->name = "SoundIoOutStream";
-
-    outstream->software_latency = device->software_latency_current;
-    osj->period_size = sij->period_size;
 
     jack_status_t status;
     osj->client = jack_client_open(outstream->name, JackNoStartServer, &status);
     if (!osj->client) {
-        outstream_destroy_jack(si, os);
         assert(!(status & JackInvalidOption));
         if (status & JackShmFailure)
             return SoundIoErrorSystemResources;
@@ -454,25 +513,44 @@ static int outstream_open_jack(struct SoundIoPrivate *si, struct SoundIoOutStrea
         return SoundIoErrorOpeningDevice;
     }
 
-    int err;
-    if ((err = jack_set_process_callback(osj->client, outstream_process_callback, os))) {
-        outstream_destroy_jack(si, os);
+    if (jack_set_process_callback(osj->client, outstream_process_callback, os))
         return SoundIoErrorOpeningDevice;
-    }
-    if ((err = jack_set_buffer_size_callback(osj->client, outstream_buffer_size_callback, os))) {
-        outstream_destroy_jack(si, os);
+    if (jack_set_buffer_size_callback(osj->client, outstream_buffer_size_callback, os))
         return SoundIoErrorOpeningDevice;
-    }
-    if ((err = jack_set_sample_rate_callback(osj->client, outstream_sample_rate_callback, os))) {
-        outstream_destroy_jack(si, os);
+    if (jack_set_sample_rate_callback(osj->client, outstream_sample_rate_callback, os))
         return SoundIoErrorOpeningDevice;
-    }
-    if ((err = jack_set_xrun_callback(osj->client, outstream_xrun_callback, os))) {
-        outstream_destroy_jack(si, os);
+    if (jack_set_xrun_callback(osj->client, outstream_xrun_callback, os))
         return SoundIoErrorOpeningDevice;
-    }
     jack_on_shutdown(osj->client, outstream_shutdown_callback, os);
 
+    return 0;
+}
+
+static int outstream_open_jack(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoJack *sij = &si->backend_data.jack;
+    struct SoundIoOutStreamJack *osj = &os->backend_data.jack;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoDevice *device = outstream->device;
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
+    struct SoundIoDeviceJack *dj = &dev->backend_data.jack;
+
+    if (sij->is_shutdown)
+        return SoundIoErrorBackendDisconnected;
+
+    if (!outstream->name)
+        outstream->name = "SoundIoOutStream";
+
+    outstream->software_latency = device->software_latency_current;
+    osj->period_size = sij->period_size;
+
+    int err;
+    if (sij->shared_client) {
+        osj->client = sij->client;
+        osj->serial = ++sij->stream_serial;
+    } else if ((err = outstream_open_client_jack(os))) {
+        outstream_destroy_jack(si, os);
+        return err;
+    }
 
     jack_nframes_t max_port_latency = 0;
 
@@ -480,11 +558,10 @@ static int outstream_open_jack(struct SoundIoPrivate *si, struct SoundIoOutStrea
     int connected_count = 0;
     for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
         enum SoundIoChannelId my_channel_id = outstream->layout.channels[ch];
-        const char *channel_name = soundio_get_channel_name(my_channel_id);
         unsigned long flags = JackPortIsOutput;
         if (!outstream->non_terminal_hint)
             flags |= JackPortIsTerminal;
-        jack_port_t *jport = jack_port_register(osj->client, channel_name, JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+        jack_port_t *jport = register_port(sij, osj->client, outstream->name, osj->serial, my_channel_id, flags);
         if (!jport) {
             outstream_destroy_jack(si, os);
             return SoundIoErrorOpeningDevice;
@@ -539,8 +616,19 @@ static int outstream_start_jack(struct SoundIoPrivate *si, struct SoundIoOutStre
     if (sij->is_shutdown)
         return SoundIoErrorBackendDisconnected;
 
-    if ((err = jack_activate(osj->client)))
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        if (!(err = SoundIoListJackOutStreamPtr_append(&sij->outstreams, os)) &&
+            (err = publish_streams(sij)))
+        {
+            SoundIoListJackOutStreamPtr_pop(&sij->outstreams);
+        }
+        soundio_os_mutex_unlock(sij->stream_mutex);
+        if (err)
+            return SoundIoErrorNoMem;
+    } else if ((err = jack_activate(osj->client))) {
         return SoundIoErrorStreaming;
+    }
 
     for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
         struct SoundIoOutStreamJackPort *osjp = &osj->ports[ch];
@@ -582,16 +670,41 @@ static int outstream_clear_buffer_jack(struct SoundIoPrivate *si, struct SoundIo
 static int outstream_get_latency_jack(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
         double *out_latency)
 {
+    struct SoundIoJack *sij = &si->backend_data.jack;
     struct SoundIoOutStreamJack *osj = &os->backend_data.jack;
-    *out_latency = osj->hardware_latency;
+    // while freewheeling the graph is not tied to the hardware
+    *out_latency = SOUNDIO_ATOMIC_LOAD(sij->freewheel) ? 0.0 : osj->hardware_latency;
     return 0;
 }
 
 
 static void instream_destroy_jack(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoJack *sij = &si->backend_data.jack;
     struct SoundIoInStreamJack *isj = &is->backend_data.jack;
 
-    jack_client_close(isj->client);
+    if (!isj->client)
+        return;
+
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        for (int i = 0; i < sij->instreams.length; i += 1) {
+            if (SoundIoListJackInStreamPtr_val_at(&sij->instreams, i) == is) {
+                SoundIoListJackInStreamPtr_swap_remove(&sij->instreams, i);
+                int err = publish_streams(sij);
+                assert(!err);
+                (void)err;
+                break;
+            }
+        }
+        soundio_os_mutex_unlock(sij->stream_mutex);
+
+        for (int ch = 0; ch < SOUNDIO_MAX_CHANNELS; ch += 1) {
+            if (isj->ports[ch].dest_port)
+                jack_port_unregister(isj->client, isj->ports[ch].dest_port);
+        }
+    } else {
+        jack_client_close(isj->client);
+    }
     isj->client = NULL;
 }
 
@@ -646,6 +759,34 @@ static int instream_process_callback(jack_nframes_t nframes, void *arg) {
     return 0;
 }
 
+static int instream_open_client_jack(struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamJack *isj = &is->backend_data.jack;
+    struct SoundIoInStream *instream = &is->pub;
+
+    jack_status_t status;
+    isj->client = jack_client_open(instream->name, JackNoStartServer, &status);
+    if (!isj->client) {
+        assert(!(status & JackInvalidOption));
+        if (status & JackShmFailure)
+            return SoundIoErrorSystemResources;
+        if (status & JackNoSuchClient)
+            return SoundIoErrorNoSuchClient;
+        return SoundIoErrorOpeningDevice;
+    }
+
+    if (jack_set_process_callback(isj->client, instream_process_callback, is))
+        return SoundIoErrorOpeningDevice;
+    if (jack_set_buffer_size_callback(isj->client, instream_buffer_size_callback, is))
+        return SoundIoErrorOpeningDevice;
+    if (jack_set_sample_rate_callback(isj->client, instream_sample_rate_callback, is))
+        return SoundIoErrorOpeningDevice;
+    if (jack_set_xrun_callback(isj->client, instream_xrun_callback, is))
+        return SoundIoErrorOpeningDevice;
+    jack_on_shutdown(isj->client, instream_shutdown_callback, is);
+
+    return 0;
+}
+
 static int instream_open_jack(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
     struct SoundIoInStream *instream = &is->pub;
     struct SoundIoInStreamJack *isj = &is->backend_data.jack;
@@ -663,36 +804,14 @@ static int instream_open_jack(struct SoundIoPrivate *si, struct SoundIoInStreamP
     instream->software_latency = device->software_latency_current;
     isj->period_size = sij->period_size;
 
-    jack_status_t status;
-    isj->client = jack_client_open(instream->name, JackNoStartServer, &status);
-    if (!isj->client) {
-        instream_destroy_jack(si, is);
-        assert(!(status & JackInvalidOption));
-        if (status & JackShmFailure)
-            return SoundIoErrorSystemResources;
-        if (status & JackNoSuchClient)
-            return SoundIoErrorNoSuchClient;
-        return SoundIoErrorOpeningDevice;
-    }
-
     int err;
-    if ((err = jack_set_process_callback(isj->client, instream_process_callback, is))) {
+    if (sij->shared_client) {
+        isj->client = sij->client;
+        isj->serial = ++sij->stream_serial;
+    } else if ((err = instream_open_client_jack(is))) {
         instream_destroy_jack(si, is);
-        return SoundIoErrorOpeningDevice;
-    }
-    if ((err = jack_set_buffer_size_callback(isj->client, instream_buffer_size_callback, is))) {
-        instream_destroy_jack(si, is);
-        return SoundIoErrorOpeningDevice;
-    }
-    if ((err = jack_set_sample_rate_callback(isj->client, instream_sample_rate_callback, is))) {
-        instream_destroy_jack(si, is);
-        return SoundIoErrorOpeningDevice;
-    }
-    if ((err = jack_set_xrun_callback(isj->client, instream_xrun_callback, is))) {
-        instream_destroy_jack(si, is);
-        return SoundIoErrorOpeningDevice;
+        return err;
     }
-    jack_on_shutdown(isj->client, instream_shutdown_callback, is);
 
     jack_nframes_t max_port_latency = 0;
 
@@ -700,11 +819,10 @@ static int instream_open_jack(struct SoundIoPrivate *si, struct SoundIoInStreamP
     int connected_count = 0;
     for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
         enum SoundIoChannelId my_channel_id = instream->layout.channels[ch];
-        const char *channel_name = soundio_get_channel_name(my_channel_id);
         unsigned long flags = JackPortIsInput;
         if (!instream->non_terminal_hint)
             flags |= JackPortIsTerminal;
-        jack_port_t *jport = jack_port_register(isj->client, channel_name, JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+        jack_port_t *jport = register_port(sij, isj->client, instream->name, isj->serial, my_channel_id, flags);
         if (!jport) {
             instream_destroy_jack(si, is);
             return SoundIoErrorOpeningDevice;
@@ -759,8 +877,19 @@ static int instream_start_jack(struct SoundIoPrivate *si, struct SoundIoInStream
     if (sij->is_shutdown)
         return SoundIoErrorBackendDisconnected;
 
-    if ((err = jack_activate(isj->client)))
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        if (!(err = SoundIoListJackInStreamPtr_append(&sij->instreams, is)) &&
+            (err = publish_streams(sij)))
+        {
+            SoundIoListJackInStreamPtr_pop(&sij->instreams);
+        }
+        soundio_os_mutex_unlock(sij->stream_mutex);
+        if (err)
+            return SoundIoErrorNoMem;
+    } else if ((err = jack_activate(isj->client))) {
         return SoundIoErrorStreaming;
+    }
 
     for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
         struct SoundIoInStreamJackPort *isjp = &isj->ports[ch];
@@ -798,8 +927,9 @@ static int instream_end_read_jack(struct SoundIoPrivate *si, struct SoundIoInStr
 static int instream_get_latency_jack(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
         double *out_latency)
 {
+    struct SoundIoJack *sij = &si->backend_data.jack;
     struct SoundIoInStreamJack *isj = &is->backend_data.jack;
-    *out_latency = isj->hardware_latency;
+    *out_latency = SOUNDIO_ATOMIC_LOAD(sij->freewheel) ? 0.0 : isj->hardware_latency;
     return 0;
 }
 
@@ -813,10 +943,48 @@ static void notify_devices_change(struct SoundIoPrivate *si) {
     soundio_os_mutex_unlock(sij->mutex);
 }
 
+// Only used with SoundIo::jack_shared_client. Capture is serviced first so
+// that output streams can use what was recorded in the same cycle. This runs
+// on the realtime thread of JACK, so it must not wait for stream_mutex.
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
+    struct SoundIoJack *sij = &si->backend_data.jack;
+    SOUNDIO_ATOMIC_FETCH_ADD(sij->process_epoch, 1);
+    struct SoundIoJackStreamSet *set = &sij->stream_sets[SOUNDIO_ATOMIC_LOAD(sij->published_set)];
+    for (int i = 0; i < set->instreams.length; i += 1)
+        instream_process_callback(nframes, SoundIoListJackInStreamPtr_val_at(&set->instreams, i));
+    for (int i = 0; i < set->outstreams.length; i += 1)
+        outstream_process_callback(nframes, SoundIoListJackOutStreamPtr_val_at(&set->outstreams, i));
+    SOUNDIO_ATOMIC_FETCH_ADD(sij->process_epoch, 1);
+    return 0;
+}
+
+// Only used with SoundIo::jack_shared_client.
+static int xrun_callback(void *arg) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
+    struct SoundIoJack *sij = &si->backend_data.jack;
+    SOUNDIO_ATOMIC_FETCH_ADD(sij->xrun_epoch, 1);
+    struct SoundIoJackStreamSet *set = &sij->stream_sets[SOUNDIO_ATOMIC_LOAD(sij->published_set)];
+    for (int i = 0; i < set->instreams.length; i += 1)
+        instream_xrun_callback(SoundIoListJackInStreamPtr_val_at(&set->instreams, i));
+    for (int i = 0; i < set->outstreams.length; i += 1)
+        outstream_xrun_callback(SoundIoListJackOutStreamPtr_val_at(&set->outstreams, i));
+    SOUNDIO_ATOMIC_FETCH_ADD(sij->xrun_epoch, 1);
+    return 0;
+}
+
 static int buffer_size_callback(jack_nframes_t nframes, void *arg) {
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
     struct SoundIoJack *sij = &si->backend_data.jack;
     sij->period_size = nframes;
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        for (int i = 0; i < sij->instreams.length; i += 1)
+            instream_buffer_size_callback(nframes, SoundIoListJackInStreamPtr_val_at(&sij->instreams, i));
+        for (int i = 0; i < sij->outstreams.length; i += 1)
+            outstream_buffer_size_callback(nframes, SoundIoListJackOutStreamPtr_val_at(&sij->outstreams, i));
+        soundio_os_mutex_unlock(sij->stream_mutex);
+    }
     notify_devices_change(si);
     return 0;
 }
@@ -825,10 +993,41 @@ static int sample_rate_callback(jack_nframes_t nframes, void *arg) {
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
     struct SoundIoJack *sij = &si->backend_data.jack;
     sij->sample_rate = nframes;
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        for (int i = 0; i < sij->instreams.length; i += 1)
+            instream_sample_rate_callback(nframes, SoundIoListJackInStreamPtr_val_at(&sij->instreams, i));
+        for (int i = 0; i < sij->outstreams.length; i += 1)
+            outstream_sample_rate_callback(nframes, SoundIoListJackOutStreamPtr_val_at(&sij->outstreams, i));
+        soundio_os_mutex_unlock(sij->stream_mutex);
+    }
     notify_devices_change(si);
     return 0;
 }
 
+// JACK keeps calling the process callbacks of every client back-to-back
+// while freewheeling, so the streams need no changes of their own.
+static void freewheel_callback(int starting, void *arg) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoJack *sij = &si->backend_data.jack;
+    SOUNDIO_ATOMIC_STORE(sij->freewheel, starting != 0);
+    if (soundio->on_freewheel_change)
+        soundio->on_freewheel_change(soundio, starting != 0);
+}
+
+static int set_freewheel_jack(struct SoundIoPrivate *si, bool freewheel) {
+    struct SoundIoJack *sij = &si->backend_data.jack;
+
+    if (sij->is_shutdown)
+        return SoundIoErrorBackendDisconnected;
+
+    if (jack_set_freewheel(sij->client, freewheel))
+        return SoundIoErrorSystemResources;
+
+    return 0;
+}
+
 static void port_registration_callback(jack_port_id_t port_id, int reg, void *arg) {
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)arg;
     notify_devices_change(si);
@@ -850,6 +1049,15 @@ static void shutdown_callback(void *arg) {
     soundio_os_cond_signal(sij->cond, sij->mutex);
     soundio->on_events_signal(soundio);
     soundio_os_mutex_unlock(sij->mutex);
+
+    if (sij->shared_client) {
+        soundio_os_mutex_lock(sij->stream_mutex);
+        for (int i = 0; i < sij->instreams.length; i += 1)
+            instream_shutdown_callback(SoundIoListJackInStreamPtr_val_at(&sij->instreams, i));
+        for (int i = 0; i < sij->outstreams.length; i += 1)
+            outstream_shutdown_callback(SoundIoListJackOutStreamPtr_val_at(&sij->outstreams, i));
+        soundio_os_mutex_unlock(sij->stream_mutex);
+    }
 }
 
 static void destroy_jack(struct SoundIoPrivate *si) {
@@ -863,6 +1071,16 @@ static void destroy_jack(struct SoundIoPrivate *si) {
 
     if (sij->mutex)
         soundio_os_mutex_destroy(sij->mutex);
+
+    if (sij->stream_mutex)
+        soundio_os_mutex_destroy(sij->stream_mutex);
+
+    SoundIoListJackOutStreamPtr_deinit(&sij->outstreams);
+    SoundIoListJackInStreamPtr_deinit(&sij->instreams);
+    for (int i = 0; i < 2; i += 1) {
+        SoundIoListJackOutStreamPtr_deinit(&sij->stream_sets[i].outstreams);
+        SoundIoListJackInStreamPtr_deinit(&sij->stream_sets[i].instreams);
+    }
 }
 
 int soundio_jack_init(struct SoundIoPrivate *si) {
@@ -889,6 +1107,15 @@ int soundio_jack_init(struct SoundIoPrivate *si) {
         return SoundIoErrorNoMem;
     }
 
+    sij->shared_client = soundio->jack_shared_client;
+    if (sij->shared_client) {
+        sij->stream_mutex = soundio_os_mutex_create();
+        if (!sij->stream_mutex) {
+            destroy_jack(si);
+            return SoundIoErrorNoMem;
+        }
+    }
+
     // We pass JackNoStartServer due to
     // https://github.com/jackaudio/jack2/issues/138
     jack_status_t status;
@@ -921,9 +1148,24 @@ int soundio_jack_init(struct SoundIoPrivate *si) {
         destroy_jack(si);
         return SoundIoErrorInitAudioBackend;
     }
+    if ((err = jack_set_freewheel_callback(sij->client, freewheel_callback, si))) {
+        destroy_jack(si);
+        return SoundIoErrorInitAudioBackend;
+    }
+    if (sij->shared_client) {
+        if ((err = jack_set_process_callback(sij->client, process_callback, si))) {
+            destroy_jack(si);
+            return SoundIoErrorInitAudioBackend;
+        }
+        if ((err = jack_set_xrun_callback(sij->client, xrun_callback, si))) {
+            destroy_jack(si);
+            return SoundIoErrorInitAudioBackend;
+        }
+    }
     jack_on_shutdown(sij->client, shutdown_callback, si);
 
     SOUNDIO_ATOMIC_FLAG_CLEAR(sij->refresh_devices_flag);
+    SOUNDIO_ATOMIC_STORE(sij->freewheel, false);
     sij->period_size = jack_get_buffer_size(sij->client);
     sij->sample_rate = jack_get_sample_rate(sij->client);
 
@@ -942,6 +1184,7 @@ int soundio_jack_init(struct SoundIoPrivate *si) {
     si->wait_events = wait_events_jack;
     si->wakeup = wakeup_jack;
     si->force_device_scan = force_device_scan_jack;
+    si->set_freewheel = set_freewheel_jack;
 
     si->outstream_open = outstream_open_jack;
     si->outstream_destroy = outstream_destroy_jack;
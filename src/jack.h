@@ -11,12 +11,25 @@
 #include "soundio_internal.h"
 #include "os.h"
 #include "atomics.h"
+#include "list.h"
 
 #include "weak_libjack.h"
 
 struct SoundIoPrivate;
+struct SoundIoOutStreamPrivate;
+struct SoundIoInStreamPrivate;
 int soundio_jack_init(struct SoundIoPrivate *si);
 
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoOutStreamPrivate *, SoundIoListJackOutStreamPtr, SOUNDIO_LIST_STATIC)
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoInStreamPrivate *, SoundIoListJackInStreamPtr, SOUNDIO_LIST_STATIC)
+
+// A copy of the stream lists of a shared client for the process and xrun
+// callbacks, which read it without locking.
+struct SoundIoJackStreamSet {
+    struct SoundIoListJackOutStreamPtr outstreams;
+    struct SoundIoListJackInStreamPtr instreams;
+};
+
 struct SoundIoDeviceJackPort {
     char *full_name;
     int full_name_len;
@@ -38,6 +51,22 @@ struct SoundIoJack {
     int period_size;
     bool is_shutdown;
     bool emitted_shutdown_cb;
+    struct SoundIoAtomicBool freewheel;
+    // the rest is only used with SoundIo::jack_shared_client
+    bool shared_client;
+    // protects the stream lists and stream_sets against the other
+    // non-realtime threads
+    struct SoundIoOsMutex *stream_mutex;
+    struct SoundIoListJackOutStreamPtr outstreams;
+    struct SoundIoListJackInStreamPtr instreams;
+    int stream_serial;
+    // The realtime callbacks use stream_sets[published_set]. The other one
+    // is filled in by publish_streams, which then swaps them.
+    struct SoundIoJackStreamSet stream_sets[2];
+    struct SoundIoAtomicInt published_set;
+    // odd while the callback is reading the published set
+    struct SoundIoAtomicULong process_epoch;
+    struct SoundIoAtomicULong xrun_epoch;
 };
 
 struct SoundIoOutStreamJackPort {
@@ -48,6 +77,8 @@ struct SoundIoOutStreamJackPort {
 
 struct SoundIoOutStreamJack {
     jack_client_t *client;
+    // tells the ports of streams apart with SoundIo::jack_shared_client
+    int serial;
     int period_size;
     int frames_left;
     double hardware_latency;
@@ -63,6 +94,8 @@ struct SoundIoInStreamJackPort {
 
 struct SoundIoInStreamJack {
     jack_client_t *client;
+    // tells the ports of streams apart with SoundIo::jack_shared_client
+    int serial;
     int period_size;
     int frames_left;
     double hardware_latency;
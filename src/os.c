@@ -78,6 +78,15 @@
 #include <mach/mach.h>
 #endif
 
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#if !defined(SCHED_DEADLINE)
+#define SCHED_DEADLINE 6
+#endif
+#endif
+
 struct SoundIoOsThread {
 #if defined(SOUNDIO_OS_WINDOWS)
     HANDLE handle;
@@ -88,6 +97,12 @@ struct SoundIoOsThread {
 
     pthread_t id;
     bool running;
+
+    // applied by the thread itself before run is called
+    int64_t timer_slack;
+    int64_t deadline_runtime;
+    int64_t deadline_period;
+    void (*emit_rtprio_warning)(void);
 #endif
     void *arg;
     void (*run)(void *arg);
@@ -127,7 +142,7 @@ struct SoundIoOsCond {
 
 #if defined(SOUNDIO_OS_WINDOWS)
 static INIT_ONCE win32_init_once = INIT_ONCE_STATIC_INIT;
-static double win32_time_resolution;
+static unsigned __int64 win32_time_frequency;
 static SYSTEM_INFO win32_system_info;
 #else
 static bool initialized = false;
@@ -139,30 +154,41 @@ static clock_serv_t cclock;
 
 static int page_size;
 
-double soundio_os_get_time(void) {
+int64_t soundio_os_get_time_ns(void) {
 #if defined(SOUNDIO_OS_WINDOWS)
     unsigned __int64 time;
     QueryPerformanceCounter((LARGE_INTEGER*) &time);
-    return time * win32_time_resolution;
+    // split so that the multiplication cannot overflow
+    return (time / win32_time_frequency) * 1000000000 +
+        (time % win32_time_frequency) * 1000000000 / win32_time_frequency;
 #elif defined(__MACH__)
     mach_timespec_t mts;
 
     kern_return_t err = clock_get_time(cclock, &mts);
     assert(!err);
 
-    double seconds = (double)mts.tv_sec;
-    seconds += ((double)mts.tv_nsec) / 1000000000.0;
-
-    return seconds;
+    return mts.tv_sec * (int64_t)1000000000 + mts.tv_nsec;
 #else
     struct timespec tms;
     clock_gettime(CLOCK_MONOTONIC, &tms);
-    double seconds = (double)tms.tv_sec;
-    seconds += ((double)tms.tv_nsec) / 1000000000.0;
-    return seconds;
+    return tms.tv_sec * (int64_t)1000000000 + tms.tv_nsec;
 #endif
 }
 
+int64_t soundio_os_get_raw_time_ns(void) {
+#if defined(CLOCK_MONOTONIC_RAW) && !defined(SOUNDIO_OS_WINDOWS) && !defined(__MACH__)
+    struct timespec tms;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &tms);
+    return tms.tv_sec * (int64_t)1000000000 + tms.tv_nsec;
+#else
+    return soundio_os_get_time_ns();
+#endif
+}
+
+double soundio_os_get_time(void) {
+    return soundio_os_get_time_ns() / 1000000000.0;
+}
+
 #if defined(SOUNDIO_OS_WINDOWS)
 static DWORD WINAPI run_win32_thread(LPVOID userdata) {
     struct SoundIoOsThread *thread = (struct SoundIoOsThread *)userdata;
@@ -177,20 +203,70 @@ static void assert_no_err(int err) {
     assert(!err);
 }
 
+#if defined(__linux__)
+// glibc has no wrapper for sched_setattr
+struct SoundIoSchedAttr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+static int set_sched_deadline(int64_t runtime, int64_t period) {
+#if defined(SYS_sched_setattr)
+    struct SoundIoSchedAttr attr;
+    memset(&attr, 0, sizeof(struct SoundIoSchedAttr));
+    attr.size = sizeof(struct SoundIoSchedAttr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = runtime;
+    attr.sched_deadline = period;
+    attr.sched_period = period;
+    return syscall(SYS_sched_setattr, 0, &attr, 0);
+#else
+    return -1;
+#endif
+}
+#endif
+
 static void *run_pthread(void *userdata) {
     struct SoundIoOsThread *thread = (struct SoundIoOsThread *)userdata;
+#if defined(__linux__)
+    if (thread->timer_slack > 0)
+        prctl(PR_SET_TIMERSLACK, (unsigned long)thread->timer_slack, 0, 0, 0);
+    // the thread keeps the SCHED_FIFO it was created with if this fails
+    if (thread->deadline_period > 0 && set_sched_deadline(thread->deadline_runtime, thread->deadline_period))
+        thread->emit_rtprio_warning();
+#endif
     thread->run(thread->arg);
     return NULL;
 }
+
+static int sched_priority_for(int policy, int priority) {
+    int min_priority = sched_get_priority_min(policy);
+    int max_priority = sched_get_priority_max(policy);
+    if (min_priority == -1 || max_priority == -1)
+        return -1;
+    return (priority == 0) ? max_priority : soundio_int_clamp(min_priority, priority, max_priority);
+}
 #endif
 
 int soundio_os_thread_create(
         void (*run)(void *arg), void *arg,
         void (*emit_rtprio_warning)(void),
+        const struct SoundIoThreadPolicy *policy, int64_t period,
         struct SoundIoOsThread ** out_thread)
 {
     *out_thread = NULL;
 
+    struct SoundIoThreadPolicy default_policy;
+    memset(&default_policy, 0, sizeof(struct SoundIoThreadPolicy));
+    if (!policy)
+        policy = &default_policy;
+
     struct SoundIoOsThread *thread = ALLOCATE(struct SoundIoOsThread, 1);
     if (!thread) {
         soundio_os_thread_destroy(thread);
@@ -207,9 +283,15 @@ int soundio_os_thread_create(
         return SoundIoErrorSystemResources;
     }
     if (emit_rtprio_warning) {
-        if (!SetThreadPriority(thread->handle, THREAD_PRIORITY_TIME_CRITICAL)) {
+        if (policy->sched != SoundIoThreadSchedOther &&
+            !SetThreadPriority(thread->handle, THREAD_PRIORITY_TIME_CRITICAL))
+        {
             emit_rtprio_warning();
         }
+        if (policy->cpu_mask && !SetThreadAffinityMask(thread->handle, (DWORD_PTR)policy->cpu_mask)) {
+            soundio_os_thread_destroy(thread);
+            return SoundIoErrorInvalid;
+        }
     }
 #else
     int err;
@@ -220,34 +302,74 @@ int soundio_os_thread_create(
     thread->attr_init = true;
     
     if (emit_rtprio_warning) {
-        int max_priority = sched_get_priority_max(SCHED_FIFO);
-        if (max_priority == -1) {
-            soundio_os_thread_destroy(thread);
-            return SoundIoErrorSystemResources;
+        thread->emit_rtprio_warning = emit_rtprio_warning;
+
+        int sched_policy = (policy->sched == SoundIoThreadSchedRoundRobin) ? SCHED_RR : SCHED_FIFO;
+        int priority = (policy->sched == SoundIoThreadSchedDefault) ? 0 : policy->priority;
+
+        if (policy->sched != SoundIoThreadSchedOther) {
+            struct sched_param param;
+            param.sched_priority = sched_priority_for(sched_policy, priority);
+            if (param.sched_priority == -1) {
+                soundio_os_thread_destroy(thread);
+                return SoundIoErrorSystemResources;
+            }
+
+            if ((err = pthread_attr_setschedpolicy(&thread->attr, sched_policy))) {
+                soundio_os_thread_destroy(thread);
+                return SoundIoErrorSystemResources;
+            }
+
+            if ((err = pthread_attr_setschedparam(&thread->attr, &param))) {
+                soundio_os_thread_destroy(thread);
+                return SoundIoErrorSystemResources;
+            }
         }
 
-        if ((err = pthread_attr_setschedpolicy(&thread->attr, SCHED_FIFO))) {
-            soundio_os_thread_destroy(thread);
-            return SoundIoErrorSystemResources;
+        // Without this the attributes above are ignored. The default policy
+        // has always gone without it, and is left that way.
+        if (policy->sched != SoundIoThreadSchedDefault && policy->sched != SoundIoThreadSchedOther) {
+            if ((err = pthread_attr_setinheritsched(&thread->attr, PTHREAD_EXPLICIT_SCHED))) {
+                soundio_os_thread_destroy(thread);
+                return SoundIoErrorSystemResources;
+            }
         }
 
-        struct sched_param param;
-        param.sched_priority = max_priority;
-        if ((err = pthread_attr_setschedparam(&thread->attr, &param))) {
-            soundio_os_thread_destroy(thread);
-            return SoundIoErrorSystemResources;
+#if defined(__linux__)
+        if (policy->cpu_mask) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu += 1) {
+                if (policy->cpu_mask & ((uint64_t)1 << cpu))
+                    CPU_SET(cpu, &cpu_set);
+            }
+            if ((err = pthread_attr_setaffinity_np(&thread->attr, sizeof(cpu_set_t), &cpu_set))) {
+                soundio_os_thread_destroy(thread);
+                return SoundIoErrorInvalid;
+            }
         }
 
+        thread->timer_slack = policy->timer_slack;
+        if (policy->sched == SoundIoThreadSchedDeadline && period > 0) {
+            double share = (policy->deadline_runtime > 0.0) ? policy->deadline_runtime : 0.5;
+            thread->deadline_period = period;
+            // the kernel wants at least this much
+            thread->deadline_runtime = soundio_double_max(1024.0, period * share);
+        }
+#endif
     }
 
     if ((err = pthread_create(&thread->id, &thread->attr, run_pthread, thread))) {
         if (err == EPERM && emit_rtprio_warning) {
             emit_rtprio_warning();
-            err = pthread_create(&thread->id, NULL, run_pthread, thread);
+            // keep the affinity, but take the scheduling of this thread
+            thread->deadline_period = 0;
+            pthread_attr_setinheritsched(&thread->attr, PTHREAD_INHERIT_SCHED);
+            err = pthread_create(&thread->id, &thread->attr, run_pthread, thread);
         }
         if (err) {
             soundio_os_thread_destroy(thread);
-            return SoundIoErrorNoMem;
+            return (err == EINVAL) ? SoundIoErrorInvalid : SoundIoErrorNoMem;
         }
     }
     thread->running = true;
@@ -441,6 +563,13 @@ void soundio_os_cond_signal(struct SoundIoOsCond *cond,
 
 void soundio_os_cond_timed_wait(struct SoundIoOsCond *cond,
         struct SoundIoOsMutex *locked_mutex, double seconds)
+{
+    soundio_os_cond_timed_wait_until(cond, locked_mutex,
+            soundio_os_get_time_ns() + soundio_seconds_to_ns(seconds));
+}
+
+void soundio_os_cond_timed_wait_until(struct SoundIoOsCond *cond,
+        struct SoundIoOsMutex *locked_mutex, int64_t deadline)
 {
 #if defined(SOUNDIO_OS_WINDOWS)
     CRITICAL_SECTION *target_cs;
@@ -450,7 +579,9 @@ void soundio_os_cond_timed_wait(struct SoundIoOsCond *cond,
         target_cs = &cond->default_cs_id;
         EnterCriticalSection(&cond->default_cs_id);
     }
-    DWORD ms = seconds * 1000.0;
+    // only relative timeouts are supported; round up so as not to wake early
+    int64_t remaining = deadline - soundio_os_get_time_ns();
+    DWORD ms = (remaining > 0) ? (DWORD)((remaining + 999999) / 1000000) : 0;
     SleepConditionVariableCS(&cond->id, target_cs, ms);
     if (!locked_mutex)
         LeaveCriticalSection(&cond->default_cs_id);
@@ -466,11 +597,13 @@ void soundio_os_cond_timed_wait(struct SoundIoOsCond *cond,
     kev.filter = EVFILT_USER;
     kev.flags = EV_ADD | EV_CLEAR;
 
-    // this time is relative
+    // this time is relative, so it is taken as late as possible
+    int64_t remaining = deadline - soundio_os_get_time_ns();
+    if (remaining < 0)
+        remaining = 0;
     struct timespec timeout;
-    timeout.tv_nsec = (seconds * 1000000000L);
-    timeout.tv_sec  = timeout.tv_nsec / 1000000000L;
-    timeout.tv_nsec = timeout.tv_nsec % 1000000000L;
+    timeout.tv_sec  = remaining / 1000000000;
+    timeout.tv_nsec = remaining % 1000000000;
 
     if (kevent(cond->kq_id, &kev, 1, &out_kev, 1, &timeout) == -1) {
         if (errno == EINTR)
@@ -487,12 +620,13 @@ void soundio_os_cond_timed_wait(struct SoundIoOsCond *cond,
         target_mutex = &cond->default_mutex_id;
         assert_no_err(pthread_mutex_lock(target_mutex));
     }
-    // this time is absolute
+    // this time is absolute, on the CLOCK_MONOTONIC the condition was
+    // created with
     struct timespec tms;
-    clock_gettime(CLOCK_MONOTONIC, &tms);
-    tms.tv_nsec += (seconds * 1000000000L);
-    tms.tv_sec += tms.tv_nsec / 1000000000L;
-    tms.tv_nsec = tms.tv_nsec % 1000000000L;
+    if (deadline < 0)
+        deadline = 0;
+    tms.tv_sec = deadline / 1000000000;
+    tms.tv_nsec = deadline % 1000000000;
     int err;
     if ((err = pthread_cond_timedwait(&cond->id, target_mutex, &tms))) {
         assert(err != EPERM);
@@ -556,10 +690,7 @@ void soundio_os_cond_wait(struct SoundIoOsCond *cond,
 
 static int internal_init(void) {
 #if defined(SOUNDIO_OS_WINDOWS)
-    unsigned __int64 frequency;
-    if (QueryPerformanceFrequency((LARGE_INTEGER*) &frequency)) {
-        win32_time_resolution = 1.0 / (double) frequency;
-    } else {
+    if (!QueryPerformanceFrequency((LARGE_INTEGER*) &win32_time_frequency)) {
         return SoundIoErrorSystemResources;
     }
     GetSystemInfo(&win32_system_info);
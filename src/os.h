@@ -10,6 +10,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // safe to call from any thread(s) multiple times, but
 // must be called at least once before calling any other os functions
@@ -18,10 +19,26 @@ int soundio_os_init(void);
 
 double soundio_os_get_time(void);
 
+// Nanoseconds on the monotonic clock that soundio_os_cond_timed_wait is
+// measured against. Use this rather than soundio_os_get_time for scheduling;
+// it does not lose precision as the system stays up.
+int64_t soundio_os_get_time_ns(void);
+
+// Nanoseconds on a monotonic clock that is not slewed to follow NTP
+// (CLOCK_MONOTONIC_RAW), where the system has one. Otherwise this is
+// soundio_os_get_time_ns.
+int64_t soundio_os_get_raw_time_ns(void);
+
 struct SoundIoOsThread;
+struct SoundIoThreadPolicy;
+// A NULL emit_rtprio_warning makes an ordinary thread, and policy is
+// ignored. Otherwise the thread is scheduled by policy, or by the default
+// policy if that is NULL. period is in nanoseconds and is only used with
+// SoundIoThreadSchedDeadline; pass 0 when there is no fixed period.
 int soundio_os_thread_create(
         void (*run)(void *arg), void *arg,
         void (*emit_rtprio_warning)(void),
+        const struct SoundIoThreadPolicy *policy, int64_t period,
         struct SoundIoOsThread ** out_thread);
 
 void soundio_os_thread_destroy(struct SoundIoOsThread *thread);
@@ -46,6 +63,11 @@ void soundio_os_cond_signal(struct SoundIoOsCond *cond,
         struct SoundIoOsMutex *locked_mutex);
 void soundio_os_cond_timed_wait(struct SoundIoOsCond *cond,
         struct SoundIoOsMutex *locked_mutex, double seconds);
+// Like soundio_os_cond_timed_wait, but waits until soundio_os_get_time_ns
+// reaches deadline. Threads that wake up periodically should use this with a
+// deadline advanced by whole periods, so that late wakeups do not add up.
+void soundio_os_cond_timed_wait_until(struct SoundIoOsCond *cond,
+        struct SoundIoOsMutex *locked_mutex, int64_t deadline);
 void soundio_os_cond_wait(struct SoundIoOsCond *cond,
         struct SoundIoOsMutex *locked_mutex);
 
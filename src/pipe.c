@@ -0,0 +1,688 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "pipe.h"
+#include "soundio_private.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/uio.h>
+#endif
+
+static const double default_software_latency = 0.1;
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        return -1;
+    return 0;
+}
+
+static int open_wake_fds(int *wake_fds, bool *have_wake_fds) {
+    if (pipe(wake_fds))
+        return SoundIoErrorSystemResources;
+    *have_wake_fds = true;
+    if (set_nonblocking(wake_fds[0]) || set_nonblocking(wake_fds[1]))
+        return SoundIoErrorSystemResources;
+    return 0;
+}
+
+static void close_wake_fds(int *wake_fds, bool *have_wake_fds) {
+    if (!*have_wake_fds)
+        return;
+    close(wake_fds[0]);
+    close(wake_fds[1]);
+    *have_wake_fds = false;
+}
+
+static void wake_stream_thread(int *wake_fds) {
+    char byte = 0;
+    // when the pipe is full the thread has a wakeup pending already
+    ssize_t amt = write(wake_fds[1], &byte, 1);
+    (void)amt;
+}
+
+static void drain_wake_fd(int *wake_fds) {
+    char bytes[64];
+    while (read(wake_fds[0], bytes, sizeof(bytes)) > 0) {}
+}
+
+// Opens the file descriptor of a stream. Streams of a device given by path get
+// their own, and the others share the caller's. O_NONBLOCK is set on the open
+// file description, which a duplicate would share as well, so when it was not
+// set before *out_restore_flags is set to true and *out_flags holds the flags
+// to put back with close_stream_fd.
+static int open_stream_fd(struct SoundIoDevice *device, int *out_fd, bool *out_close_fd,
+        bool *out_restore_flags, int *out_flags)
+{
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
+    struct SoundIoDevicePipe *devp = &dev->backend_data.pipe;
+
+    *out_restore_flags = false;
+    if (!devp->path) {
+        int flags = fcntl(devp->fd, F_GETFL);
+        if (flags == -1)
+            return SoundIoErrorOpeningDevice;
+        if (!(flags & O_NONBLOCK)) {
+            if (fcntl(devp->fd, F_SETFL, flags | O_NONBLOCK) == -1)
+                return SoundIoErrorOpeningDevice;
+            *out_restore_flags = true;
+            *out_flags = flags;
+        }
+        *out_fd = devp->fd;
+        *out_close_fd = false;
+        return 0;
+    }
+
+    // without O_NONBLOCK opening a FIFO waits for the other end, and for
+    // writing it fails with ENXIO instead
+    int flags = (device->aim == SoundIoDeviceAimOutput) ? O_WRONLY : O_RDONLY;
+    int fd = open(devp->path, flags | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1)
+        return SoundIoErrorOpeningDevice;
+    *out_fd = fd;
+    *out_close_fd = true;
+    return 0;
+}
+
+static void close_stream_fd(int fd, bool *close_fd, bool *restore_flags, int flags) {
+    if (*restore_flags) {
+        fcntl(fd, F_SETFL, flags);
+        *restore_flags = false;
+    }
+    if (*close_fd) {
+        close(fd);
+        *close_fd = false;
+    }
+}
+
+static void destruct_device(struct SoundIoDevicePrivate *dev) {
+    struct SoundIoDevicePipe *devp = &dev->backend_data.pipe;
+    free(devp->path);
+}
+
+static int create_device(struct SoundIoPrivate *si, const struct SoundIoPipeDeviceSpec *spec,
+        struct SoundIoDevice **out_device)
+{
+    struct SoundIo *soundio = &si->pub;
+
+    if ((!spec->path && spec->fd < 0) ||
+        (spec->aim != SoundIoDeviceAimInput && spec->aim != SoundIoDeviceAimOutput) ||
+        spec->format <= SoundIoFormatInvalid || spec->format > SoundIoFormatFloat64BE ||
+        spec->sample_rate < SOUNDIO_MIN_SAMPLE_RATE || spec->sample_rate > SOUNDIO_MAX_SAMPLE_RATE ||
+        spec->channel_count < 1 || spec->channel_count > SOUNDIO_MAX_CHANNELS)
+    {
+        return SoundIoErrorInvalid;
+    }
+
+    struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
+    if (!dev)
+        return SoundIoErrorNoMem;
+    struct SoundIoDevice *device = &dev->pub;
+    struct SoundIoDevicePipe *devp = &dev->backend_data.pipe;
+
+    dev->destruct = destruct_device;
+    device->ref_count = 1;
+    device->soundio = soundio;
+    device->aim = spec->aim;
+    devp->fd = spec->fd;
+    if (spec->path) {
+        devp->path = strdup(spec->path);
+        device->id = strdup(spec->path);
+    } else {
+        char id[32];
+        snprintf(id, sizeof(id), "fd %d", spec->fd);
+        device->id = strdup(id);
+    }
+    device->name = device->id ? strdup(device->id) : NULL;
+    if (!device->id || !device->name || (spec->path && !devp->path)) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+
+    device->software_latency_min = 0.001;
+    device->software_latency_max = 10.0;
+    device->software_latency_current = default_software_latency;
+
+    // the other end decides what goes through the pipe
+    device->current_format = spec->format;
+    device->format_count = 1;
+    device->formats = &dev->prealloc_format;
+    device->formats[0] = spec->format;
+
+    device->sample_rate_current = spec->sample_rate;
+    device->sample_rate_count = 1;
+    device->sample_rates = &dev->prealloc_sample_rate_range;
+    device->sample_rates[0].min = spec->sample_rate;
+    device->sample_rates[0].max = spec->sample_rate;
+
+    const struct SoundIoChannelLayout *layout = soundio_channel_layout_get_default(spec->channel_count);
+    if (layout) {
+        device->current_layout = *layout;
+    } else {
+        device->current_layout.channel_count = spec->channel_count;
+        for (int i = 0; i < spec->channel_count; i += 1)
+            device->current_layout.channels[i] = (enum SoundIoChannelId)(SoundIoChannelIdAux0 + i);
+    }
+    device->layout_count = 1;
+    device->layouts = &device->current_layout;
+
+    *out_device = device;
+    return 0;
+}
+
+static void destroy_pipe(struct SoundIoPrivate *si) {
+    struct SoundIoPipe *sip = &si->backend_data.pipe;
+
+    if (sip->cond)
+        soundio_os_cond_destroy(sip->cond);
+}
+
+static void flush_events_pipe(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoPipe *sip = &si->backend_data.pipe;
+    if (sip->devices_emitted)
+        return;
+    sip->devices_emitted = true;
+    soundio->on_devices_change(soundio);
+}
+
+static void wait_events_pipe(struct SoundIoPrivate *si) {
+    struct SoundIoPipe *sip = &si->backend_data.pipe;
+    flush_events_pipe(si);
+    soundio_os_cond_wait(sip->cond, NULL);
+}
+
+static void wakeup_pipe(struct SoundIoPrivate *si) {
+    struct SoundIoPipe *sip = &si->backend_data.pipe;
+    soundio_os_cond_signal(sip->cond, NULL);
+}
+
+static void force_device_scan_pipe(struct SoundIoPrivate *si) {
+    // nothing to do; the devices are the ones given when connecting
+}
+
+// Hands buffered frames to the file descriptor without waiting. Returns 0, or
+// an error when the other end is gone.
+static int outstream_drain_pipe(struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    int fill_bytes = soundio_ring_buffer_fill_count(&osp->ring_buffer);
+    if (fill_bytes == 0)
+        return 0;
+    char *read_ptr = soundio_ring_buffer_read_ptr(&osp->ring_buffer);
+    ssize_t amt;
+    bool spliced = false;
+
+#if defined(__linux__)
+    if (osp->use_vmsplice) {
+        // Bytes still in the pipe are the last ones spliced, and must stay
+        // within the reserve. The other end may have made the pipe bigger
+        // since the stream was opened, and then the rest is copied.
+        int queued_bytes;
+        if (ioctl(osp->fd, FIONREAD, &queued_bytes))
+            queued_bytes = osp->reserve;
+        int splice_bytes = soundio_int_min(fill_bytes, osp->reserve - queued_bytes);
+        if (splice_bytes > 0) {
+            struct iovec iov;
+            iov.iov_base = read_ptr;
+            iov.iov_len = splice_bytes;
+            amt = vmsplice(osp->fd, &iov, 1, SPLICE_F_NONBLOCK);
+            spliced = true;
+        }
+    }
+#endif
+
+    if (!spliced)
+        amt = write(osp->fd, read_ptr, fill_bytes);
+
+    if (amt == -1) {
+        if (errno == EAGAIN || errno == EINTR)
+            return 0;
+        return SoundIoErrorStreaming;
+    }
+    soundio_ring_buffer_advance_read_ptr(&osp->ring_buffer, amt);
+    return 0;
+}
+
+static void playback_thread_run(void *arg) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)arg;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+
+    // a reader that goes away is reported with EPIPE instead
+    sigset_t sigpipe_set;
+    sigemptyset(&sigpipe_set);
+    sigaddset(&sigpipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe_set, NULL);
+
+    int capacity = soundio_ring_buffer_capacity(&osp->ring_buffer);
+
+    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osp->abort_flag)) {
+        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osp->clear_buffer_flag))
+            soundio_ring_buffer_clear(&osp->ring_buffer);
+
+        bool paused = SOUNDIO_ATOMIC_LOAD(osp->pause_requested);
+        int fill_bytes = soundio_ring_buffer_fill_count(&osp->ring_buffer);
+        if (!paused) {
+            int free_frames = (capacity - osp->reserve - fill_bytes) / outstream->bytes_per_frame;
+            if (free_frames > 0) {
+                osp->frames_left = free_frames;
+                outstream->write_callback(outstream, 0, free_frames);
+                fill_bytes = soundio_ring_buffer_fill_count(&osp->ring_buffer);
+            }
+        }
+
+        // wait for room in the pipe, or for the callback to have something
+        // to write next time
+        struct pollfd fds[2];
+        fds[0].fd = osp->wake_fds[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = osp->fd;
+        fds[1].events = POLLOUT;
+        nfds_t nfds = (!paused && fill_bytes > 0) ? 2 : 1;
+        int timeout = (!paused && fill_bytes == 0) ? osp->period_ms : -1;
+        if (poll(fds, nfds, timeout) == -1 && errno != EINTR) {
+            outstream->error_callback(outstream, SoundIoErrorStreaming);
+            return;
+        }
+        if (fds[0].revents)
+            drain_wake_fd(osp->wake_fds);
+        if (nfds == 2 && fds[1].revents) {
+            if (outstream_drain_pipe(os)) {
+                outstream->error_callback(outstream, SoundIoErrorStreaming);
+                return;
+            }
+        }
+    }
+}
+
+static void outstream_destroy_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+
+    if (osp->thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(osp->abort_flag);
+        wake_stream_thread(osp->wake_fds);
+        soundio_os_thread_destroy(osp->thread);
+        osp->thread = NULL;
+    }
+
+    close_stream_fd(osp->fd, &osp->close_fd, &osp->restore_fd_flags, osp->fd_flags);
+    close_wake_fds(osp->wake_fds, &osp->have_wake_fds);
+
+    soundio_ring_buffer_deinit(&osp->ring_buffer);
+}
+
+static int outstream_open_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoDevice *device = outstream->device;
+    int err;
+
+    if (outstream->format != device->current_format ||
+        outstream->sample_rate != device->sample_rate_current ||
+        outstream->layout.channel_count != device->current_layout.channel_count)
+    {
+        return SoundIoErrorIncompatibleDevice;
+    }
+
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osp->clear_buffer_flag);
+    SOUNDIO_ATOMIC_STORE(osp->pause_requested, false);
+
+    if (outstream->software_latency == 0.0)
+        outstream->software_latency = device->software_latency_current;
+    outstream->software_latency = soundio_double_clamp(device->software_latency_min,
+            outstream->software_latency, device->software_latency_max);
+    osp->period_ms = soundio_int_max(1, outstream->software_latency * 1000.0 / 2.0);
+
+    if ((err = open_stream_fd(device, &osp->fd, &osp->close_fd, &osp->restore_fd_flags, &osp->fd_flags))) {
+        outstream_destroy_pipe(si, os);
+        return err;
+    }
+    if ((err = open_wake_fds(osp->wake_fds, &osp->have_wake_fds))) {
+        outstream_destroy_pipe(si, os);
+        return err;
+    }
+
+    osp->use_vmsplice = false;
+    osp->reserve = 0;
+#if defined(__linux__)
+    // Only pipes take pages by reference from vmsplice. Sockets would hold
+    // on to spliced pages for as long as the data is queued, with no way to
+    // tell when they let go.
+    struct stat st;
+    if (fstat(osp->fd, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        int pipe_size = fcntl(osp->fd, F_GETPIPE_SZ);
+        if (pipe_size > 0) {
+            osp->use_vmsplice = true;
+            osp->reserve = pipe_size;
+        }
+    }
+#endif
+
+    int buffer_size = outstream->bytes_per_frame * outstream->sample_rate * outstream->software_latency;
+    buffer_size = soundio_int_max(buffer_size, outstream->bytes_per_frame);
+    if ((err = soundio_ring_buffer_init(&osp->ring_buffer, buffer_size + osp->reserve))) {
+        outstream_destroy_pipe(si, os);
+        return err;
+    }
+    int capacity = soundio_ring_buffer_capacity(&osp->ring_buffer);
+    int buffer_frame_count = (capacity - osp->reserve) / outstream->bytes_per_frame;
+    outstream->software_latency = buffer_frame_count / (double)outstream->sample_rate;
+
+    return 0;
+}
+
+static int outstream_pause_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, bool pause) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    SOUNDIO_ATOMIC_STORE(osp->pause_requested, pause);
+    wake_stream_thread(osp->wake_fds);
+    return 0;
+}
+
+static int outstream_start_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    struct SoundIo *soundio = &si->pub;
+    assert(!osp->thread);
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osp->abort_flag);
+    return soundio_os_thread_create(playback_thread_run, os, soundio->emit_rtprio_warning,
+            &os->thread_policy, osp->period_ms * (int64_t)1000000, &osp->thread);
+}
+
+static int outstream_begin_write_pipe(struct SoundIoPrivate *si,
+        struct SoundIoOutStreamPrivate *os, struct SoundIoChannelArea **out_areas, int *frame_count)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+
+    if (*frame_count > osp->frames_left)
+        return SoundIoErrorInvalid;
+
+    char *write_ptr = soundio_ring_buffer_write_ptr(&osp->ring_buffer);
+    for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+        osp->areas[ch].ptr = write_ptr + outstream->bytes_per_sample * ch;
+        osp->areas[ch].step = outstream->bytes_per_frame;
+    }
+
+    osp->write_frame_count = *frame_count;
+    *out_areas = osp->areas;
+    return 0;
+}
+
+static int outstream_end_write_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    struct SoundIoOutStream *outstream = &os->pub;
+    int byte_count = osp->write_frame_count * outstream->bytes_per_frame;
+    soundio_ring_buffer_advance_write_ptr(&osp->ring_buffer, byte_count);
+    osp->frames_left -= osp->write_frame_count;
+    return 0;
+}
+
+static int outstream_clear_buffer_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    // what is in the pipe already cannot be taken back
+    SOUNDIO_ATOMIC_FLAG_CLEAR(osp->clear_buffer_flag);
+    wake_stream_thread(osp->wake_fds);
+    return 0;
+}
+
+static int outstream_get_latency_pipe(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        double *out_latency)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPipe *osp = &os->backend_data.pipe;
+    int fill_bytes = soundio_ring_buffer_fill_count(&osp->ring_buffer);
+    int queued_bytes;
+    if (ioctl(osp->fd, FIONREAD, &queued_bytes) == 0 && queued_bytes > 0)
+        fill_bytes += queued_bytes;
+
+    *out_latency = (fill_bytes / outstream->bytes_per_frame) / (double)outstream->sample_rate;
+    return 0;
+}
+
+static void capture_thread_run(void *arg) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)arg;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+
+    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isp->abort_flag)) {
+        bool paused = SOUNDIO_ATOMIC_LOAD(isp->pause_requested);
+        int free_bytes = soundio_ring_buffer_free_count(&isp->ring_buffer);
+
+        // while the buffer is full the writer is held back by the pipe,
+        // and the callback is offered the frames again each period
+        struct pollfd fds[2];
+        fds[0].fd = isp->wake_fds[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = isp->fd;
+        fds[1].events = POLLIN;
+        nfds_t nfds = (!paused && free_bytes > 0) ? 2 : 1;
+        int timeout = (!paused && free_bytes == 0) ? isp->period_ms : -1;
+        if (poll(fds, nfds, timeout) == -1 && errno != EINTR) {
+            instream->error_callback(instream, SoundIoErrorStreaming);
+            return;
+        }
+        if (fds[0].revents)
+            drain_wake_fd(isp->wake_fds);
+        if (nfds == 2 && fds[1].revents) {
+            char *write_ptr = soundio_ring_buffer_write_ptr(&isp->ring_buffer);
+            ssize_t amt = read(isp->fd, write_ptr, free_bytes);
+            if (amt == 0 || (amt == -1 && errno != EAGAIN && errno != EINTR)) {
+                // the writer went away
+                instream->error_callback(instream, SoundIoErrorStreaming);
+                return;
+            }
+            if (amt > 0)
+                soundio_ring_buffer_advance_write_ptr(&isp->ring_buffer, amt);
+        }
+
+        if (paused)
+            continue;
+        int fill_bytes = soundio_ring_buffer_fill_count(&isp->ring_buffer);
+        int fill_frames = fill_bytes / instream->bytes_per_frame;
+        if (fill_frames > 0) {
+            isp->frames_left = fill_frames;
+            instream->read_callback(instream, 0, fill_frames);
+        }
+    }
+}
+
+static void instream_destroy_pipe(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+
+    if (isp->thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(isp->abort_flag);
+        wake_stream_thread(isp->wake_fds);
+        soundio_os_thread_destroy(isp->thread);
+        isp->thread = NULL;
+    }
+
+    close_stream_fd(isp->fd, &isp->close_fd, &isp->restore_fd_flags, isp->fd_flags);
+    close_wake_fds(isp->wake_fds, &isp->have_wake_fds);
+
+    soundio_ring_buffer_deinit(&isp->ring_buffer);
+}
+
+static int instream_open_pipe(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoDevice *device = instream->device;
+    int err;
+
+    if (instream->format != device->current_format ||
+        instream->sample_rate != device->sample_rate_current ||
+        instream->layout.channel_count != device->current_layout.channel_count)
+    {
+        return SoundIoErrorIncompatibleDevice;
+    }
+
+    SOUNDIO_ATOMIC_STORE(isp->pause_requested, false);
+
+    if (instream->software_latency == 0.0)
+        instream->software_latency = device->software_latency_current;
+    instream->software_latency = soundio_double_clamp(device->software_latency_min,
+            instream->software_latency, device->software_latency_max);
+    isp->period_ms = soundio_int_max(1, instream->software_latency * 1000.0 / 2.0);
+
+    if ((err = open_stream_fd(device, &isp->fd, &isp->close_fd, &isp->restore_fd_flags, &isp->fd_flags))) {
+        instream_destroy_pipe(si, is);
+        return err;
+    }
+    if ((err = open_wake_fds(isp->wake_fds, &isp->have_wake_fds))) {
+        instream_destroy_pipe(si, is);
+        return err;
+    }
+
+    int buffer_size = instream->bytes_per_frame * instream->sample_rate * instream->software_latency;
+    buffer_size = soundio_int_max(buffer_size, instream->bytes_per_frame);
+    if ((err = soundio_ring_buffer_init(&isp->ring_buffer, buffer_size))) {
+        instream_destroy_pipe(si, is);
+        return err;
+    }
+
+    return 0;
+}
+
+static int instream_pause_pipe(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is, bool pause) {
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+    SOUNDIO_ATOMIC_STORE(isp->pause_requested, pause);
+    wake_stream_thread(isp->wake_fds);
+    return 0;
+}
+
+static int instream_start_pipe(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+    struct SoundIo *soundio = &si->pub;
+    assert(!isp->thread);
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isp->abort_flag);
+    return soundio_os_thread_create(capture_thread_run, is, soundio->emit_rtprio_warning,
+            &is->thread_policy, isp->period_ms * (int64_t)1000000, &isp->thread);
+}
+
+static int instream_begin_read_pipe(struct SoundIoPrivate *si,
+        struct SoundIoInStreamPrivate *is, struct SoundIoChannelArea **out_areas, int *frame_count)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+
+    if (*frame_count > isp->frames_left)
+        return SoundIoErrorInvalid;
+
+    char *read_ptr = soundio_ring_buffer_read_ptr(&isp->ring_buffer);
+    for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
+        isp->areas[ch].ptr = read_ptr + instream->bytes_per_sample * ch;
+        isp->areas[ch].step = instream->bytes_per_frame;
+    }
+
+    isp->read_frame_count = *frame_count;
+    *out_areas = isp->areas;
+    return 0;
+}
+
+static int instream_end_read_pipe(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+    struct SoundIoInStream *instream = &is->pub;
+    int byte_count = isp->read_frame_count * instream->bytes_per_frame;
+    soundio_ring_buffer_advance_read_ptr(&isp->ring_buffer, byte_count);
+    isp->frames_left -= isp->read_frame_count;
+    return 0;
+}
+
+static int instream_get_latency_pipe(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
+        double *out_latency)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipe *isp = &is->backend_data.pipe;
+    int fill_bytes = soundio_ring_buffer_fill_count(&isp->ring_buffer);
+    int queued_bytes;
+    if (ioctl(isp->fd, FIONREAD, &queued_bytes) == 0 && queued_bytes > 0)
+        fill_bytes += queued_bytes;
+
+    *out_latency = (fill_bytes / instream->bytes_per_frame) / (double)instream->sample_rate;
+    return 0;
+}
+
+int soundio_pipe_init(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoPipe *sip = &si->backend_data.pipe;
+    int err;
+
+    if (soundio->pipe_device_count < 0 || (soundio->pipe_device_count > 0 && !soundio->pipe_devices))
+        return SoundIoErrorInvalid;
+
+    sip->cond = soundio_os_cond_create();
+    if (!sip->cond) {
+        destroy_pipe(si);
+        return SoundIoErrorNoMem;
+    }
+
+    assert(!si->safe_devices_info);
+    si->safe_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!si->safe_devices_info) {
+        destroy_pipe(si);
+        return SoundIoErrorNoMem;
+    }
+    si->safe_devices_info->default_input_index = -1;
+    si->safe_devices_info->default_output_index = -1;
+
+    for (int i = 0; i < soundio->pipe_device_count; i += 1) {
+        struct SoundIoDevice *device;
+        if ((err = create_device(si, &soundio->pipe_devices[i], &device))) {
+            destroy_pipe(si);
+            return err;
+        }
+        struct SoundIoListDevicePtr *list = (device->aim == SoundIoDeviceAimInput) ?
+            &si->safe_devices_info->input_devices : &si->safe_devices_info->output_devices;
+        if (SoundIoListDevicePtr_append(list, device)) {
+            soundio_device_unref(device);
+            destroy_pipe(si);
+            return SoundIoErrorNoMem;
+        }
+    }
+    if (si->safe_devices_info->input_devices.length > 0)
+        si->safe_devices_info->default_input_index = 0;
+    if (si->safe_devices_info->output_devices.length > 0)
+        si->safe_devices_info->default_output_index = 0;
+
+    si->destroy = destroy_pipe;
+    si->flush_events = flush_events_pipe;
+    si->wait_events = wait_events_pipe;
+    si->wakeup = wakeup_pipe;
+    si->force_device_scan = force_device_scan_pipe;
+
+    si->outstream_open = outstream_open_pipe;
+    si->outstream_destroy = outstream_destroy_pipe;
+    si->outstream_start = outstream_start_pipe;
+    si->outstream_begin_write = outstream_begin_write_pipe;
+    si->outstream_end_write = outstream_end_write_pipe;
+    si->outstream_clear_buffer = outstream_clear_buffer_pipe;
+    si->outstream_pause = outstream_pause_pipe;
+    si->outstream_get_latency = outstream_get_latency_pipe;
+
+    si->instream_open = instream_open_pipe;
+    si->instream_destroy = instream_destroy_pipe;
+    si->instream_start = instream_start_pipe;
+    si->instream_begin_read = instream_begin_read_pipe;
+    si->instream_end_read = instream_end_read_pipe;
+    si->instream_pause = instream_pause_pipe;
+    si->instream_get_latency = instream_get_latency_pipe;
+
+    return 0;
+}
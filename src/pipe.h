@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_PIPE_H
+#define SOUNDIO_PIPE_H
+
+#include "soundio_internal.h"
+#include "os.h"
+#include "ring_buffer.h"
+#include "atomics.h"
+
+struct SoundIoPrivate;
+int soundio_pipe_init(struct SoundIoPrivate *si);
+
+struct SoundIoPipe {
+    struct SoundIoOsCond *cond;
+    bool devices_emitted;
+};
+
+struct SoundIoDevicePipe {
+    // NULL when the device is the caller's file descriptor
+    char *path;
+    int fd;
+};
+
+struct SoundIoOutStreamPipe {
+    int fd;
+    bool close_fd;
+    // the caller's file descriptor gets back fd_flags when the stream is
+    // destroyed
+    bool restore_fd_flags;
+    int fd_flags;
+    // written to by other threads to interrupt poll()
+    int wake_fds[2];
+    bool have_wake_fds;
+    struct SoundIoOsThread *thread;
+    struct SoundIoAtomicFlag abort_flag;
+    struct SoundIoAtomicFlag clear_buffer_flag;
+    struct SoundIoAtomicBool pause_requested;
+    struct SoundIoRingBuffer ring_buffer;
+    // With vmsplice the pipe holds references to the ring buffer pages
+    // instead of copies, so this many bytes behind the read pointer are never
+    // handed to the write callback. It is the size of the pipe.
+    bool use_vmsplice;
+    int reserve;
+    int period_ms;
+    int frames_left;
+    int write_frame_count;
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+};
+
+struct SoundIoInStreamPipe {
+    int fd;
+    bool close_fd;
+    bool restore_fd_flags;
+    int fd_flags;
+    int wake_fds[2];
+    bool have_wake_fds;
+    struct SoundIoOsThread *thread;
+    struct SoundIoAtomicFlag abort_flag;
+    struct SoundIoAtomicBool pause_requested;
+    struct SoundIoRingBuffer ring_buffer;
+    int period_ms;
+    int frames_left;
+    int read_frame_count;
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+};
+
+#endif
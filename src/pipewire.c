@@ -0,0 +1,978 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "pipewire.h"
+#include "soundio_private.h"
+
+#include <spa/param/audio/format-utils.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifndef PW_KEY_TARGET_OBJECT
+#define PW_KEY_TARGET_OBJECT "target.object"
+#endif
+
+// Daemons older than 0.3.64 ignore target.object and only route by this one,
+// which takes the id of the node instead of its name.
+#define SOUNDIO_PW_KEY_NODE_TARGET "node.target"
+
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoPipeWireNode, SoundIoListPipeWireNode, SOUNDIO_LIST_STATIC)
+
+// PipeWire converts formats, rates and channel layouts for streams, so these
+// only bound what a stream may ask for. Latency is the quantum of the graph.
+static const int default_sample_rate = 48000;
+static const double software_latency_min = 32.0 / 48000.0;
+static const double software_latency_max = 8192.0 / 48000.0;
+static const double default_software_latency = 1024.0 / 48000.0;
+
+struct FormatMapping {
+    enum SoundIoFormat format;
+    enum spa_audio_format spa_format;
+};
+
+static const struct FormatMapping format_mappings[] = {
+    {SoundIoFormatFloat32LE, SPA_AUDIO_FORMAT_F32_LE},
+    {SoundIoFormatFloat32BE, SPA_AUDIO_FORMAT_F32_BE},
+    {SoundIoFormatS32LE, SPA_AUDIO_FORMAT_S32_LE},
+    {SoundIoFormatS32BE, SPA_AUDIO_FORMAT_S32_BE},
+    {SoundIoFormatS24LE, SPA_AUDIO_FORMAT_S24_32_LE},
+    {SoundIoFormatS24BE, SPA_AUDIO_FORMAT_S24_32_BE},
+    {SoundIoFormatS16LE, SPA_AUDIO_FORMAT_S16_LE},
+    {SoundIoFormatS16BE, SPA_AUDIO_FORMAT_S16_BE},
+    {SoundIoFormatFloat64LE, SPA_AUDIO_FORMAT_F64_LE},
+    {SoundIoFormatFloat64BE, SPA_AUDIO_FORMAT_F64_BE},
+    {SoundIoFormatU32LE, SPA_AUDIO_FORMAT_U32_LE},
+    {SoundIoFormatU32BE, SPA_AUDIO_FORMAT_U32_BE},
+    {SoundIoFormatU24LE, SPA_AUDIO_FORMAT_U24_32_LE},
+    {SoundIoFormatU24BE, SPA_AUDIO_FORMAT_U24_32_BE},
+    {SoundIoFormatU16LE, SPA_AUDIO_FORMAT_U16_LE},
+    {SoundIoFormatU16BE, SPA_AUDIO_FORMAT_U16_BE},
+    {SoundIoFormatS8, SPA_AUDIO_FORMAT_S8},
+    {SoundIoFormatU8, SPA_AUDIO_FORMAT_U8},
+};
+
+struct ChannelMapping {
+    // as written in the audio.position property
+    const char *name;
+    enum spa_audio_channel spa_channel;
+    enum SoundIoChannelId channel_id;
+};
+
+static const struct ChannelMapping channel_mappings[] = {
+    {"FL", SPA_AUDIO_CHANNEL_FL, SoundIoChannelIdFrontLeft},
+    {"FR", SPA_AUDIO_CHANNEL_FR, SoundIoChannelIdFrontRight},
+    {"FC", SPA_AUDIO_CHANNEL_FC, SoundIoChannelIdFrontCenter},
+    {"LFE", SPA_AUDIO_CHANNEL_LFE, SoundIoChannelIdLfe},
+    {"RL", SPA_AUDIO_CHANNEL_RL, SoundIoChannelIdBackLeft},
+    {"RR", SPA_AUDIO_CHANNEL_RR, SoundIoChannelIdBackRight},
+    {"FLC", SPA_AUDIO_CHANNEL_FLC, SoundIoChannelIdFrontLeftCenter},
+    {"FRC", SPA_AUDIO_CHANNEL_FRC, SoundIoChannelIdFrontRightCenter},
+    {"RC", SPA_AUDIO_CHANNEL_RC, SoundIoChannelIdBackCenter},
+    {"SL", SPA_AUDIO_CHANNEL_SL, SoundIoChannelIdSideLeft},
+    {"SR", SPA_AUDIO_CHANNEL_SR, SoundIoChannelIdSideRight},
+    {"TC", SPA_AUDIO_CHANNEL_TC, SoundIoChannelIdTopCenter},
+    {"TFL", SPA_AUDIO_CHANNEL_TFL, SoundIoChannelIdTopFrontLeft},
+    {"TFC", SPA_AUDIO_CHANNEL_TFC, SoundIoChannelIdTopFrontCenter},
+    {"TFR", SPA_AUDIO_CHANNEL_TFR, SoundIoChannelIdTopFrontRight},
+    {"TRL", SPA_AUDIO_CHANNEL_TRL, SoundIoChannelIdTopBackLeft},
+    {"TRC", SPA_AUDIO_CHANNEL_TRC, SoundIoChannelIdTopBackCenter},
+    {"TRR", SPA_AUDIO_CHANNEL_TRR, SoundIoChannelIdTopBackRight},
+    {"RLC", SPA_AUDIO_CHANNEL_RLC, SoundIoChannelIdBackLeftCenter},
+    {"RRC", SPA_AUDIO_CHANNEL_RRC, SoundIoChannelIdBackRightCenter},
+    {"FLW", SPA_AUDIO_CHANNEL_FLW, SoundIoChannelIdFrontLeftWide},
+    {"FRW", SPA_AUDIO_CHANNEL_FRW, SoundIoChannelIdFrontRightWide},
+    {"LFE2", SPA_AUDIO_CHANNEL_LFE2, SoundIoChannelIdLfe2},
+    {"FLH", SPA_AUDIO_CHANNEL_FLH, SoundIoChannelIdFrontLeftHigh},
+    {"FCH", SPA_AUDIO_CHANNEL_FCH, SoundIoChannelIdFrontCenterHigh},
+    {"FRH", SPA_AUDIO_CHANNEL_FRH, SoundIoChannelIdFrontRightHigh},
+    {"TFLC", SPA_AUDIO_CHANNEL_TFLC, SoundIoChannelIdTopFrontLeftCenter},
+    {"TFRC", SPA_AUDIO_CHANNEL_TFRC, SoundIoChannelIdTopFrontRightCenter},
+    {"TSL", SPA_AUDIO_CHANNEL_TSL, SoundIoChannelIdTopSideLeft},
+    {"TSR", SPA_AUDIO_CHANNEL_TSR, SoundIoChannelIdTopSideRight},
+    {"LLFE", SPA_AUDIO_CHANNEL_LLFE, SoundIoChannelIdLeftLfe},
+    {"RLFE", SPA_AUDIO_CHANNEL_RLFE, SoundIoChannelIdRightLfe},
+    {"BC", SPA_AUDIO_CHANNEL_BC, SoundIoChannelIdBottomCenter},
+    {"BLC", SPA_AUDIO_CHANNEL_BLC, SoundIoChannelIdBottomLeftCenter},
+    {"BRC", SPA_AUDIO_CHANNEL_BRC, SoundIoChannelIdBottomRightCenter},
+};
+
+static enum spa_audio_format to_spa_format(enum SoundIoFormat format) {
+    for (int i = 0; i < ARRAY_LENGTH(format_mappings); i += 1) {
+        if (format_mappings[i].format == format)
+            return format_mappings[i].spa_format;
+    }
+    return SPA_AUDIO_FORMAT_UNKNOWN;
+}
+
+static uint32_t to_spa_channel(enum SoundIoChannelId channel_id) {
+    for (int i = 0; i < ARRAY_LENGTH(channel_mappings); i += 1) {
+        if (channel_mappings[i].channel_id == channel_id)
+            return channel_mappings[i].spa_channel;
+    }
+    if (channel_id >= SoundIoChannelIdAux0 && channel_id <= SoundIoChannelIdAux15)
+        return SPA_AUDIO_CHANNEL_AUX0 + (channel_id - SoundIoChannelIdAux0);
+    return SPA_AUDIO_CHANNEL_UNKNOWN;
+}
+
+static enum SoundIoChannelId from_position_name(const char *name, int len) {
+    for (int i = 0; i < ARRAY_LENGTH(channel_mappings); i += 1) {
+        const char *mapping_name = channel_mappings[i].name;
+        if ((int)strlen(mapping_name) == len && memcmp(mapping_name, name, len) == 0)
+            return channel_mappings[i].channel_id;
+    }
+    if (len > 3 && memcmp(name, "AUX", 3) == 0) {
+        int aux = atoi(name + 3);
+        if (aux >= 0 && aux <= SoundIoChannelIdAux15 - SoundIoChannelIdAux0)
+            return (enum SoundIoChannelId)(SoundIoChannelIdAux0 + aux);
+    }
+    return SoundIoChannelIdInvalid;
+}
+
+// Parses an audio.position property such as "FL,FR" or "[ FL FR ]".
+static void parse_position(const char *position, struct SoundIoChannelLayout *layout) {
+    layout->channel_count = 0;
+    const char *ptr = position;
+    while (*ptr) {
+        while (*ptr && !((*ptr >= 'A' && *ptr <= 'Z') || (*ptr >= '0' && *ptr <= '9')))
+            ptr += 1;
+        const char *start = ptr;
+        while ((*ptr >= 'A' && *ptr <= 'Z') || (*ptr >= '0' && *ptr <= '9'))
+            ptr += 1;
+        if (ptr == start)
+            break;
+        enum SoundIoChannelId channel_id = from_position_name(start, ptr - start);
+        if (channel_id == SoundIoChannelIdInvalid || layout->channel_count == SOUNDIO_MAX_CHANNELS) {
+            layout->channel_count = 0;
+            return;
+        }
+        layout->channels[layout->channel_count++] = channel_id;
+    }
+    soundio_channel_layout_detect_builtin(layout);
+}
+
+static void free_node(struct SoundIoPipeWireNode *node) {
+    free(node->name);
+    free(node->description);
+}
+
+static int find_node(struct SoundIoPipeWire *sipw, uint32_t id) {
+    for (int i = 0; i < sipw->nodes.length; i += 1) {
+        if (SoundIoListPipeWireNode_ptr_at(&sipw->nodes, i)->id == id)
+            return i;
+    }
+    return -1;
+}
+
+// called from the main loop
+static void queue_device_scan(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    sipw->device_scan_queued = true;
+    pw_thread_loop_signal(sipw->main_loop, false);
+    soundio->on_events_signal(soundio);
+}
+
+// The value is JSON such as { "name": "alsa_output.pci-0000_00_1f.3" }.
+static char *parse_default_name(const char *value) {
+    if (!value)
+        return NULL;
+    const char *ptr = strstr(value, "\"name\"");
+    if (!ptr)
+        return NULL;
+    ptr += strlen("\"name\"");
+    while (*ptr == ' ' || *ptr == ':')
+        ptr += 1;
+    if (*ptr != '"')
+        return NULL;
+    ptr += 1;
+    const char *end = strchr(ptr, '"');
+    if (!end)
+        return NULL;
+    return soundio_str_dupe(ptr, end - ptr);
+}
+
+static int metadata_property(void *data, uint32_t subject, const char *key, const char *type,
+        const char *value)
+{
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)data;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    if (subject != PW_ID_CORE)
+        return 0;
+    // a NULL key clears everything
+    if (!key || strcmp(key, "default.audio.sink") == 0) {
+        free(sipw->default_sink_name);
+        sipw->default_sink_name = parse_default_name(key ? value : NULL);
+    }
+    if (!key || strcmp(key, "default.audio.source") == 0) {
+        free(sipw->default_source_name);
+        sipw->default_source_name = parse_default_name(key ? value : NULL);
+    }
+    queue_device_scan(si);
+    return 0;
+}
+
+static void registry_global(void *data, uint32_t id, uint32_t permissions, const char *type,
+        uint32_t version, const struct spa_dict *props)
+{
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)data;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    if (!props)
+        return;
+
+    if (strcmp(type, PW_TYPE_INTERFACE_Metadata) == 0) {
+        const char *metadata_name = spa_dict_lookup(props, PW_KEY_METADATA_NAME);
+        if (sipw->metadata || !metadata_name || strcmp(metadata_name, "default") != 0)
+            return;
+        sipw->metadata = (struct pw_metadata *)pw_registry_bind(sipw->registry, id, type,
+                PW_VERSION_METADATA, 0);
+        if (!sipw->metadata)
+            return;
+        sipw->metadata_id = id;
+        pw_metadata_add_listener(sipw->metadata, &sipw->metadata_listener, &sipw->metadata_events, si);
+        // the default devices are known once this round trip is done too
+        if (!sipw->ready_flag)
+            sipw->sync_seq = pw_core_sync(sipw->core, PW_ID_CORE, sipw->sync_seq);
+        return;
+    }
+
+    if (strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+        return;
+
+    const char *media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+    const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+    if (!media_class || !name)
+        return;
+    // Virtual sources, such as the output of an echo canceller, are recorded
+    // from like any other source.
+    bool is_sink = (strcmp(media_class, "Audio/Sink") == 0 || strcmp(media_class, "Audio/Duplex") == 0);
+    bool is_source = (strcmp(media_class, "Audio/Source") == 0 ||
+            strcmp(media_class, "Audio/Source/Virtual") == 0 || strcmp(media_class, "Audio/Duplex") == 0);
+    if (!is_sink && !is_source)
+        return;
+
+    const char *description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+    const char *rate = spa_dict_lookup(props, "audio.rate");
+    const char *channels = spa_dict_lookup(props, "audio.channels");
+    const char *position = spa_dict_lookup(props, "audio.position");
+
+    if (SoundIoListPipeWireNode_add_one(&sipw->nodes)) {
+        sipw->connection_err = SoundIoErrorNoMem;
+        queue_device_scan(si);
+        return;
+    }
+    struct SoundIoPipeWireNode *node = SoundIoListPipeWireNode_last_ptr(&sipw->nodes);
+    memset(node, 0, sizeof(struct SoundIoPipeWireNode));
+    node->id = id;
+    node->name = strdup(name);
+    node->description = strdup(description ? description : name);
+    node->is_sink = is_sink;
+    node->is_source = is_source;
+    node->sample_rate = rate ? atoi(rate) : 0;
+    if (position) {
+        parse_position(position, &node->layout);
+    } else if (channels) {
+        const struct SoundIoChannelLayout *layout = soundio_channel_layout_get_default(atoi(channels));
+        if (layout)
+            node->layout = *layout;
+    }
+    if (!node->name || !node->description) {
+        free_node(node);
+        SoundIoListPipeWireNode_pop(&sipw->nodes);
+        sipw->connection_err = SoundIoErrorNoMem;
+    }
+    queue_device_scan(si);
+}
+
+static void registry_global_remove(void *data, uint32_t id) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)data;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    if (sipw->metadata && id == sipw->metadata_id) {
+        spa_hook_remove(&sipw->metadata_listener);
+        pw_proxy_destroy((struct pw_proxy *)sipw->metadata);
+        sipw->metadata = NULL;
+        free(sipw->default_sink_name);
+        free(sipw->default_source_name);
+        sipw->default_sink_name = NULL;
+        sipw->default_source_name = NULL;
+        queue_device_scan(si);
+        return;
+    }
+
+    int i = find_node(sipw, id);
+    if (i < 0)
+        return;
+    free_node(SoundIoListPipeWireNode_ptr_at(&sipw->nodes, i));
+    // keep the order the registry announced the nodes in
+    for (int j = i; j < sipw->nodes.length - 1; j += 1)
+        sipw->nodes.items[j] = sipw->nodes.items[j + 1];
+    SoundIoListPipeWireNode_pop(&sipw->nodes);
+    queue_device_scan(si);
+}
+
+static void core_done(void *data, uint32_t id, int seq) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)data;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    if (id != PW_ID_CORE || seq != sipw->sync_seq)
+        return;
+    sipw->ready_flag = true;
+    pw_thread_loop_signal(sipw->main_loop, false);
+}
+
+static void core_error(void *data, uint32_t id, int seq, int res, const char *message) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)data;
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    // errors about other objects are reported to their owners
+    if (id != PW_ID_CORE || res != -EPIPE)
+        return;
+
+    if (sipw->ready_flag) {
+        sipw->connection_err = SoundIoErrorBackendDisconnected;
+    } else {
+        sipw->connection_err = SoundIoErrorInitAudioBackend;
+        sipw->ready_flag = true;
+    }
+    pw_thread_loop_signal(sipw->main_loop, false);
+    soundio->on_events_signal(soundio);
+}
+
+static void destroy_pw(struct SoundIoPrivate *si) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    if (sipw->main_loop)
+        pw_thread_loop_stop(sipw->main_loop);
+
+    if (sipw->metadata) {
+        spa_hook_remove(&sipw->metadata_listener);
+        pw_proxy_destroy((struct pw_proxy *)sipw->metadata);
+    }
+    if (sipw->registry) {
+        spa_hook_remove(&sipw->registry_listener);
+        pw_proxy_destroy((struct pw_proxy *)sipw->registry);
+    }
+    if (sipw->core) {
+        spa_hook_remove(&sipw->core_listener);
+        pw_core_disconnect(sipw->core);
+    }
+    if (sipw->context)
+        pw_context_destroy(sipw->context);
+    if (sipw->main_loop)
+        pw_thread_loop_destroy(sipw->main_loop);
+
+    for (int i = 0; i < sipw->nodes.length; i += 1)
+        free_node(SoundIoListPipeWireNode_ptr_at(&sipw->nodes, i));
+    SoundIoListPipeWireNode_deinit(&sipw->nodes);
+    soundio_destroy_devices_info(sipw->ready_devices_info);
+    free(sipw->default_sink_name);
+    free(sipw->default_source_name);
+
+    pw_deinit();
+}
+
+static int create_device(struct SoundIoPrivate *si, const struct SoundIoPipeWireNode *node,
+        enum SoundIoDeviceAim aim, struct SoundIoDevice **out_device)
+{
+    struct SoundIo *soundio = &si->pub;
+
+    struct SoundIoDevicePrivate *dev = ALLOCATE(struct SoundIoDevicePrivate, 1);
+    if (!dev)
+        return SoundIoErrorNoMem;
+    struct SoundIoDevice *device = &dev->pub;
+
+    device->ref_count = 1;
+    device->soundio = soundio;
+    device->aim = aim;
+    dev->backend_data.pipewire.node_id = node->id;
+    device->id = strdup(node->name);
+    device->name = strdup(node->description);
+    if (!device->id || !device->name) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+
+    device->sample_rate_current = node->sample_rate ? node->sample_rate : default_sample_rate;
+    device->sample_rate_count = 1;
+    device->sample_rates = &dev->prealloc_sample_rate_range;
+    device->sample_rates[0].min = soundio_int_min(SOUNDIO_MIN_SAMPLE_RATE, device->sample_rate_current);
+    device->sample_rates[0].max = soundio_int_max(SOUNDIO_MAX_SAMPLE_RATE, device->sample_rate_current);
+
+    device->format_count = ARRAY_LENGTH(format_mappings);
+    device->formats = ALLOCATE(enum SoundIoFormat, device->format_count);
+    device->layout_count = soundio_channel_layout_builtin_count();
+    device->layouts = ALLOCATE(struct SoundIoChannelLayout, device->layout_count);
+    if (!device->formats || !device->layouts) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
+    }
+    for (int i = 0; i < device->format_count; i += 1)
+        device->formats[i] = format_mappings[i].format;
+    for (int i = 0; i < device->layout_count; i += 1)
+        device->layouts[i] = *soundio_channel_layout_get_builtin(i);
+    // the graph itself runs on 32 bit floats
+    device->current_format = SoundIoFormatFloat32NE;
+    device->current_layout = (node->layout.channel_count > 0) ?
+        node->layout : *soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
+
+    device->software_latency_min = software_latency_min;
+    device->software_latency_max = software_latency_max;
+    device->software_latency_current = default_software_latency;
+
+    *out_device = device;
+    return 0;
+}
+
+static int find_default_index(struct SoundIoListDevicePtr *list, const char *default_name) {
+    if (list->length == 0)
+        return -1;
+    for (int i = 0; default_name && i < list->length; i += 1) {
+        if (strcmp(SoundIoListDevicePtr_val_at(list, i)->id, default_name) == 0)
+            return i;
+    }
+    return 0;
+}
+
+// Makes devices from the nodes and hands them to flush_events.
+// call this while holding the main loop lock
+static int refresh_devices(struct SoundIoPrivate *si) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    int err;
+
+    struct SoundIoDevicesInfo *devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!devices_info)
+        return SoundIoErrorNoMem;
+
+    for (int i = 0; i < sipw->nodes.length; i += 1) {
+        struct SoundIoPipeWireNode *node = SoundIoListPipeWireNode_ptr_at(&sipw->nodes, i);
+        for (int j = 0; j < 2; j += 1) {
+            enum SoundIoDeviceAim aim = (j == 0) ? SoundIoDeviceAimOutput : SoundIoDeviceAimInput;
+            if ((aim == SoundIoDeviceAimOutput) ? !node->is_sink : !node->is_source)
+                continue;
+            struct SoundIoDevice *device;
+            if ((err = create_device(si, node, aim, &device))) {
+                soundio_destroy_devices_info(devices_info);
+                return err;
+            }
+            struct SoundIoListDevicePtr *list = (aim == SoundIoDeviceAimOutput) ?
+                &devices_info->output_devices : &devices_info->input_devices;
+            if (SoundIoListDevicePtr_append(list, device)) {
+                soundio_device_unref(device);
+                soundio_destroy_devices_info(devices_info);
+                return SoundIoErrorNoMem;
+            }
+        }
+    }
+    devices_info->default_output_index = find_default_index(&devices_info->output_devices,
+            sipw->default_sink_name);
+    devices_info->default_input_index = find_default_index(&devices_info->input_devices,
+            sipw->default_source_name);
+
+    soundio_destroy_devices_info(sipw->ready_devices_info);
+    sipw->ready_devices_info = devices_info;
+    return 0;
+}
+
+static void my_flush_events(struct SoundIoPrivate *si, bool wait) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    bool change = false;
+    bool cb_shutdown = false;
+    struct SoundIoDevicesInfo *old_devices_info = NULL;
+
+    pw_thread_loop_lock(sipw->main_loop);
+
+    if (wait)
+        pw_thread_loop_wait(sipw->main_loop);
+
+    if (!sipw->connection_err && sipw->device_scan_queued) {
+        sipw->device_scan_queued = false;
+        sipw->connection_err = refresh_devices(si);
+    }
+
+    if (sipw->connection_err && !sipw->emitted_shutdown_cb) {
+        sipw->emitted_shutdown_cb = true;
+        cb_shutdown = true;
+    } else if (sipw->ready_devices_info) {
+        old_devices_info = si->safe_devices_info;
+        si->safe_devices_info = sipw->ready_devices_info;
+        sipw->ready_devices_info = NULL;
+        change = true;
+    }
+
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    if (cb_shutdown)
+        soundio->on_backend_disconnect(soundio, sipw->connection_err);
+    else if (change)
+        soundio->on_devices_change(soundio);
+
+    soundio_destroy_devices_info(old_devices_info);
+}
+
+static void flush_events_pw(struct SoundIoPrivate *si) {
+    my_flush_events(si, false);
+}
+
+static void wait_events_pw(struct SoundIoPrivate *si) {
+    my_flush_events(si, false);
+    my_flush_events(si, true);
+}
+
+static void wakeup_pw(struct SoundIoPrivate *si) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    pw_thread_loop_lock(sipw->main_loop);
+    pw_thread_loop_signal(sipw->main_loop, false);
+    pw_thread_loop_unlock(sipw->main_loop);
+}
+
+static void force_device_scan_pw(struct SoundIoPrivate *si) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    pw_thread_loop_lock(sipw->main_loop);
+    queue_device_scan(si);
+    pw_thread_loop_unlock(sipw->main_loop);
+}
+
+// Creates and connects a stream for the device, inactive until it is started.
+// call this while holding the main loop lock
+static int connect_stream(struct SoundIoPrivate *si, struct SoundIoDevice *device, const char *stream_name,
+        enum SoundIoFormat format, const struct SoundIoChannelLayout *layout, int sample_rate,
+        double software_latency, const struct pw_stream_events *events, struct spa_hook *listener,
+        void *data, struct pw_stream **out_stream)
+{
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    bool is_output = (device->aim == SoundIoDeviceAimOutput);
+
+    struct spa_audio_info_raw info;
+    memset(&info, 0, sizeof(struct spa_audio_info_raw));
+    info.format = to_spa_format(format);
+    info.rate = sample_rate;
+    info.channels = layout->channel_count;
+    for (int i = 0; i < layout->channel_count; i += 1)
+        info.position[i] = to_spa_channel(layout->channels[i]);
+    if (info.format == SPA_AUDIO_FORMAT_UNKNOWN)
+        return SoundIoErrorIncompatibleDevice;
+
+    struct pw_properties *props = pw_properties_new(
+            PW_KEY_MEDIA_TYPE, "Audio",
+            PW_KEY_MEDIA_CATEGORY, is_output ? "Playback" : "Capture",
+            PW_KEY_TARGET_OBJECT, device->id,
+            NULL);
+    if (!props)
+        return SoundIoErrorNoMem;
+    // asks the graph for a quantum of this size
+    int latency_frames = soundio_int_max(1, software_latency * sample_rate);
+    pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%d/%d", latency_frames, sample_rate);
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
+    pw_properties_setf(props, SOUNDIO_PW_KEY_NODE_TARGET, "%u", dev->backend_data.pipewire.node_id);
+
+    // takes ownership of props
+    struct pw_stream *stream = pw_stream_new(sipw->core, stream_name, props);
+    if (!stream)
+        return SoundIoErrorNoMem;
+    pw_stream_add_listener(stream, listener, events, data);
+
+    uint8_t buffer[1024];
+    struct spa_pod_builder builder;
+    spa_pod_builder_init(&builder, buffer, sizeof(buffer));
+    const struct spa_pod *params[1];
+    params[0] = spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info);
+
+    // the process callbacks run on the realtime data thread of PipeWire
+    enum pw_stream_flags flags = (enum pw_stream_flags)(PW_STREAM_FLAG_AUTOCONNECT |
+            PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS | PW_STREAM_FLAG_INACTIVE);
+    if (pw_stream_connect(stream, is_output ? PW_DIRECTION_OUTPUT : PW_DIRECTION_INPUT,
+                PW_ID_ANY, flags, params, 1) < 0)
+    {
+        pw_stream_destroy(stream);
+        return SoundIoErrorOpeningDevice;
+    }
+
+    *out_stream = stream;
+    return 0;
+}
+
+static double stream_latency(struct pw_stream *stream, int sample_rate) {
+    struct pw_time time;
+    memset(&time, 0, sizeof(struct pw_time));
+    if (pw_stream_get_time_n(stream, &time, sizeof(struct pw_time)) < 0 || time.rate.denom == 0)
+        return 0.0;
+    return time.delay * (double)time.rate.num / (double)time.rate.denom +
+        time.buffered / (double)sample_rate;
+}
+
+static void outstream_state_changed(void *data, enum pw_stream_state old, enum pw_stream_state state,
+        const char *error)
+{
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)data;
+    struct SoundIoOutStream *outstream = &os->pub;
+    if (state == PW_STREAM_STATE_ERROR)
+        outstream->error_callback(outstream, SoundIoErrorStreaming);
+}
+
+static void outstream_process(void *data) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)data;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+
+    struct pw_buffer *b = pw_stream_dequeue_buffer(ospw->stream);
+    if (!b)
+        return;
+    struct spa_data *d = &b->buffer->datas[0];
+    if (!d->data) {
+        pw_stream_queue_buffer(ospw->stream, b);
+        return;
+    }
+
+    // one quantum, like a JACK period
+    int frame_count = d->maxsize / outstream->bytes_per_frame;
+    if (b->requested > 0 && b->requested < (uint64_t)frame_count)
+        frame_count = b->requested;
+
+    ospw->write_ptr = (char *)d->data;
+    ospw->frames_left = frame_count;
+    ospw->frames_written = 0;
+    if (frame_count > 0)
+        outstream->write_callback(outstream, frame_count, frame_count);
+
+    d->chunk->offset = 0;
+    d->chunk->stride = outstream->bytes_per_frame;
+    d->chunk->size = ospw->frames_written * outstream->bytes_per_frame;
+    pw_stream_queue_buffer(ospw->stream, b);
+}
+
+static void outstream_destroy_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+
+    if (ospw->stream) {
+        pw_thread_loop_lock(sipw->main_loop);
+        pw_stream_destroy(ospw->stream);
+        ospw->stream = NULL;
+        pw_thread_loop_unlock(sipw->main_loop);
+    }
+}
+
+static int outstream_open_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoDevice *device = outstream->device;
+
+    if (!outstream->name)
+        outstream->name = "SoundIoOutStream";
+
+    if (outstream->software_latency == 0.0)
+        outstream->software_latency = device->software_latency_current;
+    outstream->software_latency = soundio_double_clamp(device->software_latency_min,
+            outstream->software_latency, device->software_latency_max);
+
+    memset(&ospw->stream_events, 0, sizeof(struct pw_stream_events));
+    ospw->stream_events.version = PW_VERSION_STREAM_EVENTS;
+    ospw->stream_events.state_changed = outstream_state_changed;
+    ospw->stream_events.process = outstream_process;
+
+    pw_thread_loop_lock(sipw->main_loop);
+    int err = connect_stream(si, device, outstream->name, outstream->format, &outstream->layout,
+            outstream->sample_rate, outstream->software_latency, &ospw->stream_events,
+            &ospw->stream_listener, os, &ospw->stream);
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    return err;
+}
+
+static int outstream_pause_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, bool pause) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+
+    pw_thread_loop_lock(sipw->main_loop);
+    int err = pw_stream_set_active(ospw->stream, !pause);
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    return (err < 0) ? SoundIoErrorStreaming : 0;
+}
+
+static int outstream_start_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    return outstream_pause_pw(si, os, false);
+}
+
+static int outstream_begin_write_pw(struct SoundIoPrivate *si,
+        struct SoundIoOutStreamPrivate *os, struct SoundIoChannelArea **out_areas, int *frame_count)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+
+    if (*frame_count > ospw->frames_left)
+        return SoundIoErrorInvalid;
+
+    char *write_ptr = ospw->write_ptr + ospw->frames_written * outstream->bytes_per_frame;
+    for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+        ospw->areas[ch].ptr = write_ptr + outstream->bytes_per_sample * ch;
+        ospw->areas[ch].step = outstream->bytes_per_frame;
+    }
+
+    ospw->write_frame_count = *frame_count;
+    *out_areas = ospw->areas;
+    return 0;
+}
+
+static int outstream_end_write_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+    ospw->frames_written += ospw->write_frame_count;
+    ospw->frames_left -= ospw->write_frame_count;
+    return 0;
+}
+
+static int outstream_clear_buffer_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+
+    pw_thread_loop_lock(sipw->main_loop);
+    int err = pw_stream_flush(ospw->stream, false);
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    return (err < 0) ? SoundIoErrorStreaming : 0;
+}
+
+static int outstream_get_latency_pw(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os,
+        double *out_latency)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPipeWire *ospw = &os->backend_data.pipewire;
+    *out_latency = stream_latency(ospw->stream, outstream->sample_rate);
+    return 0;
+}
+
+static void instream_state_changed(void *data, enum pw_stream_state old, enum pw_stream_state state,
+        const char *error)
+{
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)data;
+    struct SoundIoInStream *instream = &is->pub;
+    if (state == PW_STREAM_STATE_ERROR)
+        instream->error_callback(instream, SoundIoErrorStreaming);
+}
+
+static void instream_process(void *data) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)data;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+
+    struct pw_buffer *b = pw_stream_dequeue_buffer(ispw->stream);
+    if (!b)
+        return;
+    struct spa_data *d = &b->buffer->datas[0];
+    uint32_t offset = soundio_int_min(d->chunk->offset, d->maxsize);
+    uint32_t size = soundio_int_min(d->chunk->size, d->maxsize - offset);
+
+    ispw->read_ptr = d->data ? (char *)d->data + offset : NULL;
+    ispw->frames_left = size / instream->bytes_per_frame;
+    if (ispw->frames_left > 0)
+        instream->read_callback(instream, ispw->frames_left, ispw->frames_left);
+
+    pw_stream_queue_buffer(ispw->stream, b);
+}
+
+static void instream_destroy_pw(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+
+    if (ispw->stream) {
+        pw_thread_loop_lock(sipw->main_loop);
+        pw_stream_destroy(ispw->stream);
+        ispw->stream = NULL;
+        pw_thread_loop_unlock(sipw->main_loop);
+    }
+}
+
+static int instream_open_pw(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoDevice *device = instream->device;
+
+    if (!instream->name)
+        instream->name = "SoundIoInStream";
+
+    if (instream->software_latency == 0.0)
+        instream->software_latency = device->software_latency_current;
+    instream->software_latency = soundio_double_clamp(device->software_latency_min,
+            instream->software_latency, device->software_latency_max);
+
+    memset(&ispw->stream_events, 0, sizeof(struct pw_stream_events));
+    ispw->stream_events.version = PW_VERSION_STREAM_EVENTS;
+    ispw->stream_events.state_changed = instream_state_changed;
+    ispw->stream_events.process = instream_process;
+
+    pw_thread_loop_lock(sipw->main_loop);
+    int err = connect_stream(si, device, instream->name, instream->format, &instream->layout,
+            instream->sample_rate, instream->software_latency, &ispw->stream_events,
+            &ispw->stream_listener, is, &ispw->stream);
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    return err;
+}
+
+static int instream_pause_pw(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is, bool pause) {
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+
+    pw_thread_loop_lock(sipw->main_loop);
+    int err = pw_stream_set_active(ispw->stream, !pause);
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    return (err < 0) ? SoundIoErrorStreaming : 0;
+}
+
+static int instream_start_pw(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    return instream_pause_pw(si, is, false);
+}
+
+static int instream_begin_read_pw(struct SoundIoPrivate *si,
+        struct SoundIoInStreamPrivate *is, struct SoundIoChannelArea **out_areas, int *frame_count)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+
+    if (*frame_count > ispw->frames_left)
+        return SoundIoErrorInvalid;
+
+    if (!ispw->read_ptr) {
+        // no data in this buffer
+        *out_areas = NULL;
+    } else {
+        for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
+            ispw->areas[ch].ptr = ispw->read_ptr + instream->bytes_per_sample * ch;
+            ispw->areas[ch].step = instream->bytes_per_frame;
+        }
+        *out_areas = ispw->areas;
+    }
+
+    ispw->read_frame_count = *frame_count;
+    return 0;
+}
+
+static int instream_end_read_pw(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+    if (ispw->read_ptr)
+        ispw->read_ptr += ispw->read_frame_count * instream->bytes_per_frame;
+    ispw->frames_left -= ispw->read_frame_count;
+    return 0;
+}
+
+static int instream_get_latency_pw(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is,
+        double *out_latency)
+{
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPipeWire *ispw = &is->backend_data.pipewire;
+    *out_latency = stream_latency(ispw->stream, instream->sample_rate);
+    return 0;
+}
+
+int soundio_pipewire_init(struct SoundIoPrivate *si) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoPipeWire *sipw = &si->backend_data.pipewire;
+
+    pw_init(NULL, NULL);
+
+    sipw->device_scan_queued = true;
+
+    memset(&sipw->core_events, 0, sizeof(struct pw_core_events));
+    sipw->core_events.version = PW_VERSION_CORE_EVENTS;
+    sipw->core_events.done = core_done;
+    sipw->core_events.error = core_error;
+
+    memset(&sipw->registry_events, 0, sizeof(struct pw_registry_events));
+    sipw->registry_events.version = PW_VERSION_REGISTRY_EVENTS;
+    sipw->registry_events.global = registry_global;
+    sipw->registry_events.global_remove = registry_global_remove;
+
+    memset(&sipw->metadata_events, 0, sizeof(struct pw_metadata_events));
+    sipw->metadata_events.version = PW_VERSION_METADATA_EVENTS;
+    sipw->metadata_events.property = metadata_property;
+
+    sipw->main_loop = pw_thread_loop_new("SoundIoPipeWire", NULL);
+    if (!sipw->main_loop) {
+        destroy_pw(si);
+        return SoundIoErrorNoMem;
+    }
+
+    sipw->context = pw_context_new(pw_thread_loop_get_loop(sipw->main_loop), NULL, 0);
+    if (!sipw->context) {
+        destroy_pw(si);
+        return SoundIoErrorNoMem;
+    }
+
+    if (pw_thread_loop_start(sipw->main_loop) < 0) {
+        destroy_pw(si);
+        return SoundIoErrorNoMem;
+    }
+
+    pw_thread_loop_lock(sipw->main_loop);
+
+    struct pw_properties *props = pw_properties_new(PW_KEY_APP_NAME, soundio->app_name, NULL);
+    // fails when no PipeWire daemon is running
+    sipw->core = props ? pw_context_connect(sipw->context, props, 0) : NULL;
+    if (!sipw->core) {
+        pw_thread_loop_unlock(sipw->main_loop);
+        destroy_pw(si);
+        return props ? SoundIoErrorInitAudioBackend : SoundIoErrorNoMem;
+    }
+    pw_core_add_listener(sipw->core, &sipw->core_listener, &sipw->core_events, si);
+
+    sipw->registry = pw_core_get_registry(sipw->core, PW_VERSION_REGISTRY, 0);
+    if (!sipw->registry) {
+        pw_thread_loop_unlock(sipw->main_loop);
+        destroy_pw(si);
+        return SoundIoErrorNoMem;
+    }
+    pw_registry_add_listener(sipw->registry, &sipw->registry_listener, &sipw->registry_events, si);
+
+    // block until the registry has announced what exists already
+    sipw->sync_seq = pw_core_sync(sipw->core, PW_ID_CORE, 0);
+    while (!sipw->ready_flag)
+        pw_thread_loop_wait(sipw->main_loop);
+
+    if (sipw->connection_err) {
+        int err = sipw->connection_err;
+        pw_thread_loop_unlock(sipw->main_loop);
+        destroy_pw(si);
+        return err;
+    }
+
+    pw_thread_loop_unlock(sipw->main_loop);
+
+    si->destroy = destroy_pw;
+    si->flush_events = flush_events_pw;
+    si->wait_events = wait_events_pw;
+    si->wakeup = wakeup_pw;
+    si->force_device_scan = force_device_scan_pw;
+
+    si->outstream_open = outstream_open_pw;
+    si->outstream_destroy = outstream_destroy_pw;
+    si->outstream_start = outstream_start_pw;
+    si->outstream_begin_write = outstream_begin_write_pw;
+    si->outstream_end_write = outstream_end_write_pw;
+    si->outstream_clear_buffer = outstream_clear_buffer_pw;
+    si->outstream_pause = outstream_pause_pw;
+    si->outstream_get_latency = outstream_get_latency_pw;
+
+    si->instream_open = instream_open_pw;
+    si->instream_destroy = instream_destroy_pw;
+    si->instream_start = instream_start_pw;
+    si->instream_begin_read = instream_begin_read_pw;
+    si->instream_end_read = instream_end_read_pw;
+    si->instream_pause = instream_pause_pw;
+    si->instream_get_latency = instream_get_latency_pw;
+
+    return 0;
+}
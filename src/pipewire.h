@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SOUNDIO_PIPEWIRE_H
+#define SOUNDIO_PIPEWIRE_H
+
+#include "soundio_internal.h"
+#include "os.h"
+#include "atomics.h"
+#include "list.h"
+
+#include <pipewire/pipewire.h>
+#include <pipewire/extensions/metadata.h>
+
+struct SoundIoPrivate;
+int soundio_pipewire_init(struct SoundIoPrivate *si);
+
+struct SoundIoDevicePipeWire {
+    uint32_t node_id;
+};
+
+// An audio node announced by the registry. Devices are made from these each
+// time the device list is published.
+struct SoundIoPipeWireNode {
+    uint32_t id;
+    char *name;
+    char *description;
+    bool is_sink;
+    bool is_source;
+    int sample_rate;
+    // channel_count is 0 when the node did not say
+    struct SoundIoChannelLayout layout;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoPipeWireNode, SoundIoListPipeWireNode, SOUNDIO_LIST_STATIC)
+
+struct SoundIoPipeWire {
+    struct pw_thread_loop *main_loop;
+    struct pw_context *context;
+    struct pw_core *core;
+    struct pw_registry *registry;
+    // the "default" metadata, which names the default sink and source
+    struct pw_metadata *metadata;
+    uint32_t metadata_id;
+
+    struct pw_core_events core_events;
+    struct pw_registry_events registry_events;
+    struct pw_metadata_events metadata_events;
+    struct spa_hook core_listener;
+    struct spa_hook registry_listener;
+    struct spa_hook metadata_listener;
+
+    // the rest is protected by the main loop lock
+    int sync_seq;
+    bool ready_flag;
+    int connection_err;
+    bool emitted_shutdown_cb;
+    bool device_scan_queued;
+    struct SoundIoListPipeWireNode nodes;
+    char *default_sink_name;
+    char *default_source_name;
+    // this one is ready to be read with flush_events
+    struct SoundIoDevicesInfo *ready_devices_info;
+};
+
+struct SoundIoOutStreamPipeWire {
+    struct pw_stream *stream;
+    struct pw_stream_events stream_events;
+    struct spa_hook stream_listener;
+    // the buffer being filled by the write callback
+    char *write_ptr;
+    int frames_left;
+    int frames_written;
+    int write_frame_count;
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+};
+
+struct SoundIoInStreamPipeWire {
+    struct pw_stream *stream;
+    struct pw_stream_events stream_events;
+    struct spa_hook stream_listener;
+    // NULL while the read callback is given a hole
+    char *read_ptr;
+    int frames_left;
+    int read_frame_count;
+    struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+};
+
+#endif
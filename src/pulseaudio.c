@@ -11,6 +11,7 @@
 #include <string.h>
 #include <stdio.h>
 
+SOUNDIO_MAKE_LIST_DEF(struct SoundIoPulseAudioEvent, SoundIoListPulseAudioEvent, SOUNDIO_LIST_STATIC)
 
 static void subscribe_callback(pa_context *context,
         pa_subscription_event_type_t event_bits, uint32_t index, void *userdata)
@@ -18,7 +19,18 @@ static void subscribe_callback(pa_context *context,
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)userdata;
     struct SoundIo *soundio = &si->pub;
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
-    sipa->device_scan_queued = true;
+    // The event is only recorded here; my_flush_events queries the one
+    // device it names instead of rescanning everything.
+    if (!sipa->device_scan_queued) {
+        if (SoundIoListPulseAudioEvent_add_one(&sipa->pending_events)) {
+            sipa->device_scan_queued = true;
+        } else {
+            struct SoundIoPulseAudioEvent *event =
+                SoundIoListPulseAudioEvent_last_ptr(&sipa->pending_events);
+            event->type = event_bits;
+            event->index = index;
+        }
+    }
     pa_threaded_mainloop_signal(sipa->main_loop, 0);
     soundio->on_events_signal(soundio);
 }
@@ -78,7 +90,9 @@ static void destroy_pa(struct SoundIoPrivate *si) {
     pa_context_unref(sipa->pulse_context);
 
     soundio_destroy_devices_info(sipa->current_devices_info);
+    soundio_destroy_devices_info(sipa->devices_info);
     soundio_destroy_devices_info(sipa->ready_devices_info);
+    SoundIoListPulseAudioEvent_deinit(&sipa->pending_events);
 
     if (sipa->main_loop)
         pa_threaded_mainloop_free(sipa->main_loop);
@@ -273,6 +287,7 @@ static void sink_info_callback(pa_context *pulse_context, const pa_sink_info *in
     }
 
     device->aim = SoundIoDeviceAimOutput;
+    dev->backend_data.pulseaudio.index = info->index;
 
     if (SoundIoListDevicePtr_append(&sipa->current_devices_info->output_devices, device)) {
         soundio_device_unref(device);
@@ -337,6 +352,7 @@ static void source_info_callback(pa_context *pulse_context, const pa_source_info
     }
 
     device->aim = SoundIoDeviceAimInput;
+    dev->backend_data.pulseaudio.index = info->index;
 
     if (SoundIoListDevicePtr_append(&sipa->current_devices_info->input_devices, device)) {
         soundio_device_unref(device);
@@ -350,8 +366,8 @@ static void server_info_callback(pa_context *pulse_context, const pa_server_info
     assert(si);
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
 
-    assert(!sipa->default_sink_name);
-    assert(!sipa->default_source_name);
+    free(sipa->default_sink_name);
+    free(sipa->default_source_name);
 
     sipa->default_sink_name = strdup(info->default_sink_name);
     sipa->default_source_name = strdup(info->default_source_name);
@@ -368,19 +384,88 @@ static void cleanup_refresh_devices(struct SoundIoPrivate *si) {
 
     soundio_destroy_devices_info(sipa->current_devices_info);
     sipa->current_devices_info = NULL;
+}
 
-    free(sipa->default_sink_name);
-    sipa->default_sink_name = NULL;
+// based on the default sink name, figure out the default output index
+// if the name doesn't match just pick the first one. if there are no
+// devices then we need to set it to -1.
+static void set_default_device_indexes(struct SoundIoPulseAudio *sipa, struct SoundIoDevicesInfo *devices_info) {
+    devices_info->default_output_index = -1;
+    devices_info->default_input_index = -1;
 
-    free(sipa->default_source_name);
-    sipa->default_source_name = NULL;
+    if (devices_info->input_devices.length > 0) {
+        devices_info->default_input_index = 0;
+        for (int i = 0; i < devices_info->input_devices.length; i += 1) {
+            struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(&devices_info->input_devices, i);
+
+            assert(device->aim == SoundIoDeviceAimInput);
+            if (sipa->default_source_name && strcmp(device->id, sipa->default_source_name) == 0) {
+                devices_info->default_input_index = i;
+            }
+        }
+    }
+
+    if (devices_info->output_devices.length > 0) {
+        devices_info->default_output_index = 0;
+        for (int i = 0; i < devices_info->output_devices.length; i += 1) {
+            struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(&devices_info->output_devices, i);
+
+            assert(device->aim == SoundIoDeviceAimOutput);
+            if (sipa->default_sink_name && strcmp(device->id, sipa->default_sink_name) == 0) {
+                devices_info->default_output_index = i;
+            }
+        }
+    }
 }
 
+static int copy_device_list(struct SoundIoListDevicePtr *dest, struct SoundIoListDevicePtr *src) {
+    int err;
+    if ((err = SoundIoListDevicePtr_ensure_capacity(dest, src->length)))
+        return err;
+    for (int i = 0; i < src->length; i += 1) {
+        struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(src, i);
+        soundio_device_ref(device);
+        if ((err = SoundIoListDevicePtr_append(dest, device))) {
+            soundio_device_unref(device);
+            return err;
+        }
+    }
+    return 0;
+}
+
+// Hands a snapshot of devices_info to flush_events. The devices themselves
+// are shared by reference, so only the lists are copied.
 // call this while holding the main loop lock
-static int refresh_devices(struct SoundIoPrivate *si) {
+static int publish_devices(struct SoundIoPrivate *si) {
     struct SoundIo *soundio = &si->pub;
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
 
+    struct SoundIoDevicesInfo *devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!devices_info)
+        return SoundIoErrorNoMem;
+
+    int err;
+    if ((err = copy_device_list(&devices_info->input_devices, &sipa->devices_info->input_devices)) ||
+        (err = copy_device_list(&devices_info->output_devices, &sipa->devices_info->output_devices)))
+    {
+        soundio_destroy_devices_info(devices_info);
+        return err;
+    }
+    devices_info->default_input_index = sipa->devices_info->default_input_index;
+    devices_info->default_output_index = sipa->devices_info->default_output_index;
+
+    soundio_destroy_devices_info(sipa->ready_devices_info);
+    sipa->ready_devices_info = devices_info;
+    pa_threaded_mainloop_signal(sipa->main_loop, 0);
+    soundio->on_events_signal(soundio);
+
+    return 0;
+}
+
+// call this while holding the main loop lock
+static int refresh_devices(struct SoundIoPrivate *si) {
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
+
     assert(!sipa->current_devices_info);
     sipa->current_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
     if (!sipa->current_devices_info)
@@ -405,45 +490,161 @@ static int refresh_devices(struct SoundIoPrivate *si) {
         return sipa->device_query_err;
     }
 
-    // based on the default sink name, figure out the default output index
-    // if the name doesn't match just pick the first one. if there are no
-    // devices then we need to set it to -1.
-    sipa->current_devices_info->default_output_index = -1;
-    sipa->current_devices_info->default_input_index = -1;
+    set_default_device_indexes(sipa, sipa->current_devices_info);
 
-    if (sipa->current_devices_info->input_devices.length > 0) {
-        sipa->current_devices_info->default_input_index = 0;
-        for (int i = 0; i < sipa->current_devices_info->input_devices.length; i += 1) {
-            struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(
-                    &sipa->current_devices_info->input_devices, i);
+    soundio_destroy_devices_info(sipa->devices_info);
+    sipa->devices_info = sipa->current_devices_info;
+    sipa->current_devices_info = NULL;
 
-            assert(device->aim == SoundIoDeviceAimInput);
-            if (strcmp(device->id, sipa->default_source_name) == 0) {
-                sipa->current_devices_info->default_input_index = i;
-            }
+    return publish_devices(si);
+}
+
+// Queries a single sink or source by index. *out_device is set to NULL if
+// it no longer exists.
+// call this while holding the main loop lock
+static int query_device(struct SoundIoPrivate *si, enum SoundIoDeviceAim aim, uint32_t index,
+        struct SoundIoDevice **out_device)
+{
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
+
+    assert(!sipa->current_devices_info);
+    sipa->current_devices_info = ALLOCATE(struct SoundIoDevicesInfo, 1);
+    if (!sipa->current_devices_info)
+        return SoundIoErrorNoMem;
+
+    pa_operation *op = (aim == SoundIoDeviceAimOutput) ?
+        pa_context_get_sink_info_by_index(sipa->pulse_context, index, sink_info_callback, si) :
+        pa_context_get_source_info_by_index(sipa->pulse_context, index, source_info_callback, si);
+
+    int err;
+    if ((err = perform_operation(si, op)))
+        return err;
+
+    if (sipa->device_query_err)
+        return sipa->device_query_err;
+
+    struct SoundIoListDevicePtr *list = (aim == SoundIoDeviceAimOutput) ?
+        &sipa->current_devices_info->output_devices : &sipa->current_devices_info->input_devices;
+    *out_device = (list->length > 0) ? SoundIoListDevicePtr_pop(list) : NULL;
+    return 0;
+}
+
+// Only the properties libsoundio reports are compared, so that volume, mute
+// and port changes, which PulseAudio also announces as a change event, do
+// not emit on_devices_change.
+static bool devices_equal(const struct SoundIoDevice *a, const struct SoundIoDevice *b) {
+    return strcmp(a->id, b->id) == 0 &&
+        strcmp(a->name, b->name) == 0 &&
+        a->sample_rate_current == b->sample_rate_current &&
+        a->current_format == b->current_format &&
+        soundio_channel_layout_equal(&a->current_layout, &b->current_layout);
+}
+
+static int find_device_by_index(struct SoundIoListDevicePtr *list, uint32_t index) {
+    for (int i = 0; i < list->length; i += 1) {
+        struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)SoundIoListDevicePtr_val_at(list, i);
+        if (dev->backend_data.pulseaudio.index == index)
+            return i;
+    }
+    return -1;
+}
+
+// unlike swap_remove this keeps the order PulseAudio listed the devices in
+static void remove_device_at(struct SoundIoListDevicePtr *list, int index) {
+    soundio_device_unref(SoundIoListDevicePtr_val_at(list, index));
+    for (int i = index; i < list->length - 1; i += 1)
+        list->items[i] = list->items[i + 1];
+    SoundIoListDevicePtr_pop(list);
+}
+
+// call this while holding the main loop lock
+static int apply_device_event(struct SoundIoPrivate *si, enum SoundIoDeviceAim aim,
+        const struct SoundIoPulseAudioEvent *event, bool *changed)
+{
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
+    struct SoundIoListDevicePtr *list = (aim == SoundIoDeviceAimOutput) ?
+        &sipa->devices_info->output_devices : &sipa->devices_info->input_devices;
+    int i = find_device_by_index(list, event->index);
+
+    struct SoundIoDevice *device = NULL;
+    if ((event->type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_REMOVE) {
+        int err = query_device(si, aim, event->index, &device);
+        cleanup_refresh_devices(si);
+        if (err)
+            return err;
+    }
+
+    if (!device) {
+        if (i >= 0) {
+            remove_device_at(list, i);
+            *changed = true;
+        }
+        return 0;
+    }
+
+    if (i >= 0) {
+        struct SoundIoDevice *old_device = SoundIoListDevicePtr_val_at(list, i);
+        if (devices_equal(old_device, device)) {
+            soundio_device_unref(device);
+            return 0;
         }
+        soundio_device_unref(old_device);
+        list->items[i] = device;
+    } else if (SoundIoListDevicePtr_append(list, device)) {
+        soundio_device_unref(device);
+        return SoundIoErrorNoMem;
     }
+    *changed = true;
+    return 0;
+}
 
-    if (sipa->current_devices_info->output_devices.length > 0) {
-        sipa->current_devices_info->default_output_index = 0;
-        for (int i = 0; i < sipa->current_devices_info->output_devices.length; i += 1) {
-            struct SoundIoDevice *device = SoundIoListDevicePtr_val_at(
-                    &sipa->current_devices_info->output_devices, i);
+// Applies the pending subscription events to devices_info and publishes the
+// result only if something libsoundio reports actually changed.
+// call this while holding the main loop lock
+static int update_devices(struct SoundIoPrivate *si) {
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
 
-            assert(device->aim == SoundIoDeviceAimOutput);
-            if (strcmp(device->id, sipa->default_sink_name) == 0) {
-                sipa->current_devices_info->default_output_index = i;
-            }
+    // Take ownership of the queue; events that arrive while we wait on the
+    // queries below are handled by the next flush.
+    struct SoundIoListPulseAudioEvent events = sipa->pending_events;
+    memset(&sipa->pending_events, 0, sizeof(struct SoundIoListPulseAudioEvent));
+
+    bool changed = false;
+    int err = 0;
+    for (int i = 0; i < events.length && !err; i += 1) {
+        struct SoundIoPulseAudioEvent *event = SoundIoListPulseAudioEvent_ptr_at(&events, i);
+        switch (event->type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+        case PA_SUBSCRIPTION_EVENT_SINK:
+            err = apply_device_event(si, SoundIoDeviceAimOutput, event, &changed);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SOURCE:
+            err = apply_device_event(si, SoundIoDeviceAimInput, event, &changed);
+            break;
+        case PA_SUBSCRIPTION_EVENT_SERVER:
+            // the default sink or source may have changed
+            err = perform_operation(si,
+                    pa_context_get_server_info(sipa->pulse_context, server_info_callback, si));
+            if (!err)
+                err = sipa->device_query_err;
+            break;
+        default:
+            break;
         }
     }
+    SoundIoListPulseAudioEvent_deinit(&events);
+    if (err)
+        return err;
 
-    soundio_destroy_devices_info(sipa->ready_devices_info);
-    sipa->ready_devices_info = sipa->current_devices_info;
-    sipa->current_devices_info = NULL;
-    pa_threaded_mainloop_signal(sipa->main_loop, 0);
-    soundio->on_events_signal(soundio);
+    int old_default_input_index = sipa->devices_info->default_input_index;
+    int old_default_output_index = sipa->devices_info->default_output_index;
+    set_default_device_indexes(sipa, sipa->devices_info);
+    if (sipa->devices_info->default_input_index != old_default_input_index ||
+        sipa->devices_info->default_output_index != old_default_output_index)
+    {
+        changed = true;
+    }
 
-    return 0;
+    return changed ? publish_devices(si) : 0;
 }
 
 static void my_flush_events(struct SoundIoPrivate *si, bool wait) {
@@ -459,10 +660,15 @@ static void my_flush_events(struct SoundIoPrivate *si, bool wait) {
     if (wait)
         pa_threaded_mainloop_wait(sipa->main_loop);
 
-    if (sipa->device_scan_queued && !sipa->connection_err) {
-        sipa->device_scan_queued = false;
-        sipa->connection_err = refresh_devices(si);
-        cleanup_refresh_devices(si);
+    if (!sipa->connection_err) {
+        if (sipa->device_scan_queued || !sipa->devices_info) {
+            sipa->device_scan_queued = false;
+            SoundIoListPulseAudioEvent_clear(&sipa->pending_events);
+            sipa->connection_err = refresh_devices(si);
+            cleanup_refresh_devices(si);
+        } else if (sipa->pending_events.length > 0) {
+            sipa->connection_err = update_devices(si);
+        }
     }
 
     if (sipa->connection_err && !sipa->emitted_shutdown_cb) {
@@ -627,9 +833,120 @@ static void playback_stream_write_callback(pa_stream *stream, size_t nbytes, voi
     outstream->write_callback(outstream, 0, frame_count);
 }
 
+// The dedicated thread versions of the callbacks above only wake the thread.
+static void playback_stream_thread_underflow_callback(pa_stream *stream, void *userdata) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate*)(userdata);
+    struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+    SOUNDIO_ATOMIC_FLAG_CLEAR(ospa->underflow_flag);
+    soundio_os_cond_signal(ospa->cond, NULL);
+}
+
+static void playback_stream_thread_write_callback(pa_stream *stream, size_t nbytes, void *userdata) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate*)(userdata);
+    struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+    soundio_os_cond_signal(ospa->cond, NULL);
+}
+
+// Passes as much of the ring buffer to the server as it will take.
+// Call this while holding the main loop lock.
+static int outstream_flush_ring_buffer_pa(struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+
+    size_t writable_size = pa_stream_writable_size(ospa->stream);
+    if (writable_size == (size_t)-1)
+        return SoundIoErrorStreaming;
+
+    // Frames queued before a clear_buffer request are dropped here, and the
+    // next write replaces whatever the server still holds.
+    if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->clear_buffer_flag)) {
+        soundio_ring_buffer_clear(&ospa->ring_buffer);
+        ospa->seek_on_read = true;
+    }
+
+    size_t byte_count = soundio_ring_buffer_fill_count(&ospa->ring_buffer);
+    if (byte_count > writable_size)
+        byte_count = writable_size - writable_size % outstream->bytes_per_frame;
+    if (byte_count == 0)
+        return 0;
+
+    pa_seek_mode_t seek_mode = ospa->seek_on_read ? PA_SEEK_RELATIVE_ON_READ : PA_SEEK_RELATIVE;
+    ospa->seek_on_read = false;
+    char *read_ptr = soundio_ring_buffer_read_ptr(&ospa->ring_buffer);
+    if (pa_stream_write(ospa->stream, read_ptr, byte_count, NULL, 0, seek_mode))
+        return SoundIoErrorStreaming;
+    soundio_ring_buffer_advance_read_ptr(&ospa->ring_buffer, byte_count);
+    return 0;
+}
+
+// Returns how many frames the server will take beyond what is already in the
+// ring buffer, after passing the ring buffer on.
+static int outstream_sync_ring_buffer_pa(struct SoundIoPrivate *si,
+        struct SoundIoOutStreamPrivate *os, int *out_frame_count)
+{
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
+    struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+
+    pa_threaded_mainloop_lock(sipa->main_loop);
+    int err = outstream_flush_ring_buffer_pa(os);
+    size_t writable_size = pa_stream_writable_size(ospa->stream);
+    pa_threaded_mainloop_unlock(sipa->main_loop);
+    if (err)
+        return err;
+    if (writable_size == (size_t)-1)
+        return SoundIoErrorStreaming;
+
+    size_t fill_bytes = soundio_ring_buffer_fill_count(&ospa->ring_buffer);
+    size_t free_bytes = soundio_ring_buffer_capacity(&ospa->ring_buffer) - fill_bytes;
+    size_t byte_count = (writable_size > fill_bytes) ? writable_size - fill_bytes : 0;
+    if (byte_count > free_bytes)
+        byte_count = free_bytes;
+    *out_frame_count = byte_count / outstream->bytes_per_frame;
+    return 0;
+}
+
+static void playback_thread_run(void *arg) {
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)arg;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)outstream->device->soundio;
+
+    int err;
+    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->abort_flag)) {
+        int frame_count;
+        if ((err = outstream_sync_ring_buffer_pa(si, os, &frame_count))) {
+            outstream->error_callback(outstream, err);
+            return;
+        }
+
+        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->underflow_flag))
+            outstream->underflow_callback(outstream);
+
+        if (frame_count > 0) {
+            ospa->frames_left = frame_count;
+            outstream->write_callback(outstream, 0, frame_count);
+            // go straight back to passing it on, unless nothing was written
+            if (ospa->frames_left != frame_count)
+                continue;
+        }
+
+        // The server's requests wake us up; the timeout only covers a
+        // request that arrives between the check above and this wait.
+        soundio_os_cond_timed_wait(ospa->cond, NULL, ospa->period_duration);
+    }
+}
+
 static void outstream_destroy_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
     struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
 
+    if (ospa->thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(ospa->abort_flag);
+        soundio_os_cond_signal(ospa->cond, NULL);
+        soundio_os_thread_destroy(ospa->thread);
+        ospa->thread = NULL;
+    }
+
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
     pa_stream *stream = ospa->stream;
     if (stream) {
@@ -647,6 +964,13 @@ static void outstream_destroy_pa(struct SoundIoPrivate *si, struct SoundIoOutStr
 
         ospa->stream = NULL;
     }
+
+    if (ospa->cond) {
+        soundio_os_cond_destroy(ospa->cond);
+        ospa->cond = NULL;
+    }
+
+    soundio_ring_buffer_deinit(&ospa->ring_buffer);
 }
 
 static void timing_update_callback(pa_stream *stream, int success, void *userdata) {
@@ -667,6 +991,7 @@ static int outstream_open_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamP
 
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
     SOUNDIO_ATOMIC_STORE(ospa->stream_ready, false);
+    ospa->seek_on_read = false;
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->clear_buffer_flag);
 
     assert(sipa->pulse_context);
@@ -694,17 +1019,27 @@ static int outstream_open_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamP
     ospa->buffer_attr.minreq = UINT32_MAX;
     ospa->buffer_attr.fragsize = UINT32_MAX;
 
+    pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_START_CORKED | PA_STREAM_AUTO_TIMING_UPDATE |
+            PA_STREAM_INTERPOLATE_TIMING);
+
     int bytes_per_second = outstream->bytes_per_frame * outstream->sample_rate;
+    bool adjust_latency = outstream->adjust_latency && outstream->software_latency > 0.0;
     if (outstream->software_latency > 0.0) {
         int buffer_length = outstream->bytes_per_frame *
             ceil_dbl_to_int(outstream->software_latency * bytes_per_second / (double)outstream->bytes_per_frame);
 
         ospa->buffer_attr.maxlength = buffer_length;
         ospa->buffer_attr.tlength = buffer_length;
-    }
 
-    pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_START_CORKED | PA_STREAM_AUTO_TIMING_UPDATE |
-            PA_STREAM_INTERPOLATE_TIMING);
+        if (adjust_latency) {
+            // Ask for data a quarter of the latency at a time, and after an
+            // underflow wait for one such request before playing again.
+            int frames_per_request = soundio_int_max(1, buffer_length / outstream->bytes_per_frame / 4);
+            ospa->buffer_attr.minreq = frames_per_request * outstream->bytes_per_frame;
+            ospa->buffer_attr.prebuf = ospa->buffer_attr.minreq;
+            flags = (pa_stream_flags_t)(flags | PA_STREAM_ADJUST_LATENCY);
+        }
+    }
 
     int err = pa_stream_connect_playback(ospa->stream,
             outstream->device->id, &ospa->buffer_attr,
@@ -723,11 +1058,88 @@ static int outstream_open_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamP
         return err;
     }
 
-    size_t writable_size = pa_stream_writable_size(ospa->stream);
-    outstream->software_latency = ((double)writable_size) / (double)bytes_per_second;
+    if (adjust_latency) {
+        // The server shrinks tlength by however much latency it gave the sink.
+        const pa_buffer_attr *attr = pa_stream_get_buffer_attr(ospa->stream);
+        const pa_timing_info *timing_info = pa_stream_get_timing_info(ospa->stream);
+        if (attr)
+            ospa->buffer_attr = *attr;
+        pa_usec_t sink_usec = timing_info ? timing_info->configured_sink_usec : 0;
+        outstream->software_latency = ((double)ospa->buffer_attr.tlength) / (double)bytes_per_second +
+            sink_usec / 1000000.0;
+    } else {
+        size_t writable_size = pa_stream_writable_size(ospa->stream);
+        outstream->software_latency = ((double)writable_size) / (double)bytes_per_second;
+    }
+
+    size_t ring_buffer_size = pa_stream_writable_size(ospa->stream);
+
+    pa_threaded_mainloop_unlock(sipa->main_loop);
+
+    if (outstream->dedicated_thread) {
+        // The server's share of the latency caps how much the thread asks
+        // for, so the ring buffer only has to be able to hold that much.
+        if ((err = soundio_ring_buffer_init(&ospa->ring_buffer, ring_buffer_size))) {
+            outstream_destroy_pa(si, os);
+            return err;
+        }
+        ospa->cond = soundio_os_cond_create();
+        if (!ospa->cond) {
+            outstream_destroy_pa(si, os);
+            return SoundIoErrorNoMem;
+        }
+        ospa->period_duration = outstream->software_latency / 4.0;
+    }
+
+    return 0;
+}
+
+static int outstream_start_thread_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIo *soundio = &si->pub;
+    struct SoundIoOutStream *outstream = &os->pub;
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
+    struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+    int err;
+
+    // Fill the buffer from the calling thread before uncorking, as
+    // outstream_start_pa does.
+    int frame_count;
+    if ((err = outstream_sync_ring_buffer_pa(si, os, &frame_count)))
+        return err;
+    if (frame_count > 0) {
+        ospa->frames_left = frame_count;
+        outstream->write_callback(outstream, 0, frame_count);
+    }
+
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->abort_flag);
+    SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->underflow_flag);
+
+    pa_threaded_mainloop_lock(sipa->main_loop);
+
+    if ((err = outstream_flush_ring_buffer_pa(os))) {
+        pa_threaded_mainloop_unlock(sipa->main_loop);
+        return err;
+    }
+
+    pa_operation *op = pa_stream_cork(ospa->stream, false, NULL, NULL);
+    if (!op) {
+        pa_threaded_mainloop_unlock(sipa->main_loop);
+        return SoundIoErrorStreaming;
+    }
+    pa_operation_unref(op);
+    pa_stream_set_write_callback(ospa->stream, playback_stream_thread_write_callback, os);
+    pa_stream_set_underflow_callback(ospa->stream, playback_stream_thread_underflow_callback, os);
+    pa_stream_set_overflow_callback(ospa->stream, playback_stream_thread_underflow_callback, os);
 
     pa_threaded_mainloop_unlock(sipa->main_loop);
 
+    if ((err = soundio_os_thread_create(playback_thread_run, os,
+                    soundio->emit_rtprio_warning, &os->thread_policy,
+                    soundio_seconds_to_ns(ospa->period_duration), &ospa->thread)))
+    {
+        return err;
+    }
+
     return 0;
 }
 
@@ -736,6 +1148,9 @@ static int outstream_start_pa(struct SoundIoPrivate *si, struct SoundIoOutStream
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
     struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
 
+    if (outstream->dedicated_thread)
+        return outstream_start_thread_pa(si, os);
+
     pa_threaded_mainloop_lock(sipa->main_loop);
 
     ospa->write_byte_count = pa_stream_writable_size(ospa->stream);
@@ -764,6 +1179,21 @@ static int outstream_begin_write_pa(struct SoundIoPrivate *si,
     struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
     pa_stream *stream = ospa->stream;
 
+    if (outstream->dedicated_thread) {
+        if (*frame_count > ospa->frames_left)
+            return SoundIoErrorInvalid;
+
+        char *write_ptr = soundio_ring_buffer_write_ptr(&ospa->ring_buffer);
+        for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+            ospa->areas[ch].ptr = write_ptr + outstream->bytes_per_sample * ch;
+            ospa->areas[ch].step = outstream->bytes_per_frame;
+        }
+
+        ospa->write_frame_count = *frame_count;
+        *out_areas = ospa->areas;
+        return 0;
+    }
+
     ospa->write_byte_count = *frame_count * outstream->bytes_per_frame;
     if (pa_stream_begin_write(stream, (void**)&ospa->write_ptr, &ospa->write_byte_count))
         return SoundIoErrorStreaming;
@@ -780,9 +1210,17 @@ static int outstream_begin_write_pa(struct SoundIoPrivate *si,
 }
 
 static int outstream_end_write_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os) {
+    struct SoundIoOutStream *outstream = &os->pub;
     struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
     pa_stream *stream = ospa->stream;
 
+    if (outstream->dedicated_thread) {
+        int byte_count = ospa->write_frame_count * outstream->bytes_per_frame;
+        soundio_ring_buffer_advance_write_ptr(&ospa->ring_buffer, byte_count);
+        ospa->frames_left -= ospa->write_frame_count;
+        return 0;
+    }
+
     pa_seek_mode_t seek_mode = SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ospa->clear_buffer_flag) ? PA_SEEK_RELATIVE : PA_SEEK_RELATIVE_ON_READ;
     if (pa_stream_write(stream, ospa->write_ptr, ospa->write_byte_count, NULL, 0, seek_mode))
         return SoundIoErrorStreaming;
@@ -823,11 +1261,24 @@ static int outstream_pause_pa(struct SoundIoPrivate *si, struct SoundIoOutStream
 }
 
 static int outstream_get_latency_pa(struct SoundIoPrivate *si, struct SoundIoOutStreamPrivate *os, double *out_latency) {
+    struct SoundIoOutStream *outstream = &os->pub;
     struct SoundIoOutStreamPulseAudio *ospa = &os->backend_data.pulseaudio;
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
 
     int err;
     pa_usec_t r_usec;
     int negative;
+    if (outstream->dedicated_thread) {
+        pa_threaded_mainloop_lock(sipa->main_loop);
+        err = pa_stream_get_latency(ospa->stream, &r_usec, &negative);
+        pa_threaded_mainloop_unlock(sipa->main_loop);
+        if (err)
+            return SoundIoErrorStreaming;
+        // frames still waiting in the ring buffer are latency too
+        int fill_frames = soundio_ring_buffer_fill_count(&ospa->ring_buffer) / outstream->bytes_per_frame;
+        *out_latency = r_usec / 1000000.0 + fill_frames / (double)outstream->sample_rate;
+        return 0;
+    }
     if ((err = pa_stream_get_latency(ospa->stream, &r_usec, &negative))) {
         return SoundIoErrorStreaming;
     }
@@ -866,9 +1317,154 @@ static void recording_stream_read_callback(pa_stream *stream, size_t nbytes, voi
     instream->read_callback(instream, 0, available_frame_count);
 }
 
+// Copies peeked fragments into the staging buffer until it is full or the
+// server has nothing more for us, with holes filled with silence. A fragment
+// that does not fit is left in the stream; peek_buf_index remembers how much
+// of it was already copied.
+static int instream_fill_stage_pa(struct SoundIoInStream *instream, struct SoundIoInStreamPulseAudio *ispa) {
+    pa_stream *stream = ispa->stream;
+    while (ispa->stage_frame_count < instream->coalesce_frame_count) {
+        size_t readable_size = pa_stream_readable_size(stream);
+        if (readable_size == (size_t)-1)
+            return SoundIoErrorStreaming;
+        if (readable_size == 0)
+            return 0;
+
+        const char *data;
+        size_t byte_count;
+        if (pa_stream_peek(stream, (const void **)&data, &byte_count))
+            return SoundIoErrorStreaming;
+        if (byte_count == 0)
+            return 0;
+
+        size_t free_bytes = (size_t)(instream->coalesce_frame_count - ispa->stage_frame_count) *
+            instream->bytes_per_frame;
+        size_t copy_count = byte_count - ispa->peek_buf_index;
+        if (copy_count > free_bytes)
+            copy_count = free_bytes;
+
+        char *dest = ispa->stage_buf + ispa->stage_frame_count * instream->bytes_per_frame;
+        if (data)
+            memcpy(dest, data + ispa->peek_buf_index, copy_count);
+        else
+            memset(dest, 0, copy_count);
+        ispa->stage_frame_count += copy_count / instream->bytes_per_frame;
+        ispa->peek_buf_index += copy_count;
+
+        if (ispa->peek_buf_index >= byte_count) {
+            if (pa_stream_drop(stream))
+                return SoundIoErrorStreaming;
+            ispa->peek_buf_index = 0;
+        }
+    }
+    return 0;
+}
+
+static void recording_stream_coalesce_read_callback(pa_stream *stream, size_t nbytes, void *userdata) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate*)userdata;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPulseAudio *ispa = &is->backend_data.pulseaudio;
+
+    for (;;) {
+        if (instream_fill_stage_pa(instream, ispa)) {
+            instream->error_callback(instream, SoundIoErrorStreaming);
+            return;
+        }
+        if (ispa->stage_frame_count == 0)
+            return;
+
+        ispa->frames_left = ispa->stage_frame_count;
+        instream->read_callback(instream, 0, ispa->stage_frame_count);
+
+        int read_frames = ispa->stage_frame_count - ispa->frames_left;
+        if (read_frames == 0)
+            return;
+        memmove(ispa->stage_buf, ispa->stage_buf + read_frames * instream->bytes_per_frame,
+                ispa->frames_left * instream->bytes_per_frame);
+        ispa->stage_frame_count = ispa->frames_left;
+
+        size_t readable_size = pa_stream_readable_size(stream);
+        if (readable_size == 0 || readable_size == (size_t)-1)
+            return;
+    }
+}
+
+// Copies everything the server has for us into the ring buffer, with holes
+// filled with silence, and wakes up the dedicated thread.
+static void recording_stream_thread_read_callback(pa_stream *stream, size_t nbytes, void *userdata) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate*)userdata;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPulseAudio *ispa = &is->backend_data.pulseaudio;
+
+    while (pa_stream_readable_size(stream) > 0) {
+        const char *data;
+        size_t byte_count;
+        if (pa_stream_peek(stream, (const void **)&data, &byte_count)) {
+            instream->error_callback(instream, SoundIoErrorStreaming);
+            return;
+        }
+        if (byte_count == 0)
+            break;
+
+        size_t free_bytes = soundio_ring_buffer_capacity(&ispa->ring_buffer) -
+            soundio_ring_buffer_fill_count(&ispa->ring_buffer);
+        free_bytes -= free_bytes % instream->bytes_per_frame;
+        size_t copy_count = byte_count;
+        if (copy_count > free_bytes) {
+            copy_count = free_bytes;
+            SOUNDIO_ATOMIC_FLAG_CLEAR(ispa->overflow_flag);
+        }
+
+        char *write_ptr = soundio_ring_buffer_write_ptr(&ispa->ring_buffer);
+        if (data)
+            memcpy(write_ptr, data, copy_count);
+        else
+            memset(write_ptr, 0, copy_count);
+        soundio_ring_buffer_advance_write_ptr(&ispa->ring_buffer, copy_count);
+
+        if (pa_stream_drop(stream)) {
+            instream->error_callback(instream, SoundIoErrorStreaming);
+            return;
+        }
+    }
+
+    soundio_os_cond_signal(ispa->cond, NULL);
+}
+
+static void capture_thread_run(void *arg) {
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)arg;
+    struct SoundIoInStream *instream = &is->pub;
+    struct SoundIoInStreamPulseAudio *ispa = &is->backend_data.pulseaudio;
+
+    while (SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ispa->abort_flag)) {
+        if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ispa->overflow_flag))
+            instream->overflow_callback(instream);
+
+        int fill_frames = soundio_ring_buffer_fill_count(&ispa->ring_buffer) / instream->bytes_per_frame;
+        if (instream->coalesce_frame_count > 0)
+            fill_frames = soundio_int_min(fill_frames, instream->coalesce_frame_count);
+        if (fill_frames > 0) {
+            ispa->frames_left = fill_frames;
+            instream->read_callback(instream, 0, fill_frames);
+            if (ispa->frames_left != fill_frames)
+                continue;
+        }
+
+        soundio_os_cond_timed_wait(ispa->cond, NULL, ispa->period_duration);
+    }
+}
+
 static void instream_destroy_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
     struct SoundIoInStreamPulseAudio *ispa = &is->backend_data.pulseaudio;
     struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
+
+    if (ispa->thread) {
+        SOUNDIO_ATOMIC_FLAG_CLEAR(ispa->abort_flag);
+        soundio_os_cond_signal(ispa->cond, NULL);
+        soundio_os_thread_destroy(ispa->thread);
+        ispa->thread = NULL;
+    }
+
     pa_stream *stream = ispa->stream;
     if (stream) {
         pa_threaded_mainloop_lock(sipa->main_loop);
@@ -882,6 +1478,16 @@ static void instream_destroy_pa(struct SoundIoPrivate *si, struct SoundIoInStrea
 
         ispa->stream = NULL;
     }
+
+    if (ispa->cond) {
+        soundio_os_cond_destroy(ispa->cond);
+        ispa->cond = NULL;
+    }
+
+    soundio_ring_buffer_deinit(&ispa->ring_buffer);
+
+    free(ispa->stage_buf);
+    ispa->stage_buf = NULL;
 }
 
 static int instream_open_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is) {
@@ -915,7 +1521,12 @@ static int instream_open_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPri
     pa_stream *stream = ispa->stream;
 
     pa_stream_set_state_callback(stream, recording_stream_state_callback, is);
-    pa_stream_set_read_callback(stream, recording_stream_read_callback, is);
+    pa_stream_request_cb_t read_callback = recording_stream_read_callback;
+    if (instream->dedicated_thread)
+        read_callback = recording_stream_thread_read_callback;
+    else if (instream->coalesce_frame_count > 0)
+        read_callback = recording_stream_coalesce_read_callback;
+    pa_stream_set_read_callback(stream, read_callback, is);
 
     ispa->buffer_attr.maxlength = UINT32_MAX;
     ispa->buffer_attr.tlength = UINT32_MAX;
@@ -928,10 +1539,39 @@ static int instream_open_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPri
         int buffer_length = instream->bytes_per_frame *
             ceil_dbl_to_int(instream->software_latency * bytes_per_second / (double)instream->bytes_per_frame);
         ispa->buffer_attr.fragsize = buffer_length;
+        ispa->adjust_latency = instream->adjust_latency;
     }
 
     pa_threaded_mainloop_unlock(sipa->main_loop);
 
+    if (instream->dedicated_thread) {
+        // Room for a couple of fragments; when the fragment size is left to
+        // the server it is about two seconds.
+        double fragment_duration = (instream->software_latency > 0.0) ? instream->software_latency : 2.0;
+        int bytes_per_second = instream->bytes_per_frame * instream->sample_rate;
+        int err;
+        if ((err = soundio_ring_buffer_init(&ispa->ring_buffer,
+                        ceil_dbl_to_int(2.0 * fragment_duration * bytes_per_second))))
+        {
+            instream_destroy_pa(si, is);
+            return err;
+        }
+        ispa->cond = soundio_os_cond_create();
+        if (!ispa->cond) {
+            instream_destroy_pa(si, is);
+            return SoundIoErrorNoMem;
+        }
+        ispa->period_duration = fragment_duration / 2.0;
+    } else if (instream->coalesce_frame_count > 0) {
+        ispa->stage_buf = ALLOCATE_NONZERO(char, instream->coalesce_frame_count * instream->bytes_per_frame);
+        if (!ispa->stage_buf) {
+            instream_destroy_pa(si, is);
+            return SoundIoErrorNoMem;
+        }
+        ispa->stage_frame_count = 0;
+        ispa->peek_buf_index = 0;
+    }
+
     return 0;
 }
 
@@ -942,6 +1582,8 @@ static int instream_start_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPr
     pa_threaded_mainloop_lock(sipa->main_loop);
 
     pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_INTERPOLATE_TIMING);
+    if (ispa->adjust_latency)
+        flags = (pa_stream_flags_t)(flags | PA_STREAM_ADJUST_LATENCY);
 
     int err = pa_stream_connect_record(ispa->stream,
             instream->device->id,
@@ -960,8 +1602,30 @@ static int instream_start_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPr
         return err;
     }
 
+    if (ispa->adjust_latency) {
+        const pa_buffer_attr *attr = pa_stream_get_buffer_attr(ispa->stream);
+        const pa_timing_info *timing_info = pa_stream_get_timing_info(ispa->stream);
+        if (attr)
+            ispa->buffer_attr = *attr;
+        pa_usec_t source_usec = timing_info ? timing_info->configured_source_usec : 0;
+        int bytes_per_second = instream->bytes_per_frame * instream->sample_rate;
+        instream->software_latency = ((double)ispa->buffer_attr.fragsize) / (double)bytes_per_second +
+            source_usec / 1000000.0;
+    }
 
     pa_threaded_mainloop_unlock(sipa->main_loop);
+
+    if (instream->dedicated_thread) {
+        SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ispa->abort_flag);
+        SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(ispa->overflow_flag);
+        if ((err = soundio_os_thread_create(capture_thread_run, is,
+                        si->pub.emit_rtprio_warning, &is->thread_policy,
+                        soundio_seconds_to_ns(ispa->period_duration), &ispa->thread)))
+        {
+            return err;
+        }
+    }
+
     return 0;
 }
 
@@ -974,6 +1638,22 @@ static int instream_begin_read_pa(struct SoundIoPrivate *si,
 
     assert(SOUNDIO_ATOMIC_LOAD(ispa->stream_ready));
 
+    if (instream->dedicated_thread || ispa->stage_buf) {
+        assert(*frame_count <= ispa->frames_left);
+
+        char *read_ptr = ispa->stage_buf ?
+            ispa->stage_buf + (ispa->stage_frame_count - ispa->frames_left) * instream->bytes_per_frame :
+            soundio_ring_buffer_read_ptr(&ispa->ring_buffer);
+        for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
+            ispa->areas[ch].ptr = read_ptr + instream->bytes_per_sample * ch;
+            ispa->areas[ch].step = instream->bytes_per_frame;
+        }
+
+        ispa->read_frame_count = *frame_count;
+        *out_areas = ispa->areas;
+        return 0;
+    }
+
     if (!ispa->peek_buf) {
         if (pa_stream_peek(stream, (const void **)&ispa->peek_buf, &ispa->peek_buf_size))
             return SoundIoErrorStreaming;
@@ -1006,6 +1686,18 @@ static int instream_end_read_pa(struct SoundIoPrivate *si, struct SoundIoInStrea
     struct SoundIoInStreamPulseAudio *ispa = &is->backend_data.pulseaudio;
     pa_stream *stream = ispa->stream;
 
+    if (ispa->stage_buf) {
+        ispa->frames_left -= ispa->read_frame_count;
+        return 0;
+    }
+
+    if (instream->dedicated_thread) {
+        int byte_count = ispa->read_frame_count * instream->bytes_per_frame;
+        soundio_ring_buffer_advance_read_ptr(&ispa->ring_buffer, byte_count);
+        ispa->frames_left -= ispa->read_frame_count;
+        return 0;
+    }
+
     // hole
     if (!ispa->peek_buf) {
         if (pa_stream_drop(stream))
@@ -1049,15 +1741,29 @@ static int instream_pause_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPr
 }
 
 static int instream_get_latency_pa(struct SoundIoPrivate *si, struct SoundIoInStreamPrivate *is, double *out_latency) {
+    struct SoundIoInStream *instream = &is->pub;
     struct SoundIoInStreamPulseAudio *ispa = &is->backend_data.pulseaudio;
+    struct SoundIoPulseAudio *sipa = &si->backend_data.pulseaudio;
 
     int err;
     pa_usec_t r_usec;
     int negative;
+    if (instream->dedicated_thread) {
+        pa_threaded_mainloop_lock(sipa->main_loop);
+        err = pa_stream_get_latency(ispa->stream, &r_usec, &negative);
+        pa_threaded_mainloop_unlock(sipa->main_loop);
+        if (err)
+            return SoundIoErrorStreaming;
+        int fill_frames = soundio_ring_buffer_fill_count(&ispa->ring_buffer) / instream->bytes_per_frame;
+        *out_latency = r_usec / 1000000.0 + fill_frames / (double)instream->sample_rate;
+        return 0;
+    }
     if ((err = pa_stream_get_latency(ispa->stream, &r_usec, &negative))) {
         return SoundIoErrorStreaming;
     }
     *out_latency = r_usec / 1000000.0;
+    if (ispa->stage_buf)
+        *out_latency += ispa->stage_frame_count / (double)instream->sample_rate;
     return 0;
 }
 
@@ -9,14 +9,27 @@
 #define SOUNDIO_PULSEAUDIO_H
 
 #include "soundio_internal.h"
+#include "os.h"
+#include "ring_buffer.h"
 #include "atomics.h"
+#include "list.h"
 
 #include <pulse/pulseaudio.h>
 
 struct SoundIoPrivate;
 int soundio_pulseaudio_init(struct SoundIoPrivate *si);
 
-struct SoundIoDevicePulseAudio { int make_the_struct_not_empty; };
+struct SoundIoDevicePulseAudio {
+    // sink or source index, used to match subscription events to devices
+    uint32_t index;
+};
+
+struct SoundIoPulseAudioEvent {
+    pa_subscription_event_type_t type;
+    uint32_t index;
+};
+
+SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoPulseAudioEvent, SoundIoListPulseAudioEvent, SOUNDIO_LIST_STATIC)
 
 struct SoundIoPulseAudio {
     int device_query_err;
@@ -25,9 +38,13 @@ struct SoundIoPulseAudio {
 
     pa_context *pulse_context;
     bool device_scan_queued;
+    // subscription events not yet applied to devices_info. protected by mutex
+    struct SoundIoListPulseAudioEvent pending_events;
 
     // the one that we're working on building
     struct SoundIoDevicesInfo *current_devices_info;
+    // the last complete device list, patched in place by subscription events
+    struct SoundIoDevicesInfo *devices_info;
     char *default_sink_name;
     char *default_source_name;
 
@@ -48,18 +65,42 @@ struct SoundIoOutStreamPulseAudio {
     size_t write_byte_count;
     struct SoundIoAtomicFlag clear_buffer_flag;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    // the rest is only used with SoundIoOutStream::dedicated_thread
+    struct SoundIoOsThread *thread;
+    struct SoundIoOsCond *cond;
+    struct SoundIoAtomicFlag abort_flag;
+    struct SoundIoAtomicFlag underflow_flag;
+    struct SoundIoRingBuffer ring_buffer;
+    bool seek_on_read;
+    double period_duration;
+    int frames_left;
+    int write_frame_count;
 };
 
 struct SoundIoInStreamPulseAudio {
     pa_stream *stream;
     struct SoundIoAtomicBool stream_ready;
     pa_buffer_attr buffer_attr;
+    bool adjust_latency;
     char *peek_buf;
     size_t peek_buf_index;
     size_t peek_buf_size;
     int peek_buf_frames_left;
     int read_frame_count;
     struct SoundIoChannelArea areas[SOUNDIO_MAX_CHANNELS];
+    // only used with SoundIoInStream::coalesce_frame_count and without a
+    // dedicated thread
+    char *stage_buf;
+    int stage_frame_count;
+    // the rest is only used with SoundIoInStream::dedicated_thread
+    struct SoundIoOsThread *thread;
+    struct SoundIoOsCond *cond;
+    struct SoundIoAtomicFlag abort_flag;
+    struct SoundIoAtomicFlag overflow_flag;
+    struct SoundIoRingBuffer ring_buffer;
+    bool seek_on_read;
+    double period_duration;
+    int frames_left;
 };
 
 #endif
@@ -24,6 +24,9 @@ static const enum SoundIoBackend available_backends[] = {
 #ifdef SOUNDIO_HAVE_ALSA
     SoundIoBackendAlsa,
 #endif
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    SoundIoBackendPipeWire,
+#endif
 #ifdef SOUNDIO_HAVE_COREAUDIO
     SoundIoBackendCoreAudio,
 #endif
@@ -31,6 +34,10 @@ static const enum SoundIoBackend available_backends[] = {
     SoundIoBackendWasapi,
 #endif
     SoundIoBackendDummy,
+    SoundIoBackendFile,
+#ifdef SOUNDIO_HAVE_PIPE
+    SoundIoBackendPipe,
+#endif
 };
 
 typedef int (*backend_init_t)(struct SoundIoPrivate *);
@@ -68,6 +75,18 @@ static backend_init_t backend_init_fns[] = {
 #endif
 
     &soundio_dummy_init,
+    &soundio_file_init,
+#ifdef SOUNDIO_HAVE_PIPE
+    &soundio_pipe_init,
+#else
+    NULL,
+#endif
+
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    &soundio_pipewire_init,
+#else
+    NULL,
+#endif
 };
 
 SOUNDIO_MAKE_LIST_DEF(struct SoundIoDevice*, SoundIoListDevicePtr, SOUNDIO_LIST_NOT_STATIC)
@@ -91,6 +110,7 @@ const char *soundio_strerror(int error) {
         case SoundIoErrorInterrupted: return "interrupted; try again";
         case SoundIoErrorUnderflow: return "buffer underflow";
         case SoundIoErrorEncodingString: return "failed to encode string";
+        case SoundIoErrorEndOfFile: return "end of file";
     }
     return "(invalid error)";
 }
@@ -158,6 +178,9 @@ const char *soundio_backend_name(enum SoundIoBackend backend) {
         case SoundIoBackendCoreAudio: return "CoreAudio";
         case SoundIoBackendWasapi: return "WASAPI";
         case SoundIoBackendDummy: return "Dummy";
+        case SoundIoBackendFile: return "File";
+        case SoundIoBackendPipe: return "Pipe";
+        case SoundIoBackendPipeWire: return "PipeWire";
     }
     return "(invalid backend)";
 }
@@ -201,6 +224,7 @@ struct SoundIo *soundio_create(void) {
     soundio->emit_rtprio_warning = default_emit_rtprio_warning;
     soundio->jack_info_callback = default_msg_callback;
     soundio->jack_error_callback = default_msg_callback;
+    soundio->device_scan_debounce = 0.1;
     return soundio;
 }
 
@@ -225,7 +249,7 @@ int soundio_connect_backend(struct SoundIo *soundio, enum SoundIoBackend backend
     if (soundio->current_backend)
         return SoundIoErrorInvalid;
 
-    if (backend <= 0 || backend > SoundIoBackendDummy)
+    if (backend <= 0 || backend > SoundIoBackendPipeWire)
         return SoundIoErrorInvalid;
 
     int (*fn)(struct SoundIoPrivate *) = backend_init_fns[backend];
@@ -263,6 +287,11 @@ void soundio_disconnect(struct SoundIo *soundio) {
     si->wait_events = NULL;
     si->wakeup = NULL;
     si->force_device_scan = NULL;
+    si->set_freewheel = NULL;
+    si->advance_clock = NULL;
+    si->add_dummy_device = NULL;
+    si->remove_dummy_device = NULL;
+    si->device_probe = NULL;
 
     si->outstream_open = NULL;
     si->outstream_destroy = NULL;
@@ -270,8 +299,11 @@ void soundio_disconnect(struct SoundIo *soundio) {
     si->outstream_begin_write = NULL;
     si->outstream_end_write = NULL;
     si->outstream_clear_buffer = NULL;
+    si->outstream_get_rewindable = NULL;
+    si->outstream_rewind = NULL;
     si->outstream_pause = NULL;
     si->outstream_get_latency = NULL;
+    si->outstream_get_position = NULL;
     si->outstream_set_volume = NULL;
 
     si->instream_open = NULL;
@@ -281,6 +313,7 @@ void soundio_disconnect(struct SoundIo *soundio) {
     si->instream_end_read = NULL;
     si->instream_pause = NULL;
     si->instream_get_latency = NULL;
+    si->instream_get_position = NULL;
 }
 
 void soundio_flush_events(struct SoundIo *soundio) {
@@ -439,6 +472,42 @@ void soundio_force_device_scan(struct SoundIo *soundio) {
     si->force_device_scan(si);
 }
 
+int soundio_advance_clock(struct SoundIo *soundio, double seconds) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    if (!si->advance_clock)
+        return SoundIoErrorIncompatibleBackend;
+    return si->advance_clock(si, seconds);
+}
+
+int soundio_add_dummy_device(struct SoundIo *soundio, const struct SoundIoDummyDeviceSpec *spec) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    if (!si->add_dummy_device)
+        return SoundIoErrorIncompatibleBackend;
+    return si->add_dummy_device(si, spec);
+}
+
+int soundio_remove_dummy_device(struct SoundIo *soundio, enum SoundIoDeviceAim aim, const char *id) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    if (!si->remove_dummy_device)
+        return SoundIoErrorIncompatibleBackend;
+    return si->remove_dummy_device(si, aim, id);
+}
+
+int soundio_set_freewheel(struct SoundIo *soundio, bool freewheel) {
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    if (!si->set_freewheel)
+        return SoundIoErrorIncompatibleBackend;
+    return si->set_freewheel(si, freewheel);
+}
+
+int64_t soundio_get_time_ns(enum SoundIoClock clock) {
+    switch (clock) {
+        case SoundIoClockMonotonic: return soundio_os_get_time_ns();
+        case SoundIoClockMonotonicRaw: return soundio_os_get_raw_time_ns();
+    }
+    return soundio_os_get_time_ns();
+}
+
 int soundio_outstream_begin_write(struct SoundIoOutStream *outstream,
         struct SoundIoChannelArea **areas, int *frame_count)
 {
@@ -457,6 +526,25 @@ int soundio_outstream_end_write(struct SoundIoOutStream *outstream) {
     return si->outstream_end_write(si, os);
 }
 
+static int copy_thread_policy(struct SoundIoThreadPolicy *dest, struct SoundIo *soundio,
+        const struct SoundIoThreadPolicy *policy)
+{
+    if (!policy)
+        policy = &soundio->thread_policy;
+
+    if (policy->sched < SoundIoThreadSchedDefault || policy->sched > SoundIoThreadSchedDeadline)
+        return SoundIoErrorInvalid;
+    if (policy->priority < 0)
+        return SoundIoErrorInvalid;
+    if (policy->deadline_runtime < 0.0 || policy->deadline_runtime > 1.0)
+        return SoundIoErrorInvalid;
+    if (policy->timer_slack < 0)
+        return SoundIoErrorInvalid;
+
+    *dest = *policy;
+    return 0;
+}
+
 static void default_outstream_error_callback(struct SoundIoOutStream *os, int err) {
     soundio_panic("libsoundio: %s", soundio_strerror(err));
 }
@@ -487,8 +575,9 @@ int soundio_outstream_open(struct SoundIoOutStream *outstream) {
     if (device->aim != SoundIoDeviceAimOutput)
         return SoundIoErrorInvalid;
 
-    if (device->probe_error)
-        return device->probe_error;
+    int err;
+    if ((err = soundio_device_probe(device)))
+        return err;
 
     if (outstream->layout.channel_count > SOUNDIO_MAX_CHANNELS)
         return SoundIoErrorInvalid;
@@ -512,8 +601,12 @@ int soundio_outstream_open(struct SoundIoOutStream *outstream) {
     struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
     outstream->bytes_per_frame = soundio_get_bytes_per_frame(outstream->format, outstream->layout.channel_count);
     outstream->bytes_per_sample = soundio_get_bytes_per_sample(outstream->format);
+    outstream->opened_raw = device->is_raw;
 
     struct SoundIo *soundio = device->soundio;
+    if ((err = copy_thread_policy(&os->thread_policy, soundio, outstream->thread_policy)))
+        return err;
+
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     return si->outstream_open(si, os);
 }
@@ -554,6 +647,28 @@ int soundio_outstream_clear_buffer(struct SoundIoOutStream *outstream) {
     return si->outstream_clear_buffer(si, os);
 }
 
+int soundio_outstream_get_rewindable(struct SoundIoOutStream *outstream, int *out_frame_count) {
+    struct SoundIo *soundio = outstream->device->soundio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    if (!si->outstream_get_rewindable)
+        return SoundIoErrorIncompatibleBackend;
+    return si->outstream_get_rewindable(si, os, out_frame_count);
+}
+
+int soundio_outstream_rewind(struct SoundIoOutStream *outstream, int keep_frame_count,
+        int *out_frame_count)
+{
+    struct SoundIo *soundio = outstream->device->soundio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    if (si->outstream_rewind)
+        return si->outstream_rewind(si, os, keep_frame_count, out_frame_count);
+
+    *out_frame_count = 0;
+    return si->outstream_clear_buffer(si, os);
+}
+
 int soundio_outstream_get_latency(struct SoundIoOutStream *outstream, double *out_latency) {
     struct SoundIo *soundio = outstream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
@@ -561,6 +676,17 @@ int soundio_outstream_get_latency(struct SoundIoOutStream *outstream, double *ou
     return si->outstream_get_latency(si, os, out_latency);
 }
 
+int soundio_outstream_get_position(struct SoundIoOutStream *outstream,
+        int64_t *out_frame_position, double *out_timestamp)
+{
+    struct SoundIo *soundio = outstream->device->soundio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    struct SoundIoOutStreamPrivate *os = (struct SoundIoOutStreamPrivate *)outstream;
+    if (!si->outstream_get_position)
+        return SoundIoErrorIncompatibleBackend;
+    return si->outstream_get_position(si, os, out_frame_position, out_timestamp);
+}
+
 int soundio_outstream_set_volume(struct SoundIoOutStream *outstream, double volume) {
     struct SoundIo *soundio = outstream->device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
@@ -569,6 +695,8 @@ int soundio_outstream_set_volume(struct SoundIoOutStream *outstream, double volu
 }
 
 static void default_instream_error_callback(struct SoundIoInStream *is, int err) {
+    if (err == SoundIoErrorEndOfFile)
+        return;
     soundio_panic("libsoundio: %s", soundio_strerror(err));
 }
 
@@ -603,8 +731,12 @@ int soundio_instream_open(struct SoundIoInStream *instream) {
     if (instream->layout.channel_count > SOUNDIO_MAX_CHANNELS)
         return SoundIoErrorInvalid;
 
-    if (device->probe_error)
-        return device->probe_error;
+    if (instream->coalesce_frame_count < 0)
+        return SoundIoErrorInvalid;
+
+    int err;
+    if ((err = soundio_device_probe(device)))
+        return err;
 
     if (instream->format == SoundIoFormatInvalid) {
         instream->format = soundio_device_supports_format(device, SoundIoFormatFloat32NE) ?
@@ -622,9 +754,13 @@ int soundio_instream_open(struct SoundIoInStream *instream) {
 
     instream->bytes_per_frame = soundio_get_bytes_per_frame(instream->format, instream->layout.channel_count);
     instream->bytes_per_sample = soundio_get_bytes_per_sample(instream->format);
+    instream->opened_raw = device->is_raw;
     struct SoundIo *soundio = device->soundio;
     struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
     struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    if ((err = copy_thread_policy(&is->thread_policy, soundio, instream->thread_policy)))
+        return err;
+
     return si->instream_open(si, is);
 }
 
@@ -680,6 +816,17 @@ int soundio_instream_get_latency(struct SoundIoInStream *instream, double *out_l
     return si->instream_get_latency(si, is, out_latency);
 }
 
+int soundio_instream_get_position(struct SoundIoInStream *instream,
+        int64_t *out_frame_position, double *out_timestamp)
+{
+    struct SoundIo *soundio = instream->device->soundio;
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)soundio;
+    struct SoundIoInStreamPrivate *is = (struct SoundIoInStreamPrivate *)instream;
+    if (!si->instream_get_position)
+        return SoundIoErrorIncompatibleBackend;
+    return si->instream_get_position(si, is, out_frame_position, out_timestamp);
+}
+
 void soundio_destroy_devices_info(struct SoundIoDevicesInfo *devices_info) {
     if (!devices_info)
         return;
@@ -697,7 +844,7 @@ void soundio_destroy_devices_info(struct SoundIoDevicesInfo *devices_info) {
 
 bool soundio_have_backend(enum SoundIoBackend backend) {
     assert(backend > 0);
-    assert(backend <= SoundIoBackendDummy);
+    assert(backend <= SoundIoBackendPipeWire);
     return backend_init_fns[backend];
 }
 
@@ -754,6 +901,20 @@ void soundio_device_sort_channel_layouts(struct SoundIoDevice *device) {
     soundio_sort_channel_layouts(device->layouts, device->layout_count);
 }
 
+int soundio_device_probe(struct SoundIoDevice *device) {
+    struct SoundIoDevicePrivate *dev = (struct SoundIoDevicePrivate *)device;
+    if (!dev->probe_pending)
+        return device->probe_error;
+
+    struct SoundIoPrivate *si = (struct SoundIoPrivate *)device->soundio;
+    if (!si->device_probe)
+        return SoundIoErrorBackendDisconnected;
+
+    device->probe_error = si->device_probe(si, dev);
+    dev->probe_pending = false;
+    return device->probe_error;
+}
+
 bool soundio_device_supports_format(struct SoundIoDevice *device, enum SoundIoFormat format) {
     for (int i = 0; i < device->format_count; i += 1) {
         if (device->formats[i] == format)
@@ -33,6 +33,15 @@
 #endif
 
 #include "dummy.h"
+#include "file.h"
+
+#ifdef SOUNDIO_HAVE_PIPE
+#include "pipe.h"
+#endif
+
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+#include "pipewire.h"
+#endif
 
 union SoundIoBackendData {
 #ifdef SOUNDIO_HAVE_JACK
@@ -51,6 +60,13 @@ union SoundIoBackendData {
     struct SoundIoWasapi wasapi;
 #endif
     struct SoundIoDummy dummy;
+    struct SoundIoFile file;
+#ifdef SOUNDIO_HAVE_PIPE
+    struct SoundIoPipe pipe;
+#endif
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    struct SoundIoPipeWire pipewire;
+#endif
 };
 
 union SoundIoDeviceBackendData {
@@ -70,6 +86,13 @@ union SoundIoDeviceBackendData {
     struct SoundIoDeviceWasapi wasapi;
 #endif
     struct SoundIoDeviceDummy dummy;
+    struct SoundIoDeviceFile file;
+#ifdef SOUNDIO_HAVE_PIPE
+    struct SoundIoDevicePipe pipe;
+#endif
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    struct SoundIoDevicePipeWire pipewire;
+#endif
 };
 
 union SoundIoOutStreamBackendData {
@@ -89,6 +112,13 @@ union SoundIoOutStreamBackendData {
     struct SoundIoOutStreamWasapi wasapi;
 #endif
     struct SoundIoOutStreamDummy dummy;
+    struct SoundIoOutStreamFile file;
+#ifdef SOUNDIO_HAVE_PIPE
+    struct SoundIoOutStreamPipe pipe;
+#endif
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    struct SoundIoOutStreamPipeWire pipewire;
+#endif
 };
 
 union SoundIoInStreamBackendData {
@@ -108,6 +138,13 @@ union SoundIoInStreamBackendData {
     struct SoundIoInStreamWasapi wasapi;
 #endif
     struct SoundIoInStreamDummy dummy;
+    struct SoundIoInStreamFile file;
+#ifdef SOUNDIO_HAVE_PIPE
+    struct SoundIoInStreamPipe pipe;
+#endif
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    struct SoundIoInStreamPipeWire pipewire;
+#endif
 };
 
 SOUNDIO_MAKE_LIST_STRUCT(struct SoundIoDevice*, SoundIoListDevicePtr, SOUNDIO_LIST_NOT_STATIC)
@@ -124,13 +161,19 @@ struct SoundIoDevicesInfo {
 struct SoundIoOutStreamPrivate {
     struct SoundIoOutStream pub;
     union SoundIoOutStreamBackendData backend_data;
+    // copied from SoundIoOutStream::thread_policy by open
+    struct SoundIoThreadPolicy thread_policy;
 };
 
 struct SoundIoInStreamPrivate {
     struct SoundIoInStream pub;
     union SoundIoInStreamBackendData backend_data;
+    // copied from SoundIoInStream::thread_policy by open
+    struct SoundIoThreadPolicy thread_policy;
 };
 
+struct SoundIoDevicePrivate;
+
 struct SoundIoPrivate {
     struct SoundIo pub;
 
@@ -142,6 +185,11 @@ struct SoundIoPrivate {
     void (*wait_events)(struct SoundIoPrivate *);
     void (*wakeup)(struct SoundIoPrivate *);
     void (*force_device_scan)(struct SoundIoPrivate *);
+    int (*set_freewheel)(struct SoundIoPrivate *, bool freewheel);
+    int (*advance_clock)(struct SoundIoPrivate *, double seconds);
+    int (*add_dummy_device)(struct SoundIoPrivate *, const struct SoundIoDummyDeviceSpec *spec);
+    int (*remove_dummy_device)(struct SoundIoPrivate *, enum SoundIoDeviceAim aim, const char *id);
+    int (*device_probe)(struct SoundIoPrivate *, struct SoundIoDevicePrivate *);
 
     int (*outstream_open)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *);
     void (*outstream_destroy)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *);
@@ -150,8 +198,14 @@ struct SoundIoPrivate {
             struct SoundIoChannelArea **out_areas, int *out_frame_count);
     int (*outstream_end_write)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *);
     int (*outstream_clear_buffer)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *);
+    int (*outstream_get_rewindable)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *,
+            int *out_frame_count);
+    int (*outstream_rewind)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *,
+            int keep_frame_count, int *out_frame_count);
     int (*outstream_pause)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *, bool pause);
     int (*outstream_get_latency)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *, double *out_latency);
+    int (*outstream_get_position)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *,
+            int64_t *out_frame_position, double *out_timestamp);
     int (*outstream_set_volume)(struct SoundIoPrivate *, struct SoundIoOutStreamPrivate *, float volume);
 
     int (*instream_open)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *);
@@ -162,6 +216,8 @@ struct SoundIoPrivate {
     int (*instream_end_read)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *);
     int (*instream_pause)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *, bool pause);
     int (*instream_get_latency)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *, double *out_latency);
+    int (*instream_get_position)(struct SoundIoPrivate *, struct SoundIoInStreamPrivate *,
+            int64_t *out_frame_position, double *out_timestamp);
 
     union SoundIoBackendData backend_data;
 };
@@ -173,6 +229,8 @@ struct SoundIoDevicePrivate {
     struct SoundIoDevice pub;
     union SoundIoDeviceBackendData backend_data;
     void (*destruct)(struct SoundIoDevicePrivate *);
+    // set by backends which deferred probing; see SoundIo::lazy_device_probe
+    bool probe_pending;
     struct SoundIoSampleRateRange prealloc_sample_rate_range;
     struct SoundIoListSampleRateRange sample_rates;
     enum SoundIoFormat prealloc_format;
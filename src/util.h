@@ -12,6 +12,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define ALLOCATE_NONZERO(Type, count) ((Type*)malloc((count) * sizeof(Type)))
 
@@ -95,4 +96,18 @@ static inline double ceil_dbl(double x) {
     return ceiling;
 }
 
+static inline int64_t soundio_seconds_to_ns(double seconds) {
+    return (int64_t)(seconds * 1000000000.0 + ((seconds < 0.0) ? -0.5 : 0.5));
+}
+
+// whole frames played in ns nanoseconds, which must not be negative. Does not
+// overflow for any duration that fits in ns.
+static inline int64_t soundio_ns_to_frames(int64_t ns, int sample_rate) {
+    return (ns / 1000000000) * sample_rate + (ns % 1000000000) * sample_rate / 1000000000;
+}
+
+static inline int64_t soundio_frames_to_ns(int64_t frames, int sample_rate) {
+    return (frames / sample_rate) * 1000000000 + (frames % sample_rate) * 1000000000 / sample_rate;
+}
+
 #endif
@@ -1612,7 +1612,7 @@ static int outstream_open_wasapi(struct SoundIoPrivate *si, struct SoundIoOutStr
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(osw->thread_exit_flag);
     int err;
     if ((err = soundio_os_thread_create(outstream_thread_run, os,
-                    soundio->emit_rtprio_warning, &osw->thread)))
+                    soundio->emit_rtprio_warning, &os->thread_policy, 0, &osw->thread)))
     {
         outstream_destroy_wasapi(si, os);
         return err;
@@ -1953,9 +1953,16 @@ static void instream_shared_run(struct SoundIoInStreamPrivate *is) {
         return;
     }
 
+    // poll on a fixed grid so that late wakeups do not add up
+    int64_t period_duration = soundio_seconds_to_ns(instream->software_latency / 2.0);
+    int64_t next_period = soundio_os_get_time_ns();
     for (;;) {
+        int64_t now = soundio_os_get_time_ns();
+        next_period += period_duration;
+        if (next_period <= now)
+            next_period += ((now - next_period) / period_duration + 1) * period_duration;
         soundio_os_mutex_lock(isw->mutex);
-        soundio_os_cond_timed_wait(isw->cond, isw->mutex, instream->software_latency / 2.0);
+        soundio_os_cond_timed_wait_until(isw->cond, isw->mutex, next_period);
         if (!SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isw->thread_exit_flag)) {
             soundio_os_mutex_unlock(isw->mutex);
             return;
@@ -2058,7 +2065,7 @@ static int instream_open_wasapi(struct SoundIoPrivate *si, struct SoundIoInStrea
     SOUNDIO_ATOMIC_FLAG_TEST_AND_SET(isw->thread_exit_flag);
     int err;
     if ((err = soundio_os_thread_create(instream_thread_run, is,
-                    soundio->emit_rtprio_warning, &isw->thread)))
+                    soundio->emit_rtprio_warning, &is->thread_policy, 0, &isw->thread)))
     {
         instream_destroy_wasapi(si, is);
         return err;
@@ -2310,7 +2317,7 @@ int soundio_wasapi_init(struct SoundIoPrivate *si) {
     siw->device_events.lpVtbl = &soundio_MMNotificationClient;
     siw->device_events_refs = 1;
 
-    if ((err = soundio_os_thread_create(device_thread_run, si, NULL, &siw->thread))) {
+    if ((err = soundio_os_thread_create(device_thread_run, si, NULL, NULL, 0, &siw->thread))) {
         destroy_wasapi(si);
         return err;
     }
@@ -30,7 +30,8 @@ static int usage(char *exe) {
     fprintf(stderr, "Usage: %s [options]\n"
             "Options:\n"
             "  [--backend dummy|alsa|pulseaudio|jack|coreaudio|wasapi]\n"
-            "  [--timeout seconds]\n", exe);
+            "  [--timeout seconds]\n"
+            "  [--inject-disconnect seconds]\n", exe);
     return 1;
 }
 
@@ -46,6 +47,7 @@ static void on_backend_disconnect(struct SoundIo *soundio, int err) {
 int main(int argc, char **argv) {
     char *exe = argv[0];
     int timeout = 0;
+    double inject_disconnect = 0.0;
     for (int i = 1; i < argc; i += 1) {
         char *arg = argv[i];
         if (arg[0] == '-' && arg[1] == '-') {
@@ -54,8 +56,10 @@ int main(int argc, char **argv) {
                 return usage(exe);
             } else if (strcmp(arg, "--timeout") == 0) {
                 timeout = atoi(argv[i]);
+            } else if (strcmp(arg, "--inject-disconnect") == 0) {
+                inject_disconnect = atof(argv[i]);
             } else if (strcmp(arg, "--backend") == 0) {
-                if (strcmp("-dummy", argv[i]) == 0) {
+                if (strcmp("dummy", argv[i]) == 0) {
                     backend = SoundIoBackendDummy;
                 } else if (strcmp("alsa", argv[i]) == 0) {
                     backend = SoundIoBackendAlsa;
@@ -83,6 +87,15 @@ int main(int argc, char **argv) {
     if (!(soundio = soundio_create()))
         panic("out of memory");
 
+    // lets the dummy backend disconnect by itself instead of waiting for
+    // the tester to kill the sound server
+    struct SoundIoDummyFaults faults;
+    if (inject_disconnect > 0.0) {
+        memset(&faults, 0, sizeof(struct SoundIoDummyFaults));
+        faults.disconnect_after = inject_disconnect;
+        soundio->dummy_faults = &faults;
+    }
+
     int err = (backend == SoundIoBackendNone) ?
         soundio_connect(soundio) : soundio_connect_backend(soundio, backend);
 
@@ -59,11 +59,11 @@ static void write_time(struct SoundIoOutStream *outstream, double extra) {
     if ((err = soundio_outstream_get_latency(outstream, &latency))) {
         soundio_panic("getting latency: %s", soundio_strerror(err));
     }
-    double now = soundio_os_get_time();
-    double audible_time = now + latency + extra;
-    double *write_ptr = (double *)soundio_ring_buffer_write_ptr(&pulse_rb);
+    int64_t now = soundio_get_time_ns(SoundIoClockMonotonic);
+    int64_t audible_time = now + (int64_t)((latency + extra) * 1000000000.0);
+    int64_t *write_ptr = (int64_t *)soundio_ring_buffer_write_ptr(&pulse_rb);
     *write_ptr = audible_time;
-    soundio_ring_buffer_advance_write_ptr(&pulse_rb, sizeof(double));
+    soundio_ring_buffer_advance_write_ptr(&pulse_rb, sizeof(int64_t));
 }
 
 static void write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
@@ -223,10 +223,10 @@ int main(int argc, char **argv) {
     int count = 0;
     for (;;) {
         int fill_count = soundio_ring_buffer_fill_count(&pulse_rb);
-        if (fill_count >= (int)sizeof(double)) {
-            double *read_ptr = (double *)soundio_ring_buffer_read_ptr(&pulse_rb);
-            double audible_time = *read_ptr;
-            while (audible_time > soundio_os_get_time()) {
+        if (fill_count >= (int)sizeof(int64_t)) {
+            int64_t *read_ptr = (int64_t *)soundio_ring_buffer_read_ptr(&pulse_rb);
+            int64_t audible_time = *read_ptr;
+            while (audible_time > soundio_get_time_ns(SoundIoClockMonotonic)) {
                 // Burn the CPU while we wait for our precisely timed event.
             }
             if (beep_on) {
@@ -235,11 +235,11 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "BEEP %d end\n", count++);
             }
             fflush(stderr);
-            double off_by = soundio_os_get_time() - audible_time;
+            double off_by = (soundio_get_time_ns(SoundIoClockMonotonic) - audible_time) / 1000000000.0;
             if (off_by > 0.0001)
                 fprintf(stderr, "off by %f\n", off_by);
             beep_on = !beep_on;
-            soundio_ring_buffer_advance_read_ptr(&pulse_rb, sizeof(double));
+            soundio_ring_buffer_advance_read_ptr(&pulse_rb, sizeof(int64_t));
         }
     }
 
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2015 Andrew Kelley
+ *
+ * This file is part of libsoundio, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include <soundio/soundio.h>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+__attribute__ ((cold))
+__attribute__ ((noreturn))
+__attribute__ ((format (printf, 1, 2)))
+static void panic(const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    abort();
+}
+
+static int usage(char *exe) {
+    fprintf(stderr, "Usage: %s [options]\n"
+            "Options:\n"
+            "  [--backend dummy|alsa|pulseaudio|jack|coreaudio|wasapi]\n"
+            "  [--device id]\n"
+            "  [--raw]\n"
+            "  [--latency seconds]\n"
+            "  [--duration seconds]\n"
+            , exe);
+    return 1;
+}
+
+static struct SoundIo *soundio = NULL;
+static int frames_end = 0;
+static int frames_written = 0;
+static int callback_count = 0;
+
+static void write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int err;
+
+    callback_count += 1;
+
+    if (frames_written >= frames_end) {
+        soundio_wakeup(soundio);
+        return;
+    }
+
+    int frames_left = frame_count_max;
+    while (frames_left > 0) {
+        int frame_count = frames_left;
+        if ((err = soundio_outstream_begin_write(outstream, &areas, &frame_count)))
+            panic("%s", soundio_strerror(err));
+
+        if (!frame_count)
+            break;
+
+        // Keep the work done here to a minimum so that the library overhead
+        // is all that is left to measure.
+        for (int channel = 0; channel < outstream->layout.channel_count; channel += 1) {
+            for (int frame = 0; frame < frame_count; frame += 1)
+                memset(areas[channel].ptr + areas[channel].step * frame, 0, outstream->bytes_per_sample);
+        }
+
+        if ((err = soundio_outstream_end_write(outstream)))
+            panic("%s", soundio_strerror(err));
+
+        frames_written += frame_count;
+        frames_left -= frame_count;
+    }
+}
+
+static void underflow_callback(struct SoundIoOutStream *outstream) {
+    static int count = 0;
+    fprintf(stderr, "underflow %d\n", count++);
+}
+
+int main(int argc, char **argv) {
+    char *exe = argv[0];
+    enum SoundIoBackend backend = SoundIoBackendNone;
+    char *device_id = NULL;
+    bool raw = false;
+    double latency = 0.0;
+    double duration = 10.0;
+    for (int i = 1; i < argc; i += 1) {
+        char *arg = argv[i];
+        if (arg[0] == '-' && arg[1] == '-') {
+            if (strcmp(arg, "--raw") == 0) {
+                raw = true;
+            } else {
+                i += 1;
+                if (i >= argc) {
+                    return usage(exe);
+                } else if (strcmp(arg, "--backend") == 0) {
+                    if (strcmp(argv[i], "dummy") == 0) {
+                        backend = SoundIoBackendDummy;
+                    } else if (strcmp(argv[i], "alsa") == 0) {
+                        backend = SoundIoBackendAlsa;
+                    } else if (strcmp(argv[i], "pulseaudio") == 0) {
+                        backend = SoundIoBackendPulseAudio;
+                    } else if (strcmp(argv[i], "jack") == 0) {
+                        backend = SoundIoBackendJack;
+                    } else if (strcmp(argv[i], "coreaudio") == 0) {
+                        backend = SoundIoBackendCoreAudio;
+                    } else if (strcmp(argv[i], "wasapi") == 0) {
+                        backend = SoundIoBackendWasapi;
+                    } else {
+                        fprintf(stderr, "Invalid backend: %s\n", argv[i]);
+                        return 1;
+                    }
+                } else if (strcmp(arg, "--device") == 0) {
+                    device_id = argv[i];
+                } else if (strcmp(arg, "--latency") == 0) {
+                    latency = atof(argv[i]);
+                } else if (strcmp(arg, "--duration") == 0) {
+                    duration = atof(argv[i]);
+                } else {
+                    return usage(exe);
+                }
+            }
+        } else {
+            return usage(exe);
+        }
+    }
+
+    fprintf(stderr, "Plays silence for %f seconds and counts the write callbacks. Run it under\n"
+                    "`strace -f -c` or `perf trace -s` and divide the system call counts of the\n"
+                    "audio thread by the number of callbacks to get the per-callback overhead.\n",
+                    duration);
+
+    if (!(soundio = soundio_create()))
+        panic("out of memory");
+
+    int err = (backend == SoundIoBackendNone) ?
+        soundio_connect(soundio) : soundio_connect_backend(soundio, backend);
+
+    if (err)
+        panic("error connecting: %s", soundio_strerror(err));
+
+    soundio_flush_events(soundio);
+
+    int selected_device_index = -1;
+    if (device_id) {
+        int device_count = soundio_output_device_count(soundio);
+        for (int i = 0; i < device_count; i += 1) {
+            struct SoundIoDevice *device = soundio_get_output_device(soundio, i);
+            bool select_this_one = strcmp(device->id, device_id) == 0 && device->is_raw == raw;
+            soundio_device_unref(device);
+            if (select_this_one) {
+                selected_device_index = i;
+                break;
+            }
+        }
+    } else {
+        selected_device_index = soundio_default_output_device_index(soundio);
+    }
+
+    if (selected_device_index < 0)
+        panic("Output device not found");
+
+    struct SoundIoDevice *device = soundio_get_output_device(soundio, selected_device_index);
+    if (!device)
+        panic("out of memory");
+
+    fprintf(stderr, "Output device: %s\n", device->name);
+
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->write_callback = write_callback;
+    outstream->underflow_callback = underflow_callback;
+    outstream->software_latency = latency;
+
+    if ((err = soundio_outstream_open(outstream)))
+        panic("unable to open device: %s", soundio_strerror(err));
+
+    fprintf(stderr, "Software latency: %f\n", outstream->software_latency);
+
+    frames_end = duration * outstream->sample_rate;
+
+    if ((err = soundio_outstream_start(outstream)))
+        panic("unable to start device: %s", soundio_strerror(err));
+
+    while (frames_written < frames_end)
+        soundio_wait_events(soundio);
+
+    soundio_outstream_destroy(outstream);
+
+    fprintf(stderr, "%d write callbacks, %d frames\n", callback_count, frames_written);
+
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+    return 0;
+}
@@ -34,6 +34,7 @@ static int usage(char *exe) {
             "  [--device id]\n"
             "  [--raw]\n"
             "  [--sample-rate hz]\n"
+            "  [--preserve-clock]\n"
             , exe);
     return 1;
 }
@@ -122,7 +123,8 @@ static void write_callback(struct SoundIoOutStream *outstream, int frame_count_m
 
 static void underflow_callback(struct SoundIoOutStream *outstream) {
     static int count = 0;
-    fprintf(stderr, "underflow %d\n", count++);
+    fprintf(stderr, "underflow %d (%ld frames lost so far)\n", count++,
+            (long)outstream->underflow_frame_count);
 }
 
 int main(int argc, char **argv) {
@@ -130,12 +132,15 @@ int main(int argc, char **argv) {
     enum SoundIoBackend backend = SoundIoBackendNone;
     char *device_id = NULL;
     bool raw = false;
+    bool preserve_clock = false;
     int sample_rate = 0;
     for (int i = 1; i < argc; i += 1) {
         char *arg = argv[i];
         if (arg[0] == '-' && arg[1] == '-') {
             if (strcmp(arg, "--raw") == 0) {
                 raw = true;
+            } else if (strcmp(arg, "--preserve-clock") == 0) {
+                preserve_clock = true;
             } else {
                 i += 1;
                 if (i >= argc) {
@@ -213,6 +218,7 @@ int main(int argc, char **argv) {
     outstream->format = SoundIoFormatFloat32NE;
     outstream->write_callback = write_callback;
     outstream->underflow_callback = underflow_callback;
+    outstream->preserve_clock_on_xrun = preserve_clock;
     outstream->sample_rate = sample_rate;
 
     if (soundio_device_supports_format(device, SoundIoFormatFloat32NE)) {
@@ -10,6 +10,11 @@
 #include <assert.h>
 #include <limits.h>
 
+#ifdef SOUNDIO_HAVE_PIPE
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
 static inline void ok_or_panic(int err) {
     if (err)
         soundio_panic("%s", soundio_strerror(err));
@@ -25,8 +30,39 @@ static void test_os_get_time(void) {
     }
 }
 
+static void test_get_time_ns(void) {
+    ok_or_panic(soundio_os_init());
+    int64_t prev_time = soundio_get_time_ns(SoundIoClockMonotonic);
+    int64_t prev_raw_time = soundio_get_time_ns(SoundIoClockMonotonicRaw);
+    for (int i = 0; i < 1000; i += 1) {
+        int64_t time = soundio_get_time_ns(SoundIoClockMonotonic);
+        int64_t raw_time = soundio_get_time_ns(SoundIoClockMonotonicRaw);
+        assert(time >= prev_time);
+        assert(raw_time >= prev_raw_time);
+        prev_time = time;
+        prev_raw_time = raw_time;
+    }
+}
+
+static void test_cond_timed_wait_until(void) {
+    ok_or_panic(soundio_os_init());
+    struct SoundIoOsCond *cond = soundio_os_cond_create();
+    assert(cond);
+    // deadlines that have passed return right away
+    int64_t start = soundio_os_get_time_ns();
+    soundio_os_cond_timed_wait_until(cond, NULL, start - 1000000000);
+    soundio_os_cond_timed_wait_until(cond, NULL, 0);
+    assert(soundio_os_get_time_ns() - start < 1000000000);
+    // wakeups may be spurious, so wait until the deadline has really passed
+    int64_t deadline = soundio_os_get_time_ns() + 20000000;
+    while (soundio_os_get_time_ns() < deadline)
+        soundio_os_cond_timed_wait_until(cond, NULL, deadline);
+    soundio_os_cond_destroy(cond);
+}
+
 static void write_callback(struct SoundIoOutStream *device, int frame_count_min, int frame_count_max) { }
 static void error_callback(struct SoundIoOutStream *device, int err) { }
+static void instream_error_callback(struct SoundIoInStream *instream, int err) { }
 
 static void test_create_outstream(void) {
     struct SoundIo *soundio = soundio_create();
@@ -149,10 +185,10 @@ static void test_ring_buffer_threaded(void) {
     SOUNDIO_ATOMIC_STORE(rb_done, false);
 
     struct SoundIoOsThread *reader_thread;
-    ok_or_panic(soundio_os_thread_create(reader_thread_run, NULL, NULL, &reader_thread));
+    ok_or_panic(soundio_os_thread_create(reader_thread_run, NULL, NULL, NULL, 0, &reader_thread));
 
     struct SoundIoOsThread *writer_thread;
-    ok_or_panic(soundio_os_thread_create(writer_thread_run, NULL, NULL, &writer_thread));
+    ok_or_panic(soundio_os_thread_create(writer_thread_run, NULL, NULL, NULL, 0, &writer_thread));
 
     while (SOUNDIO_ATOMIC_LOAD(rb_read_it) < 100000 || SOUNDIO_ATOMIC_LOAD(rb_write_it) < 100000) {}
     SOUNDIO_ATOMIC_STORE(rb_done, true);
@@ -211,6 +247,689 @@ static void test_nearest_sample_rate(void) {
     assert(soundio_device_nearest_sample_rate(&device, 9999999) == 96000);
 }
 
+static long clock_frames_written;
+static int clock_underflow_count;
+
+static void clock_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    ok_or_panic(soundio_outstream_end_write(outstream));
+    clock_frames_written += frame_count;
+}
+
+static void clock_underflow_callback(struct SoundIoOutStream *outstream) {
+    clock_underflow_count += 1;
+}
+
+static void test_dummy_manual_clock(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_clock = SoundIoDummyClockManual;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.1;
+    outstream->write_callback = clock_write_callback;
+    outstream->underflow_callback = clock_underflow_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    clock_frames_written = 0;
+    clock_underflow_count = 0;
+    ok_or_panic(soundio_outstream_start(outstream));
+    ok_or_panic(soundio_advance_clock(soundio, 0.0));
+    long buffer_frames = clock_frames_written;
+    assert(buffer_frames > 0);
+
+    // an hour of streaming, without waiting for it
+    for (int i = 0; i < 3600; i += 1)
+        ok_or_panic(soundio_advance_clock(soundio, 1.0));
+    long played_frames = clock_frames_written - buffer_frames;
+    long expected_frames = 3600L * outstream->sample_rate;
+    long period_frames = outstream->software_latency / 2.0 * outstream->sample_rate;
+    // the buffer is refilled one period late, and the last period may not
+    // have begun because of rounding
+    assert(played_frames <= expected_frames);
+    assert(played_frames >= expected_frames - 2 * period_frames);
+    assert(clock_underflow_count == 0);
+
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+}
+
+static void test_thread_policy(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_clock = SoundIoDummyClockManual;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+
+    struct SoundIoThreadPolicy policy;
+    memset(&policy, 0, sizeof(struct SoundIoThreadPolicy));
+    policy.sched = SoundIoThreadSchedOther;
+    policy.deadline_runtime = 1.5;
+
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.1;
+    outstream->write_callback = clock_write_callback;
+    outstream->error_callback = error_callback;
+    outstream->thread_policy = &policy;
+    assert(soundio_outstream_open(outstream) == SoundIoErrorInvalid);
+    soundio_outstream_destroy(outstream);
+
+    // the context policy is used when the stream has none
+    soundio->thread_policy.priority = -1;
+    outstream = soundio_outstream_create(device);
+    outstream->write_callback = clock_write_callback;
+    outstream->error_callback = error_callback;
+    assert(soundio_outstream_open(outstream) == SoundIoErrorInvalid);
+    soundio_outstream_destroy(outstream);
+    soundio->thread_policy.priority = 0;
+
+    // copied by open, so changing it afterwards does nothing
+    policy.deadline_runtime = 0.0;
+    policy.timer_slack = 50000;
+    outstream = soundio_outstream_create(device);
+    outstream->write_callback = clock_write_callback;
+    outstream->error_callback = error_callback;
+    outstream->thread_policy = &policy;
+    ok_or_panic(soundio_outstream_open(outstream));
+    policy.priority = -1;
+
+    clock_frames_written = 0;
+    ok_or_panic(soundio_outstream_start(outstream));
+    ok_or_panic(soundio_advance_clock(soundio, 0.0));
+    assert(clock_frames_written > 0);
+
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+}
+
+static int devices_change_count = 0;
+
+static void count_devices_change(struct SoundIo *soundio) {
+    devices_change_count += 1;
+}
+
+static void test_dummy_device_catalog(void) {
+    static const int device_count = 100;
+    struct SoundIoChannelLayout layout = {"24 channels", 24, {0}};
+    for (int i = 0; i < layout.channel_count; i += 1)
+        layout.channels[i] = SoundIoChannelIdAux0 + i;
+    enum SoundIoFormat format = SoundIoFormatS24NE;
+    struct SoundIoSampleRateRange rate = {96000, 96000};
+
+    struct SoundIoDummyDeviceSpec specs[100];
+    char ids[100][16];
+    for (int i = 0; i < device_count; i += 1) {
+        snprintf(ids[i], sizeof(ids[i]), "dev-%d", i);
+        memset(&specs[i], 0, sizeof(struct SoundIoDummyDeviceSpec));
+        specs[i].id = ids[i];
+        specs[i].name = ids[i];
+        specs[i].aim = (i % 2 == 0) ? SoundIoDeviceAimOutput : SoundIoDeviceAimInput;
+        specs[i].layout_count = 1;
+        specs[i].layouts = &layout;
+        specs[i].format_count = 1;
+        specs[i].formats = &format;
+        specs[i].sample_rate_count = 1;
+        specs[i].sample_rates = &rate;
+    }
+
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_devices = specs;
+    soundio->dummy_device_count = device_count;
+    soundio->on_devices_change = count_devices_change;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+
+    devices_change_count = 0;
+    soundio_flush_events(soundio);
+    assert(devices_change_count == 1);
+    assert(soundio_output_device_count(soundio) == device_count / 2);
+    assert(soundio_input_device_count(soundio) == device_count / 2);
+    assert(soundio_default_output_device_index(soundio) == 0);
+
+    struct SoundIoDevice *device = soundio_get_input_device(soundio, 0);
+    assert(device);
+    assert(strcmp(device->id, "dev-1") == 0);
+    assert(device->current_layout.channel_count == 24);
+    assert(device->current_format == SoundIoFormatS24NE);
+    assert(device->sample_rate_current == 96000);
+    soundio_device_unref(device);
+
+    // ids must be unique per aim
+    assert(soundio_add_dummy_device(soundio, &specs[0]) == SoundIoErrorInvalid);
+    assert(soundio_remove_dummy_device(soundio, SoundIoDeviceAimInput, "dev-0") == SoundIoErrorInvalid);
+
+    ok_or_panic(soundio_remove_dummy_device(soundio, SoundIoDeviceAimOutput, "dev-0"));
+    specs[0].aim = SoundIoDeviceAimInput;
+    ok_or_panic(soundio_add_dummy_device(soundio, &specs[0]));
+    soundio_flush_events(soundio);
+    assert(devices_change_count == 2);
+    assert(soundio_output_device_count(soundio) == device_count / 2 - 1);
+    assert(soundio_input_device_count(soundio) == device_count / 2 + 1);
+
+    device = soundio_get_output_device(soundio, soundio_default_output_device_index(soundio));
+    assert(device);
+    assert(strcmp(device->id, "dev-2") == 0);
+    soundio_device_unref(device);
+
+    soundio_flush_events(soundio);
+    assert(devices_change_count == 2);
+
+    soundio_destroy(soundio);
+}
+
+static int32_t loopback_next_sample;
+static long loopback_frames_read;
+static long loopback_first_frame;
+static int32_t loopback_last_sample;
+
+static void loopback_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        *(int32_t *)areas[0].ptr = loopback_next_sample++;
+        areas[0].ptr += areas[0].step;
+    }
+    ok_or_panic(soundio_outstream_end_write(outstream));
+}
+
+static void loopback_read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        int32_t sample = *(int32_t *)areas[0].ptr;
+        areas[0].ptr += areas[0].step;
+        if (sample != 0) {
+            if (loopback_last_sample == 0)
+                loopback_first_frame = loopback_frames_read;
+            else
+                assert(sample == loopback_last_sample + 1);
+            loopback_last_sample = sample;
+        } else {
+            // silence may only come before the output stream starts playing
+            assert(loopback_last_sample == 0);
+        }
+        loopback_frames_read += 1;
+    }
+    ok_or_panic(soundio_instream_end_read(instream));
+}
+
+static void test_dummy_loopback(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_clock = SoundIoDummyClockManual;
+    soundio->dummy_loopback = true;
+    soundio->dummy_loopback_delay = 0.25;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+
+    const struct SoundIoChannelLayout *mono = soundio_channel_layout_get_default(1);
+    struct SoundIoDevice *out_device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    struct SoundIoDevice *in_device = soundio_get_input_device(soundio,
+            soundio_default_input_device_index(soundio));
+    assert(out_device && in_device);
+
+    struct SoundIoOutStream *outstream = soundio_outstream_create(out_device);
+    outstream->format = SoundIoFormatS32NE;
+    outstream->layout = *mono;
+    outstream->sample_rate = 48000;
+    outstream->software_latency = 0.1;
+    outstream->write_callback = loopback_write_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    struct SoundIoInStream *instream = soundio_instream_create(in_device);
+    instream->format = SoundIoFormatS32NE;
+    instream->layout = *mono;
+    instream->sample_rate = 48000;
+    instream->software_latency = 0.02;
+    instream->read_callback = loopback_read_callback;
+    instream->error_callback = instream_error_callback;
+    ok_or_panic(soundio_instream_open(instream));
+
+    loopback_next_sample = 1;
+    loopback_frames_read = 0;
+    loopback_last_sample = 0;
+    ok_or_panic(soundio_instream_start(instream));
+    ok_or_panic(soundio_outstream_start(outstream));
+    for (int i = 0; i < 1000; i += 1)
+        ok_or_panic(soundio_advance_clock(soundio, 0.01));
+
+    // sample n was played at (n - 1) / sample_rate
+    assert(loopback_last_sample > 0);
+    long delay_frames = loopback_first_frame;
+    long expected_frames = soundio->dummy_loopback_delay * instream->sample_rate;
+    long tolerance = (outstream->software_latency / 2.0 + instream->software_latency) * instream->sample_rate;
+    assert(delay_frames >= expected_frames - tolerance);
+    assert(delay_frames <= expected_frames + tolerance);
+
+    soundio_instream_destroy(instream);
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(in_device);
+    soundio_device_unref(out_device);
+    soundio_destroy(soundio);
+}
+
+static int fault_underflow_count;
+static int fault_error_count;
+static int fault_disconnect_count;
+
+static void fault_underflow_callback(struct SoundIoOutStream *outstream) {
+    fault_underflow_count += 1;
+}
+
+static void fault_error_callback(struct SoundIoOutStream *outstream, int err) {
+    assert(err == SoundIoErrorStreaming);
+    fault_error_count += 1;
+}
+
+static void fault_on_backend_disconnect(struct SoundIo *soundio, int err) {
+    assert(err == SoundIoErrorBackendDisconnected);
+    fault_disconnect_count += 1;
+}
+
+// Returns the number of underflows in 10 seconds of a stream whose backend
+// disconnects after 5 seconds.
+static int run_dummy_faults(unsigned int seed) {
+    struct SoundIoDummyFaults faults;
+    memset(&faults, 0, sizeof(struct SoundIoDummyFaults));
+    faults.seed = seed;
+    faults.jitter_distribution = SoundIoDummyJitterExponential;
+    faults.jitter = 0.001;
+    faults.underflow_probability = 0.05;
+    faults.disconnect_after = 5.0;
+
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->dummy_clock = SoundIoDummyClockManual;
+    soundio->dummy_faults = &faults;
+    soundio->on_backend_disconnect = fault_on_backend_disconnect;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendDummy));
+    soundio_flush_events(soundio);
+    struct SoundIoDevice *device = soundio_get_output_device(soundio,
+            soundio_default_output_device_index(soundio));
+    assert(device);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->software_latency = 0.1;
+    outstream->write_callback = clock_write_callback;
+    outstream->underflow_callback = fault_underflow_callback;
+    outstream->error_callback = fault_error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    fault_underflow_count = 0;
+    fault_error_count = 0;
+    fault_disconnect_count = 0;
+    ok_or_panic(soundio_outstream_start(outstream));
+    for (int i = 0; i < 1000; i += 1) {
+        ok_or_panic(soundio_advance_clock(soundio, 0.01));
+        soundio_flush_events(soundio);
+        // the clock adds up to 5 seconds give or take rounding
+        if (i < 495 || i > 505)
+            assert(fault_disconnect_count == (i > 500));
+    }
+    assert(fault_disconnect_count == 1);
+    assert(fault_error_count == 1);
+    int underflow_count = fault_underflow_count;
+
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+    return underflow_count;
+}
+
+static void test_dummy_faults(void) {
+    int underflow_count = run_dummy_faults(1234);
+    // about 5 seconds of 50 ms periods
+    assert(underflow_count > 0);
+    assert(underflow_count < 20);
+    assert(run_dummy_faults(1234) == underflow_count);
+}
+
+static const int file_frame_count = 100000;
+static long file_frames_written;
+static long file_frames_read;
+static struct SoundIoAtomicBool file_done;
+static struct SoundIoAtomicInt file_idle_callback_count;
+static int file_end_error;
+
+static void file_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    int frame_count = soundio_int_min(frame_count_max, file_frame_count - file_frames_written);
+    if (frame_count == 0) {
+        SOUNDIO_ATOMIC_FETCH_ADD(file_idle_callback_count, 1);
+        SOUNDIO_ATOMIC_STORE(file_done, true);
+        return;
+    }
+    struct SoundIoChannelArea *areas;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        int16_t sample = (file_frames_written + frame) & 0x7fff;
+        *(int16_t *)(areas[0].ptr + areas[0].step * frame) = sample;
+        *(int16_t *)(areas[1].ptr + areas[1].step * frame) = -sample;
+    }
+    ok_or_panic(soundio_outstream_end_write(outstream));
+    file_frames_written += frame_count;
+}
+
+static void file_read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
+    // take a few frames less than offered, to get them again next time
+    int frame_count = soundio_int_max(1, frame_count_max - 7);
+    struct SoundIoChannelArea *areas;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1) {
+        int16_t sample = (file_frames_read + frame) & 0x7fff;
+        assert(*(int16_t *)(areas[0].ptr + areas[0].step * frame) == sample);
+        assert(*(int16_t *)(areas[1].ptr + areas[1].step * frame) == -sample);
+    }
+    ok_or_panic(soundio_instream_end_read(instream));
+    file_frames_read += frame_count;
+}
+
+static void file_read_error_callback(struct SoundIoInStream *instream, int err) {
+    file_end_error = err;
+    SOUNDIO_ATOMIC_STORE(file_done, true);
+}
+
+static void wait_for_file_done(void) {
+    double deadline = soundio_os_get_time() + 10.0;
+    while (!SOUNDIO_ATOMIC_LOAD(file_done))
+        assert(soundio_os_get_time() < deadline);
+}
+
+static void test_file_render(void) {
+    const char *path = "unit_tests_render.wav";
+    struct SoundIoFileDeviceSpec spec;
+    memset(&spec, 0, sizeof(struct SoundIoFileDeviceSpec));
+    spec.path = path;
+    spec.aim = SoundIoDeviceAimOutput;
+    spec.type = SoundIoFileTypeWav;
+
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->file_devices = &spec;
+    soundio->file_device_count = 1;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendFile));
+    soundio_flush_events(soundio);
+    assert(soundio_output_device_count(soundio) == 1);
+    assert(soundio_input_device_count(soundio) == 0);
+
+    struct SoundIoDevice *device = soundio_get_output_device(soundio, 0);
+    assert(device);
+    assert(strcmp(device->id, path) == 0);
+    struct SoundIoOutStream *outstream = soundio_outstream_create(device);
+    outstream->format = SoundIoFormatS16LE;
+    outstream->layout = *soundio_channel_layout_get_builtin(SoundIoChannelLayoutIdStereo);
+    outstream->sample_rate = 44100;
+    outstream->software_latency = 0.1;
+    outstream->write_callback = file_write_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    file_frames_written = 0;
+    SOUNDIO_ATOMIC_STORE(file_done, false);
+    SOUNDIO_ATOMIC_STORE(file_idle_callback_count, 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    // 100000 frames are over two seconds of audio
+    wait_for_file_done();
+    // a callback that writes nothing is not called again right away
+    struct SoundIoOsCond *cond = soundio_os_cond_create();
+    assert(cond);
+    soundio_os_cond_timed_wait(cond, NULL, 0.3);
+    soundio_os_cond_destroy(cond);
+    assert(SOUNDIO_ATOMIC_LOAD(file_idle_callback_count) <= 5);
+    soundio_outstream_destroy(outstream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+
+    spec.aim = SoundIoDeviceAimInput;
+    soundio = soundio_create();
+    assert(soundio);
+    soundio->file_devices = &spec;
+    soundio->file_device_count = 1;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendFile));
+    soundio_flush_events(soundio);
+
+    device = soundio_get_input_device(soundio, soundio_default_input_device_index(soundio));
+    assert(device);
+    ok_or_panic(device->probe_error);
+    assert(device->current_format == SoundIoFormatS16LE);
+    assert(device->sample_rate_current == 44100);
+    assert(device->current_layout.channel_count == 2);
+
+    struct SoundIoInStream *instream = soundio_instream_create(device);
+    instream->format = SoundIoFormatS16LE;
+    instream->software_latency = 0.05;
+    instream->read_callback = file_read_callback;
+    instream->error_callback = file_read_error_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    assert(instream->sample_rate == 44100);
+
+    file_frames_read = 0;
+    file_end_error = 0;
+    SOUNDIO_ATOMIC_STORE(file_done, false);
+    ok_or_panic(soundio_instream_start(instream));
+    wait_for_file_done();
+    assert(file_end_error == SoundIoErrorEndOfFile);
+    assert(file_frames_read == file_frame_count);
+    soundio_instream_destroy(instream);
+
+    // the default error callback does not abort at the end of the file
+    instream = soundio_instream_create(device);
+    instream->format = SoundIoFormatS16LE;
+    instream->software_latency = 0.05;
+    instream->read_callback = file_read_callback;
+    ok_or_panic(soundio_instream_open(instream));
+    file_frames_read = 0;
+    ok_or_panic(soundio_instream_start(instream));
+    cond = soundio_os_cond_create();
+    assert(cond);
+    double deadline = soundio_os_get_time() + 10.0;
+    while (file_frames_read < file_frame_count) {
+        assert(soundio_os_get_time() < deadline);
+        soundio_os_cond_timed_wait(cond, NULL, 0.01);
+    }
+    soundio_os_cond_timed_wait(cond, NULL, 0.1);
+    soundio_os_cond_destroy(cond);
+
+    soundio_instream_destroy(instream);
+    soundio_device_unref(device);
+    soundio_destroy(soundio);
+    remove(path);
+}
+
+#ifdef SOUNDIO_HAVE_PIPE
+static int32_t pipe_next_sample;
+static int32_t pipe_expected_sample;
+static struct SoundIoAtomicBool pipe_done;
+
+static void pipe_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1)
+        *(int32_t *)(areas[0].ptr + areas[0].step * frame) = pipe_next_sample++;
+    ok_or_panic(soundio_outstream_end_write(outstream));
+}
+
+static void pipe_read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    for (int frame = 0; frame < frame_count; frame += 1)
+        assert(*(int32_t *)(areas[0].ptr + areas[0].step * frame) == pipe_expected_sample++);
+    ok_or_panic(soundio_instream_end_read(instream));
+    if (pipe_expected_sample >= 1000000)
+        SOUNDIO_ATOMIC_STORE(pipe_done, true);
+}
+
+static void test_pipe_loopback(void) {
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    struct SoundIoPipeDeviceSpec specs[2];
+    memset(specs, 0, sizeof(specs));
+    for (int i = 0; i < 2; i += 1) {
+        specs[i].format = SoundIoFormatS32NE;
+        specs[i].sample_rate = 48000;
+        specs[i].channel_count = 1;
+    }
+    specs[0].fd = fds[1];
+    specs[0].aim = SoundIoDeviceAimOutput;
+    specs[1].fd = fds[0];
+    specs[1].aim = SoundIoDeviceAimInput;
+
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    soundio->pipe_devices = specs;
+    soundio->pipe_device_count = 2;
+    ok_or_panic(soundio_connect_backend(soundio, SoundIoBackendPipe));
+    soundio_flush_events(soundio);
+
+    struct SoundIoDevice *out_device = soundio_get_output_device(soundio, 0);
+    struct SoundIoDevice *in_device = soundio_get_input_device(soundio, 0);
+    assert(out_device && in_device);
+
+    struct SoundIoOutStream *outstream = soundio_outstream_create(out_device);
+    outstream->software_latency = 0.1;
+    outstream->write_callback = pipe_write_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+    assert(outstream->format == SoundIoFormatS32NE);
+
+    struct SoundIoInStream *instream = soundio_instream_create(in_device);
+    instream->format = SoundIoFormatS32NE;
+    instream->software_latency = 0.01;
+    instream->read_callback = pipe_read_callback;
+    instream->error_callback = instream_error_callback;
+    ok_or_panic(soundio_instream_open(instream));
+
+    // the frames go through the pipe as fast as they are read, and the ring
+    // buffer pages they were spliced from are written again many times over
+    pipe_next_sample = 0;
+    pipe_expected_sample = 0;
+    SOUNDIO_ATOMIC_STORE(pipe_done, false);
+    ok_or_panic(soundio_instream_start(instream));
+    ok_or_panic(soundio_outstream_start(outstream));
+    double deadline = soundio_os_get_time() + 10.0;
+    while (!SOUNDIO_ATOMIC_LOAD(pipe_done))
+        assert(soundio_os_get_time() < deadline);
+
+    soundio_outstream_destroy(outstream);
+    soundio_instream_destroy(instream);
+    // the caller's file descriptors are left as they were
+    assert(!(fcntl(fds[0], F_GETFL) & O_NONBLOCK));
+    assert(!(fcntl(fds[1], F_GETFL) & O_NONBLOCK));
+    soundio_device_unref(in_device);
+    soundio_device_unref(out_device);
+    soundio_destroy(soundio);
+    close(fds[0]);
+    close(fds[1]);
+}
+#endif
+
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+static struct SoundIoAtomicLong pipewire_frames_written;
+static struct SoundIoAtomicLong pipewire_frames_read;
+
+static void pipewire_write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_outstream_begin_write(outstream, &areas, &frame_count));
+    for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+        for (int frame = 0; frame < frame_count; frame += 1)
+            *(float *)(areas[ch].ptr + areas[ch].step * frame) = 0.0f;
+    }
+    ok_or_panic(soundio_outstream_end_write(outstream));
+    SOUNDIO_ATOMIC_FETCH_ADD(pipewire_frames_written, frame_count);
+}
+
+static void pipewire_read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
+    struct SoundIoChannelArea *areas;
+    int frame_count = frame_count_max;
+    ok_or_panic(soundio_instream_begin_read(instream, &areas, &frame_count));
+    ok_or_panic(soundio_instream_end_read(instream));
+    SOUNDIO_ATOMIC_FETCH_ADD(pipewire_frames_read, frame_count);
+}
+
+// Needs a running daemon, for example one with null sinks, and is skipped
+// without one.
+static void test_pipewire_streams(void) {
+    struct SoundIo *soundio = soundio_create();
+    assert(soundio);
+    if (soundio_connect_backend(soundio, SoundIoBackendPipeWire)) {
+        fprintf(stderr, "no daemon, skipped...");
+        soundio_destroy(soundio);
+        return;
+    }
+    soundio_flush_events(soundio);
+
+    int out_index = soundio_default_output_device_index(soundio);
+    int in_index = soundio_default_input_device_index(soundio);
+    if (out_index < 0 || in_index < 0) {
+        fprintf(stderr, "no default devices, skipped...");
+        soundio_destroy(soundio);
+        return;
+    }
+    struct SoundIoDevice *out_device = soundio_get_output_device(soundio, out_index);
+    struct SoundIoDevice *in_device = soundio_get_input_device(soundio, in_index);
+    assert(out_device && in_device);
+    ok_or_panic(out_device->probe_error);
+    ok_or_panic(in_device->probe_error);
+
+    struct SoundIoOutStream *outstream = soundio_outstream_create(out_device);
+    outstream->format = SoundIoFormatFloat32NE;
+    outstream->software_latency = 0.02;
+    outstream->write_callback = pipewire_write_callback;
+    outstream->error_callback = error_callback;
+    ok_or_panic(soundio_outstream_open(outstream));
+
+    struct SoundIoInStream *instream = soundio_instream_create(in_device);
+    instream->format = SoundIoFormatFloat32NE;
+    instream->software_latency = 0.02;
+    instream->read_callback = pipewire_read_callback;
+    instream->error_callback = instream_error_callback;
+    ok_or_panic(soundio_instream_open(instream));
+
+    SOUNDIO_ATOMIC_STORE(pipewire_frames_written, 0);
+    SOUNDIO_ATOMIC_STORE(pipewire_frames_read, 0);
+    ok_or_panic(soundio_outstream_start(outstream));
+    ok_or_panic(soundio_instream_start(instream));
+
+    // half a second of audio each way
+    double deadline = soundio_os_get_time() + 10.0;
+    while (SOUNDIO_ATOMIC_LOAD(pipewire_frames_written) < outstream->sample_rate / 2 ||
+           SOUNDIO_ATOMIC_LOAD(pipewire_frames_read) < instream->sample_rate / 2)
+    {
+        soundio_flush_events(soundio);
+        assert(soundio_os_get_time() < deadline);
+    }
+
+    soundio_outstream_destroy(outstream);
+    soundio_instream_destroy(instream);
+    soundio_device_unref(in_device);
+    soundio_device_unref(out_device);
+    soundio_destroy(soundio);
+}
+#endif
+
 struct Test {
     const char *name;
     void (*fn)(void);
@@ -218,11 +937,25 @@ struct Test {
 
 static struct Test tests[] = {
     {"os_get_time", test_os_get_time},
+    {"get_time_ns", test_get_time_ns},
+    {"cond_timed_wait_until", test_cond_timed_wait_until},
     {"create output stream", test_create_outstream},
     {"mirrored memory", test_mirrored_memory},
     {"soundio_device_nearest_sample_rate", test_nearest_sample_rate},
     {"ring buffer basic", test_ring_buffer_basic},
     {"ring buffer threaded", test_ring_buffer_threaded},
+    {"dummy manual clock", test_dummy_manual_clock},
+    {"thread policy", test_thread_policy},
+    {"dummy device catalog", test_dummy_device_catalog},
+    {"dummy loopback", test_dummy_loopback},
+    {"dummy faults", test_dummy_faults},
+    {"file render", test_file_render},
+#ifdef SOUNDIO_HAVE_PIPE
+    {"pipe loopback", test_pipe_loopback},
+#endif
+#ifdef SOUNDIO_HAVE_PIPEWIRE
+    {"pipewire streams", test_pipewire_streams},
+#endif
     {NULL, NULL},
 };
 